@@ -0,0 +1,316 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - simulated network benchmark
+ *
+ * Runs the monitor core against scripted network conditions
+ * on a virtual clock, many runs per scenario, and reports for
+ * each probe strategy:
+ *
+ *   DOWN     - seconds from the start of an outage to Offline
+ *   MISSED   - outages that ended before they were shown
+ *   UP       - seconds from the end of an outage to Online
+ *   FALSE    - Offline shown while the Internet was up, per day
+ *   PROBES   - probes, connects and loop wakeups per hour
+ *
+ * The timer wheel is checked first - timers due in the same
+ * tick that cancel and move each other, as a finished probe
+ * cancels the stagger timer of its dual-stack target.
+ * ---------------------------------------------------------*/
+
+#include "monitor.h"
+#include "net_sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define   DEF_RUNS       200
+#define   DEF_HOURS      24
+
+struct Bench_Strategy
+{
+     const char *name;
+     LONG  targets;           // Raced at once.
+     BYTE  type;              // PROBE_TYPE_*
+     BYTE  policy;            // PROBE_POLICY_*
+     LONG  quorum;
+     ULONG interval_s, interval_max_s, confirm_s;
+     LONG  jitter_percent;
+     ULONG timeout_ms;        // 0 - adaptive.
+     LONG  flap_failures, flap_window, flap_successes;    // 0 - no damping.
+};
+
+static const struct Bench_Strategy bench_strategy[] =
+{
+     { "1 target, fixed 5s",            1, PROBE_TYPE_TCP,  PROBE_POLICY_FIRST,  0, 5, 5,  5, 0,  1000, 0, 0, 0 },
+     { "race 2, fixed 5s",              2, PROBE_TYPE_TCP,  PROBE_POLICY_FIRST,  0, 5, 5,  5, 0,  1000, 0, 0, 0 },
+     { "race 2, fixed 5s, confirm 1s",  2, PROBE_TYPE_TCP,  PROBE_POLICY_FIRST,  0, 5, 5,  1, 0,  1000, 0, 0, 0 },
+     { "race 2, 5..60s, confirm 1s",    2, PROBE_TYPE_TCP,  PROBE_POLICY_FIRST,  0, 5, 60, 1, 10, 1000, 0, 0, 0 },
+     { "race 2, 2..30s, confirm 1s",    2, PROBE_TYPE_TCP,  PROBE_POLICY_FIRST,  0, 2, 30, 1, 10, 1000, 0, 0, 0 },
+     { "race 2, 5..60s, timeout 3s",    2, PROBE_TYPE_TCP,  PROBE_POLICY_FIRST,  0, 5, 60, 1, 10, 3000, 0, 0, 0 },
+     { "2 of 3, 5..60s, confirm 1s",    3, PROBE_TYPE_TCP,  PROBE_POLICY_QUORUM, 2, 5, 60, 1, 10, 1000, 0, 0, 0 },
+     { "all 2, 5..60s, confirm 1s",     2, PROBE_TYPE_TCP,  PROBE_POLICY_ALL,    0, 5, 60, 1, 10, 1000, 0, 0, 0 },
+     { "race 2, 5..60s, auto timeout",  2, PROBE_TYPE_TCP,  PROBE_POLICY_FIRST,  0, 5, 60, 1, 10, 0,    0, 0, 0 },
+     { "2 of 3, 5..60s, auto timeout",  3, PROBE_TYPE_TCP,  PROBE_POLICY_QUORUM, 2, 5, 60, 1, 10, 0,    0, 0, 0 },
+     { "race 2 DNS, 5..60s, auto",      2, PROBE_TYPE_DNS,  PROBE_POLICY_FIRST,  0, 5, 60, 1, 10, 0,    0, 0, 0 },
+     { "race 2 HTTP, 5..60s, auto",     2, PROBE_TYPE_HTTP, PROBE_POLICY_FIRST,  0, 5, 60, 1, 10, 0,    0, 0, 0 },
+     { "race 2, auto, damp 2/3 up 2",   2, PROBE_TYPE_TCP,  PROBE_POLICY_FIRST,  0, 5, 60, 1, 10, 0,    2, 3, 2 },
+     { "race 2, auto, damp 3/5 up 2",   2, PROBE_TYPE_TCP,  PROBE_POLICY_FIRST,  0, 5, 60, 1, 10, 0,    3, 5, 2 },
+};
+
+static const struct Sim_Script bench_script[] =
+{
+     { "outage 2 min every hour",        3600, { { 1800, 1920, SIM_DOWN } },        1, 30, 10, 0, 0 },
+     { "drop 20 s every hour",           3600, { { 1800, 1820, SIM_DOWN } },        1, 30, 10, 0, 0 },
+     { "unreachable 2 min every hour",   3600, { { 1800, 1920, SIM_UNREACHABLE } }, 1, 30, 10, 0, 0 },
+     { "RST storm 10 min every hour",    3600, { { 600,  1200, SIM_RST } },         1, 30, 10, 0, 0 },
+     { "slow SYN-ACK 10 min every hour", 3600, { { 600,  1200, SIM_SLOW } },        1, 30, 10, 1500, 0 },
+     { "satellite 700 ms, outage 2 min/h", 3600, { { 1800, 1920, SIM_DOWN } },     1, 700, 300, 0, 0 },
+     { "captive portal 10 min every hour", 3600, { { 600, 1200, SIM_PORTAL } },      1, 30, 10, 0, 0 },
+     { "20% loss, outage 2 min/h",       3600, { { 0, 1800, SIM_LOSS }, { 1800, 1920, SIM_DOWN }, { 1920, 3600, SIM_LOSS } }, 3, 30, 10, 0, 20 },
+};
+
+#define BENCH_STRATEGIES   (LONG)(sizeof(bench_strategy) / sizeof(bench_strategy[0]))
+#define BENCH_SCRIPTS      (LONG)(sizeof(bench_script) / sizeof(bench_script[0]))
+
+// Results of all runs of one scenario with one strategy.
+struct Bench_Result
+{
+     double  down_sum, down_max;
+     ULONG   down_count;
+     double  up_sum, up_max;
+     ULONG   up_count;
+     ULONG   outages;
+     ULONG   false_offline;
+     ULONG   probes, connects, wakeups;
+};
+
+static struct Bench_Result bench_result;
+
+// What the run has shown so far.
+static TIME_US bench_start;
+static BYTE    bench_shown;
+static TIME_US bench_offline_at;
+static TIME_US bench_detected_since;
+
+// Called by the monitor core after every finished probe - same place ENV: is written on Amiga.
+void Platform_Publish(struct Monitor *_monitor)
+{
+     if (_monitor->status == bench_shown) return;
+
+     struct Bench_Result *result = &bench_result;
+     TIME_US since;
+     BYTE truth = Sim_Truth(sim_now, &since);
+
+     if (_monitor->status == 0)
+     {
+          bench_offline_at = sim_now;
+
+          // Outages already going on when the run started are not measured.
+          if (truth == 0 && since >= bench_start && since != bench_detected_since)
+          {
+               double delay = (sim_now - since) / 1000000.0;
+
+               result->down_sum += delay;
+               if (delay > result->down_max) result->down_max = delay;
+               result->down_count++;
+
+               bench_detected_since = since;
+          }
+          else if (truth)
+               result->false_offline++;
+     }
+     else if (bench_shown == 0 && truth && since >= bench_offline_at)
+     {
+          // Recovered after Offline was shown - not the end of a false alarm.
+          double delay = (sim_now - since) / 1000000.0;
+
+          result->up_sum += delay;
+          if (delay > result->up_max) result->up_max = delay;
+          result->up_count++;
+     }
+
+     bench_shown = _monitor->status;
+}
+
+// Three timers due in one tick. Whichever runs first cancels the other two, moves one of
+// them a second on and adds one 64 ticks on, into the slot being served.
+static struct Wheel       bench_wheel;
+static struct Wheel_Timer bench_timer[4];
+static LONG               bench_calls[4];
+
+static void Bench_Wheel_Callback(struct Wheel_Timer *_timer)
+{
+     LONG i = (LONG)(_timer - bench_timer);
+
+     bench_calls[i]++;
+     if (i == 3 || bench_calls[0] + bench_calls[1] + bench_calls[2] > 1) return;
+
+     Wheel_Cancel(&bench_wheel, &bench_timer[(i + 1) % 3]);
+     Wheel_Cancel(&bench_wheel, &bench_timer[(i + 2) % 3]);
+     Wheel_Add(&bench_wheel, &bench_timer[(i + 1) % 3], Platform_Time() + 1000000);
+     Wheel_Add(&bench_wheel, &bench_timer[3], bench_wheel.tick_time + (WHEEL_SLOTS - 1) * WHEEL_TICK_US);
+}
+
+// Returns 0 if the wheel lost or ran a timer it should not have.
+static BYTE Bench_Wheel_Check(void)
+{
+     sim_now = 1000000;
+     Wheel_Init(&bench_wheel);
+
+     for (LONG i = 0; i < 4; i++)
+     {
+          Wheel_Timer_Init(&bench_timer[i], Bench_Wheel_Callback, NULL);
+          bench_calls[i] = 0;
+     }
+
+     for (LONG i = 0; i < 3; i++) Wheel_Add(&bench_wheel, &bench_timer[i], sim_now + 250000);
+
+     sim_now = Wheel_Next(&bench_wheel);
+     Wheel_Advance(&bench_wheel, sim_now);
+
+     // One of the three ran, the one moved on and the one 64 ticks on wait.
+     if (bench_calls[0] + bench_calls[1] + bench_calls[2] != 1 || bench_calls[3] || bench_wheel.count != 2) return 0;
+
+     while (bench_wheel.count && sim_now < 10000000)
+     {
+          sim_now = Wheel_Next(&bench_wheel);
+          Wheel_Advance(&bench_wheel, sim_now);
+     }
+
+     return bench_calls[0] + bench_calls[1] + bench_calls[2] == 2 && bench_calls[3] == 1 && Wheel_Next(&bench_wheel) == WHEEL_NEVER;
+}
+
+static void Bench_Run(const struct Bench_Strategy *_strategy, const struct Sim_Script *_script, ULONG _seed, LONG _hours)
+{
+     struct Monitor monitor;
+     struct Wheel wheel;
+
+     Sim_Reset(_script, _seed);
+
+     Wheel_Init(&wheel);
+     Monitor_Init(&monitor, _strategy->interval_s * 1000, _strategy->interval_max_s * 1000, _strategy->confirm_s * 1000, _strategy->jitter_percent, &wheel);
+     Monitor_Set_Timeout(&monitor, _strategy->timeout_ms * 1000, 0, 0);
+
+     Monitor_Set_Policy(&monitor, _strategy->policy, _strategy->quorum);
+     Monitor_Set_Damping(&monitor, _strategy->flap_failures, _strategy->flap_window, _strategy->flap_successes);
+
+     for (LONG i = 0; i < _strategy->targets; i++)
+     {
+          struct Probe_Target target;
+          char text[32];
+
+          sprintf(text, "%s:1.1.1.%ld", Probe_Type_Text(_strategy->type), (long)(1 + i));
+          if (Probe_Parse_Target(text, 80, &target, NULL)) Monitor_Add_Parsed(&monitor, &target);
+     }
+
+     bench_start = sim_now;
+     bench_shown = -1;
+     bench_offline_at = 0;
+     bench_detected_since = 0;
+
+     TIME_US start = sim_now;
+     TIME_US end = start + (TIME_US)_hours * 3600 * 1000000;
+
+     Monitor_Start(&monitor);
+
+     // Same loop shape as the backends.
+     while (sim_now < end)
+     {
+          struct Net_Watch watch[MONITOR_MAX_WATCH];
+          LONG count = Monitor_Watch(&monitor, watch, MONITOR_MAX_WATCH);
+
+          TIME_US deadline = Wheel_Next(&wheel);
+          TIME_US wait = deadline > sim_now ? deadline - sim_now : 0;
+
+          LONG ready = Net_Wait(watch, count, wait / 1000000, wait % 1000000, NULL);
+
+          if (ready > 0) Monitor_Service(&monitor, watch, count);
+          if (sim_now >= Wheel_Next(&wheel)) Wheel_Advance(&wheel, sim_now);
+     }
+
+     Monitor_Stop(&monitor);
+
+     bench_result.outages += Sim_Outages(start, end);
+     bench_result.probes += monitor.probe_count;
+     bench_result.connects += sim_connects;
+     bench_result.wakeups += sim_wakeups;
+}
+
+static void Bench_Print(const struct Bench_Strategy *_strategy, LONG _runs, LONG _hours)
+{
+     struct Bench_Result *result = &bench_result;
+     double hours = (double)_runs * _hours;
+
+     printf("  %-30s", _strategy->name);
+
+     if (result->down_count) printf(" %6.1f %6.1f", result->down_sum / result->down_count, result->down_max);
+     else                    printf(" %6s %6s", "-", "-");
+
+     LONG missed = (LONG)result->outages - (LONG)result->down_count;
+     printf(" %6.1f%%", result->outages ? 100.0 * (missed > 0 ? missed : 0) / result->outages : 0.0);
+
+     if (result->up_count) printf(" %6.1f %6.1f", result->up_sum / result->up_count, result->up_max);
+     else                  printf(" %6s %6s", "-", "-");
+
+     printf(" %7.2f", result->false_offline * 24.0 / hours);
+     printf(" %7.0f %7.0f %7.0f\n", result->probes / hours, result->connects / hours, result->wakeups / hours);
+}
+
+static void Usage(void)
+{
+     fprintf(stderr, "Usage: bench [-r runs] [-h hours_per_run]\n");
+}
+
+int main(int argc, char **argv)
+{
+     LONG runs = DEF_RUNS;
+     LONG hours = DEF_HOURS;
+
+     int opt;
+     while ((opt = getopt(argc, argv, "r:h:")) != -1)
+     {
+          switch (opt)
+          {
+               case 'r': runs = atoi(optarg); break;
+               case 'h': hours = atoi(optarg); break;
+               default:  Usage(); return 1;
+          }
+     }
+
+     if (runs < 1)  runs = DEF_RUNS;
+     if (hours < 1) hours = DEF_HOURS;
+
+     if (!Bench_Wheel_Check())
+     {
+          fprintf(stderr, "bench: timer wheel check failed\n");
+          return 1;
+     }
+
+     clock_t started = clock();
+
+     printf("%ld runs of %ld h per line, times in seconds\n", (long)runs, (long)hours);
+
+     for (LONG s = 0; s < BENCH_SCRIPTS; s++)
+     {
+          printf("\n%s\n", bench_script[s].name);
+          printf("  %-30s %6s %6s %7s %6s %6s %7s %7s %7s %7s\n", "strategy", "DOWN", "max", "MISSED", "UP", "max", "FALSE/d", "probe/h", "conn/h", "wake/h");
+
+          for (LONG p = 0; p < BENCH_STRATEGIES; p++)
+          {
+               struct Bench_Result empty = { 0 };
+               bench_result = empty;
+
+               for (LONG r = 0; r < runs; r++) Bench_Run(&bench_strategy[p], &bench_script[s], r + 1, hours);
+
+               Bench_Print(&bench_strategy[p], runs, hours);
+          }
+     }
+
+     double seconds = (double)(clock() - started) / CLOCKS_PER_SEC;
+     double simulated = (double)runs * hours * 3600 * BENCH_SCRIPTS * BENCH_STRATEGIES;
+
+     printf("\n%.0f simulated hours in %.2f s (%.0fx real time)\n", simulated / 3600, seconds, seconds > 0 ? simulated / seconds : 0);
+
+     return 0;
+}
@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+# ---------------------------------------------------------
+# msInternetStatus - control latency check
+#
+# Starts the POSIX daemon against a loopback listener that
+# never answers - its backlog is full, so the SYNs of the
+# probe are dropped - and sends "status" lines on stdin while
+# the probe waits for its timeout. Every answer has to come
+# back within the bound, the probe in flight must not hold
+# up the loop:
+#
+#   python3 bench/control.py [-n lines] [-b bound_ms] [./msInternetStatus]
+#
+# Exits with 1 if an answer took longer than the bound.
+# ---------------------------------------------------------
+
+import argparse
+import select
+import socket
+import subprocess
+import sys
+import time
+
+DEF_LINES = 20
+DEF_BOUND_MS = 20
+DEF_TIMEOUT = 5
+
+
+def blackhole():
+    """A listener that takes one connection and drops the SYNs of all later ones."""
+    listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    listener.bind(("127.0.0.1", 0))
+    listener.listen(0)
+    filler = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    filler.connect(listener.getsockname())
+    return listener, filler
+
+
+def read_line(stream, timeout):
+    ready, _, _ = select.select([stream], [], [], timeout)
+    return stream.readline() if ready else b""
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Control message latency of msInternetStatus while a probe is in flight.")
+    parser.add_argument("-n", type=int, default=DEF_LINES, help="status lines sent (%d)" % DEF_LINES)
+    parser.add_argument("-b", type=float, default=DEF_BOUND_MS, help="bound in ms (%d)" % DEF_BOUND_MS)
+    parser.add_argument("binary", nargs="?", default="./msInternetStatus")
+    args = parser.parse_args()
+
+    listener, filler = blackhole()
+    target = "127.0.0.1:%d" % listener.getsockname()[1]
+
+    # The first probe goes out at once and waits DEF_TIMEOUT seconds - all lines are sent before that.
+    process = subprocess.Popen([args.binary, "-i", str(DEF_TIMEOUT * 2), "-t", str(DEF_TIMEOUT), target],
+                               stdin=subprocess.PIPE, stdout=subprocess.PIPE, bufsize=0)
+    latency = []
+    ok = True
+
+    try:
+        time.sleep(0.5)
+        start = time.monotonic()
+
+        for _ in range(args.n):
+            sent = time.monotonic()
+            process.stdin.write(b"status\n")
+            line = read_line(process.stdout, DEF_TIMEOUT)
+            if line.strip() not in (b"...", b"Online", b"Offline"):
+                print("control: no answer to \"status\", got %r" % line)
+                return 1
+            latency.append((time.monotonic() - sent) * 1000)
+            time.sleep(0.1)
+
+        in_flight = time.monotonic() - start + 0.5 < DEF_TIMEOUT
+        process.stdin.write(b"quit\n")
+        process.wait(DEF_TIMEOUT)
+    finally:
+        if process.poll() is None:
+            process.kill()
+            process.wait()
+        filler.close()
+        listener.close()
+
+    latency.sort()
+    print("CONTROL    %d lines while a probe waited for %s: p50 %.3f ms, max %.3f ms (bound %.1f ms)" % (len(latency), target,
+          latency[len(latency) // 2], latency[-1], args.b))
+
+    if not in_flight:
+        print("control: the lines took longer than the probe timeout, the probe was not in flight for all of them")
+        ok = False
+    if latency[-1] > args.b:
+        print("control: an answer took longer than %.1f ms" % args.b)
+        ok = False
+
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,235 @@
+#!/usr/bin/env python3
+# ---------------------------------------------------------
+# msInternetStatus - loopback driver
+#
+# Runs two copies of the POSIX daemon on one host, sharing
+# one prober over -s 127.255.255.255, against a local HTTP
+# target that can be switched between 204 and 500:
+#
+#   LOAD      - probes per second the target sees while both run
+#   NOTIFY    - seconds until all -l subscribers of the follower
+#               hear a change, then of the new leader
+#   TAKEOVER  - seconds from a kill -9 of the leader until the
+#               follower says "leader"
+#   SCRAPE    - /metrics and /json of the survivor over curl
+#
+#   cc -std=gnu99 -O2 -o msInternetStatus src/main_posix.c ...
+#   python3 bench/loopback.py [-n clients] [-i interval] [./msInternetStatus]
+#
+# Exits with 1 if a step did not happen in time.
+# ---------------------------------------------------------
+
+import argparse
+import json
+import os
+import selectors
+import shutil
+import signal
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+DEF_CLIENTS = 64
+DEF_INTERVAL = 1
+
+target_up = True
+target_requests = 0
+
+
+class Target(BaseHTTPRequestHandler):
+    def answer(self):
+        global target_requests
+        target_requests += 1
+        self.send_response(204 if target_up else 500)
+        self.send_header("Content-Length", "0")
+        self.end_headers()
+
+    do_HEAD = answer
+    do_GET = answer
+
+    def log_message(self, *args):
+        pass
+
+
+def free_port(kind):
+    with socket.socket(socket.AF_INET, kind) as s:
+        s.bind(("127.0.0.1", 0))
+        return s.getsockname()[1]
+
+
+def read_var(directory, name):
+    try:
+        with open(os.path.join(directory, name)) as f:
+            return f.read().strip()
+    except OSError:
+        return ""
+
+
+def wait_for(test, timeout):
+    start = time.monotonic()
+    while time.monotonic() - start < timeout:
+        if test():
+            return time.monotonic() - start
+        time.sleep(0.02)
+    return None
+
+
+class Subscribers:
+    """N Unix socket clients, each with the latest status it was told."""
+
+    def __init__(self, path, count):
+        self.selector = selectors.DefaultSelector()
+        self.status = {}
+        self.pending = {}
+        for _ in range(count):
+            s = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            s.connect(path)
+            s.sendall(b"subscribe\n")
+            s.setblocking(False)
+            self.selector.register(s, selectors.EVENT_READ)
+            self.status[s] = None
+            self.pending[s] = b""
+
+    def poll(self, timeout):
+        for key, _ in self.selector.select(timeout):
+            s = key.fileobj
+            data = s.recv(4096)
+            if not data:
+                self.selector.unregister(s)
+                self.status.pop(s)
+                continue
+            self.pending[s] += data
+            while b"\n" in self.pending[s]:
+                line, self.pending[s] = self.pending[s].split(b"\n", 1)
+                words = line.decode().split()
+                if len(words) >= 2 and words[0] in ("STATE", "CHANGED"):
+                    self.status[s] = words[1]
+
+    def wait_all(self, status, timeout):
+        """Seconds until every client was told status, None if not in time."""
+        start = time.monotonic()
+        while time.monotonic() - start < timeout:
+            self.poll(0.02)
+            if self.status and all(v == status for v in self.status.values()):
+                return time.monotonic() - start
+        return None
+
+    def close(self):
+        for s in list(self.status):
+            s.close()
+
+
+def start(binary, name, work, share, interval, target):
+    directory = os.path.join(work, name)
+    os.mkdir(directory)
+    http_port = free_port(socket.SOCK_STREAM)
+    notify = os.path.join(work, name + ".sock")
+    process = subprocess.Popen([binary, "-q", "-i", str(interval), "-s", share, "-e", directory, "-l", notify,
+                                "-w", "127.0.0.1:%d" % http_port, target],
+                               stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL)
+    return process, directory, notify, http_port
+
+
+def report(label, value, unit="s"):
+    text = "%.2f %s" % (value, unit) if value is not None else "not in time"
+    print("%-10s %s" % (label, text))
+    return value is not None
+
+
+def main():
+    global target_up, target_requests
+
+    parser = argparse.ArgumentParser(description="Two sharing copies of msInternetStatus on loopback.")
+    parser.add_argument("-n", type=int, default=DEF_CLIENTS, help="notify clients (%d)" % DEF_CLIENTS)
+    parser.add_argument("-i", type=int, default=DEF_INTERVAL, help="TIME_INTERVAL in seconds (%d)" % DEF_INTERVAL)
+    parser.add_argument("binary", nargs="?", default="./msInternetStatus")
+    args = parser.parse_args()
+
+    server = ThreadingHTTPServer(("127.0.0.1", 0), Target)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    target = "http:127.0.0.1:%d/=204" % server.server_address[1]
+    share = "127.255.255.255:%d" % free_port(socket.SOCK_DGRAM)
+
+    # Long enough for the first one to lead and the second one to hear it.
+    settle = 4 * args.i + 1
+    work = tempfile.mkdtemp(prefix="msis-loopback-")
+    processes = []
+    ok = True
+
+    try:
+        first = start(args.binary, "first", work, share, args.i, target)
+        processes.append(first[0])
+        time.sleep(1.5 * args.i)
+        second = start(args.binary, "second", work, share, args.i, target)
+        processes.append(second[0])
+
+        roles = {}
+        elected = wait_for(lambda: sorted(r.split()[0] for r in [read_var(first[1], "msInternetStatus_SHARE"),
+                                                                   read_var(second[1], "msInternetStatus_SHARE")] if r)
+                           == ["follower", "leader"], settle)
+        ok &= report("ELECTED", elected)
+        if elected is None:
+            return 1
+
+        for copy in (first, second):
+            roles[read_var(copy[1], "msInternetStatus_SHARE").split()[0]] = copy
+        leader, follower = roles["leader"], roles["follower"]
+
+        # Probes of both copies in one window - one prober means about one per interval.
+        window = 5 * args.i
+        target_requests = 0
+        time.sleep(window)
+        report("LOAD", target_requests / window, "probes/s (TIME_INTERVAL %d s, one prober)" % args.i)
+
+        clients = Subscribers(follower[2], args.n)
+        ok &= report("SUBSCRIBED", clients.wait_all("Online", settle))
+        print("%-10s %d clients" % ("", len(clients.status)))
+
+        target_up = False
+        ok &= report("NOTIFY", clients.wait_all("Offline", settle), "s to Offline, follower")
+        target_up = True
+        ok &= report("NOTIFY", clients.wait_all("Online", settle), "s to Online, follower")
+
+        leader[0].send_signal(signal.SIGKILL)
+        leader[0].wait()
+        takeover = wait_for(lambda: read_var(follower[1], "msInternetStatus_SHARE") == "leader", 6 * args.i + 2)
+        ok &= report("TAKEOVER", takeover, "s after kill -9 of the leader")
+
+        target_up = False
+        ok &= report("NOTIFY", clients.wait_all("Offline", settle), "s to Offline, new leader")
+        target_up = True
+        ok &= report("NOTIFY", clients.wait_all("Online", settle), "s to Online, new leader")
+        clients.poll(0)
+        print("%-10s %d clients still subscribed" % ("", len(clients.status)))
+        clients.close()
+
+        metrics = subprocess.run(["curl", "-s", "http://127.0.0.1:%d/metrics" % follower[3]], capture_output=True, text=True).stdout
+        values = {}
+        for line in metrics.splitlines():
+            if line and not line.startswith("#"):
+                name, value = line.rsplit(" ", 1)
+                values[name] = value
+        scrape = json.loads(subprocess.run(["curl", "-s", "http://127.0.0.1:%d/json" % follower[3]], capture_output=True, text=True).stdout)
+
+        print("%-10s status %s, share_sent %s, share_received %s, share_takeovers %s, json status %s" % ("SCRAPE",
+              values.get("msinternetstatus_status"), values.get('msinternetstatus_events_total{event="share_sent"}'),
+              values.get('msinternetstatus_events_total{event="share_received"}'),
+              values.get('msinternetstatus_events_total{event="share_takeovers"}'), scrape["status"]))
+        ok &= values.get("msinternetstatus_status") == "1" and scrape["status"] == "online"
+    finally:
+        for process in processes:
+            if process.poll() is None:
+                process.terminate()
+                process.wait()
+        server.shutdown()
+        shutil.rmtree(work, ignore_errors=True)
+
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
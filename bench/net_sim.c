@@ -0,0 +1,391 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - simulated network
+ * ---------------------------------------------------------*/
+
+#include "net_sim.h"
+
+#include <string.h>
+
+#define SIM_MAX_SOCKETS     64
+#define SIM_NEVER           (~(TIME_US)0)
+
+// SYN retransmits, as TCP does them - initial RTO of 1 s, doubled each time.
+#define SIM_SYN_TRIES       6
+
+struct Sim_Socket
+{
+     BYTE    used;
+     BYTE    udp;
+     BYTE    state;           // NET_CONNECT_* once answered.
+     TIME_US answer;          // When the answer comes, SIM_NEVER if it does not.
+     BYTE    portal;          // HTTP gets a redirect.
+     UBYTE   query[2];        // ID of the DNS query sent.
+};
+
+TIME_US sim_now;
+ULONG   sim_connects;
+ULONG   sim_wakeups;
+
+static const struct Sim_Script *sim_script;
+static TIME_US sim_origin;    // sim_now at Sim_Reset().
+static TIME_US sim_offset;    // Where in the script period the run starts.
+static ULONG   sim_random;
+
+static struct Sim_Socket sim_socket[SIM_MAX_SOCKETS];
+
+static ULONG Sim_Random(void)
+{
+     ULONG x = sim_random;
+
+     x ^= x << 13;
+     x ^= x >> 17;
+     x ^= x << 5;
+
+     sim_random = x;
+     return x;
+}
+
+void Sim_Reset(const struct Sim_Script *_script, ULONG _seed)
+{
+     sim_script = _script;
+     sim_random = _seed * 2654435761u | 1;
+
+     // Sched_Init() seeds itself from the clock - every run starts at another time.
+     // Far from zero, so periods that began before the run don't wrap around.
+     sim_now = ((TIME_US)1 << 40) + (TIME_US)_seed * 1000003;
+     sim_origin = sim_now;
+     sim_offset = (TIME_US)(Sim_Random() % (_script->period_s * 1000)) * 1000;
+
+     sim_connects = 0;
+     sim_wakeups = 0;
+
+     memset(sim_socket, 0, sizeof(sim_socket));
+}
+
+static TIME_US Sim_Period(void)
+{
+     return (TIME_US)sim_script->period_s * 1000000;
+}
+
+// Phase at _time, NULL where the script says nothing (SIM_UP).
+static const struct Sim_Phase* Sim_Phase_At(TIME_US _time, TIME_US *_period_start)
+{
+     TIME_US in_period = (_time - sim_origin + sim_offset) % Sim_Period();
+
+     *_period_start = _time - in_period;
+
+     for (LONG i = 0; i < sim_script->phase_count; i++)
+     {
+          const struct Sim_Phase *phase = &sim_script->phase[i];
+
+          if (in_period >= (TIME_US)phase->start_s * 1000000 && in_period < (TIME_US)phase->end_s * 1000000)
+               return phase;
+     }
+
+     return NULL;
+}
+
+static BYTE Sim_Condition_Up(UBYTE _condition)
+{
+     return _condition != SIM_DOWN && _condition != SIM_UNREACHABLE && _condition != SIM_PORTAL;
+}
+
+BYTE Sim_Truth(TIME_US _time, TIME_US *_since)
+{
+     TIME_US period_start;
+     const struct Sim_Phase *phase = Sim_Phase_At(_time, &period_start);
+
+     if (phase && !Sim_Condition_Up(phase->condition))
+     {
+          *_since = period_start + (TIME_US)phase->start_s * 1000000;
+          return 0;
+     }
+
+     // Up since the end of the latest down phase - in this period or the one before.
+     TIME_US in_period = _time - period_start;
+
+     *_since = sim_origin;
+
+     for (LONG back = 0; back < 2; back++)
+     {
+          for (LONG i = sim_script->phase_count - 1; i >= 0; i--)
+          {
+               const struct Sim_Phase *down = &sim_script->phase[i];
+               TIME_US end = (TIME_US)down->end_s * 1000000;
+
+               if (Sim_Condition_Up(down->condition)) continue;
+               if (back == 0 && end > in_period) continue;
+
+               TIME_US since = period_start + end - back * Sim_Period();
+               if (since > sim_origin) *_since = since;
+               return 1;
+          }
+     }
+
+     return 1;
+}
+
+LONG Sim_Outages(TIME_US _from, TIME_US _to)
+{
+     LONG count = 0;
+     TIME_US period_start;
+
+     Sim_Phase_At(_from, &period_start);
+
+     for (; period_start < _to; period_start += Sim_Period())
+     {
+          for (LONG i = 0; i < sim_script->phase_count; i++)
+          {
+               const struct Sim_Phase *phase = &sim_script->phase[i];
+               TIME_US start = period_start + (TIME_US)phase->start_s * 1000000;
+
+               if (!Sim_Condition_Up(phase->condition) && start >= _from && start < _to) count++;
+          }
+     }
+
+     return count;
+}
+
+// Virtual clock instead of the backend one.
+TIME_US Platform_Time(void)
+{
+     return sim_now;
+}
+
+BYTE Net_Open(void)
+{
+     return 1;
+}
+
+void Net_Close(void)
+{
+}
+
+BYTE Net_Lost(void)
+{
+     return 0;
+}
+
+ULONG Net_Open_Count(void)
+{
+     return 1;
+}
+
+// The simulated path is IPv4 only - bench targets are addresses.
+BYTE Net_Ipv6(void)
+{
+     return 0;
+}
+
+static TIME_US Sim_Latency(void)
+{
+     TIME_US latency = (TIME_US)sim_script->latency_ms * 1000;
+     ULONG jitter = sim_script->jitter_ms * 1000;
+
+     if (jitter) latency = latency - jitter + Sim_Random() % (2 * jitter + 1);
+     return latency;
+}
+
+static LONG Sim_Open(BYTE _udp, BYTE *_state)
+{
+     *_state = NET_CONNECT_FAILED;
+
+     LONG socket = 0;
+     while (socket < SIM_MAX_SOCKETS && sim_socket[socket].used) socket++;
+     if (socket == SIM_MAX_SOCKETS) return NET_NO_SOCKET;
+
+     struct Sim_Socket *sim = &sim_socket[socket];
+     TIME_US period_start;
+     const struct Sim_Phase *phase = Sim_Phase_At(sim_now, &period_start);
+
+     sim->used = 1;
+     sim->udp = _udp;
+     sim->portal = 0;
+     sim->state = NET_CONNECT_DONE;
+     sim->answer = sim_now + Sim_Latency();
+
+     // The whole handshake follows the condition at the time of the SYN.
+     switch (phase ? phase->condition : SIM_UP)
+     {
+          case SIM_DOWN:
+               sim->answer = SIM_NEVER;
+               break;
+
+          case SIM_UNREACHABLE:
+               sim->state = NET_CONNECT_UNREACHABLE;
+               break;
+
+          case SIM_RST:
+               sim->state = NET_CONNECT_REFUSED;
+               break;
+
+          case SIM_SLOW:
+               sim->answer = sim_now + (TIME_US)sim_script->slow_ms * 1000;
+               break;
+
+          case SIM_LOSS:
+          {
+               TIME_US resend = 0, rto = 1000000;
+               LONG try;
+
+               for (try = 0; try < (_udp ? 1 : SIM_SYN_TRIES); try++, resend += rto, rto *= 2)
+                    if ((LONG)(Sim_Random() % 100) >= sim_script->loss_percent) break;
+
+               sim->answer = try < (_udp ? 1 : SIM_SYN_TRIES) ? sim->answer + resend : SIM_NEVER;
+               break;
+          }
+
+          case SIM_PORTAL:
+               sim->portal = 1;
+               break;
+     }
+
+     sim_connects++;
+
+     // connect() on UDP is local - the answer is to the query sent right after.
+     *_state = _udp ? NET_CONNECT_DONE : NET_CONNECT_PENDING;
+     return socket;
+}
+
+LONG Net_Tcp_Connect_Start(ULONG _ip, UWORD _port, BYTE *_state)
+{
+     (void)_ip;
+     (void)_port;
+
+     return Sim_Open(0, _state);
+}
+
+BYTE Net_Tcp_Connect_State(LONG _socket, UBYTE _ready)
+{
+     (void)_ready;
+
+     if (sim_now < sim_socket[_socket].answer) return NET_CONNECT_PENDING;
+     return sim_socket[_socket].state;
+}
+
+LONG Net_Udp_Open(ULONG _ip, UWORD _port, BYTE *_state)
+{
+     (void)_ip;
+     (void)_port;
+
+     return Sim_Open(1, _state);
+}
+
+LONG Net_Tcp_Connect_Start6(const UBYTE *_ip6, UWORD _port, BYTE *_state)
+{
+     (void)_ip6;
+     (void)_port;
+
+     *_state = NET_CONNECT_FAILED;
+     return NET_NO_SOCKET;
+}
+
+LONG Net_Udp_Open6(const UBYTE *_ip6, UWORD _port, BYTE *_state)
+{
+     (void)_ip6;
+     (void)_port;
+
+     *_state = NET_CONNECT_FAILED;
+     return NET_NO_SOCKET;
+}
+
+LONG Net_Send(LONG _socket, const void *_data, LONG _length, BYTE *_state)
+{
+     struct Sim_Socket *sim = &sim_socket[_socket];
+
+     (void)_state;
+
+     // UDP - the query ID comes back in the reply. TCP - a request after
+     // the handshake, the reply takes one more round trip.
+     if (sim->udp) memcpy(sim->query, _data, 2);
+     else          sim->answer = sim_now + Sim_Latency();
+
+     return _length;
+}
+
+LONG Net_Receive(LONG _socket, void *_buffer, LONG _size, BYTE *_state)
+{
+     struct Sim_Socket *sim = &sim_socket[_socket];
+     UBYTE *reply = _buffer;
+
+     if (sim_now < sim->answer)
+     {
+          *_state = NET_CONNECT_PENDING;
+          return -1;
+     }
+
+     // ICMP errors show up on the next receive.
+     if (sim->state != NET_CONNECT_DONE)
+     {
+          *_state = sim->state;
+          return -1;
+     }
+
+     if (sim->udp)
+     {
+          if (_size < 12) return 0;
+
+          memset(reply, 0, 12);
+          memcpy(reply, sim->query, 2);
+          reply[2] = 0x81;              // Response, recursion desired.
+          reply[3] = 0x80;              // Recursion available, NOERROR.
+          return 12;
+     }
+
+     const char *status = sim->portal ? "HTTP/1.0 302 Found\r\n" : "HTTP/1.0 204 No Content\r\n";
+     LONG length = strlen(status) < (size_t)_size ? (LONG)strlen(status) : _size;
+
+     memcpy(reply, status, length);
+     return length;
+}
+
+void Net_Close_Socket(LONG _socket)
+{
+     if (_socket == NET_NO_SOCKET) return;
+
+     sim_socket[_socket].used = 0;
+}
+
+// Jumps the clock to the first answer or to the timeout - whichever comes first.
+LONG Net_Wait(struct Net_Watch *_watch, LONG _count, LONG _sec, LONG _micro, ULONG *_signals)
+{
+     TIME_US limit = _sec < 0 ? SIM_NEVER : sim_now + (TIME_US)_sec * 1000000 + _micro;
+     TIME_US next = SIM_NEVER;
+
+     for (LONG i = 0; i < _count; i++)
+     {
+          _watch[i].ready = 0;
+          if (_watch[i].socket == NET_NO_SOCKET) continue;
+
+          if (sim_socket[_watch[i].socket].answer < next) next = sim_socket[_watch[i].socket].answer;
+     }
+
+     if (_signals) *_signals = 0;
+
+     sim_wakeups++;
+
+     if (next > limit)
+     {
+          if (limit != SIM_NEVER) sim_now = limit;
+          return 0;
+     }
+
+     if (next > sim_now) sim_now = next;
+
+     LONG rc = 0;
+
+     for (LONG i = 0; i < _count; i++)
+     {
+          if (_watch[i].socket == NET_NO_SOCKET) continue;
+
+          struct Sim_Socket *sim = &sim_socket[_watch[i].socket];
+          if (sim->answer > sim_now) continue;
+
+          // Like poll() - a failed connect is writable and in error.
+          _watch[i].ready = _watch[i].want;
+          if (sim->state != NET_CONNECT_DONE) _watch[i].ready |= NET_EVENT_ERROR;
+          rc++;
+     }
+
+     return rc;
+}
@@ -0,0 +1,62 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - simulated network
+ *
+ * Replaces src/net.c and the backend clock for the benchmark.
+ * Time is virtual: Net_Wait() does not sleep, it jumps to the
+ * next answer or to its timeout. Connects and DNS queries are
+ * answered as the script says for the moment they were issued,
+ * HTTP requests get a status line one more round trip later.
+ * ---------------------------------------------------------*/
+
+#ifndef NET_SIM_H
+#define NET_SIM_H
+
+#include "platform.h"
+#include "net.h"
+
+// Network conditions.
+#define SIM_UP              0    // SYN-ACK after the normal latency.
+#define SIM_DOWN            1    // Blackhole - nothing comes back.
+#define SIM_UNREACHABLE     2    // ICMP unreachable after the latency.
+#define SIM_RST             3    // Hosts answer with RST - reachable.
+#define SIM_SLOW            4    // SYN-ACK, but slow_ms late.
+#define SIM_LOSS            5    // Each SYN lost with loss_percent chance, resent as TCP does. UDP is not resent.
+#define SIM_PORTAL          6    // Captive portal - connects and DNS work, HTTP gets a redirect. Down.
+
+struct Sim_Phase
+{
+     ULONG start_s;           // Seconds from the period start.
+     ULONG end_s;
+     UBYTE condition;         // SIM_*
+};
+
+// Phases repeat every period_s, SIM_UP where none is given.
+// Phases are sorted and phases of the same truth (up or down) must not touch.
+struct Sim_Script
+{
+     const char       *name;
+     ULONG             period_s;
+     struct Sim_Phase  phase[4];
+     LONG              phase_count;
+
+     ULONG latency_ms;        // SYN to answer.
+     ULONG jitter_ms;         // +/- on the latency.
+     ULONG slow_ms;           // SIM_SLOW latency.
+     LONG  loss_percent;      // SIM_LOSS chance.
+};
+
+// Virtual clock and what the probes cost.
+extern TIME_US sim_now;
+extern ULONG   sim_connects;
+extern ULONG   sim_wakeups;
+
+// Starts a new run - the seed moves the clock, the script phase and the loss dice.
+void Sim_Reset(const struct Sim_Script *_script, ULONG _seed);
+
+// Returns 1 if the Internet is really reachable at _time, and since when that is so.
+BYTE Sim_Truth(TIME_US _time, TIME_US *_since);
+
+// Number of outages (up to down changes) in [_from, _to).
+LONG Sim_Outages(TIME_US _from, TIME_US _to);
+
+#endif
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+# ---------------------------------------------------------
+# msInternetStatus - per-tick latency against many targets
+#
+# Starts the POSIX daemon with -p all against N loopback
+# listeners, once for every N given, and takes the latency
+# of each tick from its STATUS lines - the RTT of the answer
+# that completes the policy, with -p all the last of the N
+# targets. All targets wait in one poll() set, so it should
+# stay flat as N grows:
+#
+#   python3 bench/targets.py [-n 2,32] [-t ticks] [-b bound_ms] [./msInternetStatus]
+#
+# Exits with 1 if the p95 of a run is above the bound.
+# ---------------------------------------------------------
+
+import argparse
+import re
+import selectors
+import socket
+import subprocess
+import sys
+import threading
+
+DEF_COUNTS = "2,32"
+DEF_TICKS = 10
+DEF_BOUND_MS = 20
+
+
+class Listeners:
+    """N listeners that accept and close every connection."""
+
+    def __init__(self, count):
+        self.selector = selectors.DefaultSelector()
+        self.sockets = []
+        self.running = True
+
+        for _ in range(count):
+            listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+            listener.bind(("127.0.0.1", 0))
+            listener.listen(16)
+            listener.setblocking(False)
+            self.selector.register(listener, selectors.EVENT_READ)
+            self.sockets.append(listener)
+
+        self.thread = threading.Thread(target=self.run, daemon=True)
+        self.thread.start()
+
+    def targets(self):
+        return ["127.0.0.1:%d" % s.getsockname()[1] for s in self.sockets]
+
+    def run(self):
+        while self.running:
+            for key, _ in self.selector.select(0.1):
+                try:
+                    connection, _ = key.fileobj.accept()
+                except BlockingIOError:
+                    continue
+                connection.close()
+
+    def close(self):
+        self.running = False
+        self.thread.join()
+        for s in self.sockets:
+            s.close()
+
+
+def run(binary, count, ticks):
+    """Latency of each tick in ms, None if the daemon stopped answering."""
+    listeners = Listeners(count)
+    process = subprocess.Popen([binary, "-i", "1", "-j", "0", "-t", "1", "-p", "all"] + listeners.targets(),
+                               stdin=subprocess.PIPE, stdout=subprocess.PIPE, bufsize=0)
+    latency = []
+
+    try:
+        # The first tick opens everything - it is not counted.
+        for tick in range(ticks + 1):
+            line = process.stdout.readline()
+            rtt = re.search(rb" RTT ([0-9.]+) ms", line)
+            if not line.startswith(b"STATUS") or not rtt:
+                return None
+            if tick > 0:
+                latency.append(float(rtt.group(1)))
+    finally:
+        process.kill()
+        process.wait()
+        listeners.close()
+
+    return sorted(latency)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Per-tick probe latency of msInternetStatus against N loopback listeners.")
+    parser.add_argument("-n", default=DEF_COUNTS, help="comma separated target counts (%s)" % DEF_COUNTS)
+    parser.add_argument("-t", type=int, default=DEF_TICKS, help="ticks per count (%d)" % DEF_TICKS)
+    parser.add_argument("-b", type=float, default=DEF_BOUND_MS, help="bound of the p95 in ms (%d)" % DEF_BOUND_MS)
+    parser.add_argument("binary", nargs="?", default="./msInternetStatus")
+    args = parser.parse_args()
+
+    ok = True
+
+    for count in [int(n) for n in args.n.split(",")]:
+        latency = run(args.binary, count, args.t)
+        if not latency:
+            print("targets: no STATUS lines with %d targets" % count)
+            ok = False
+            continue
+
+        p95 = latency[min(len(latency) - 1, (len(latency) * 95 + 99) // 100 - 1)]
+        print("TARGETS %3d  %d ticks: p50 %.1f ms, p95 %.1f ms, max %.1f ms" % (count, len(latency), latency[len(latency) // 2], p95, latency[-1]))
+
+        if p95 > args.b:
+            print("targets: p95 with %d targets is above %.1f ms" % (count, args.b))
+            ok = False
+
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
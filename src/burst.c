@@ -0,0 +1,203 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - burst loss sampling
+ * ---------------------------------------------------------*/
+
+#include "burst.h"
+#include "stats.h"
+
+#include <string.h>
+
+static void Burst_Finish(struct Burst *_burst);
+
+static void Burst_Expired(struct Wheel_Timer *_timer)
+{
+     Burst_Finish((struct Burst*)_timer->data);
+}
+
+void Burst_Init(struct Burst *_burst, LONG _probes, LONG _budget, struct Wheel *_wheel)
+{
+     memset(_burst, 0, sizeof(struct Burst));
+
+     if (_probes < 0) _probes = 0;
+     if (_probes > BURST_MAX_PROBES) _probes = BURST_MAX_PROBES;
+     if (_budget < 1) _budget = 1;
+
+     _burst->probes = _probes;
+     _burst->budget = _budget;
+     _burst->wheel = _wheel;
+
+     Probe_Init(&_burst->probe);
+     Wheel_Timer_Init(&_burst->timer, Burst_Expired, _burst);
+}
+
+void Burst_Start(struct Burst *_burst, const struct Probe *_targets, ULONG _timeout_us)
+{
+     if (_burst->probing || _burst->probes == 0 || _targets->target_count == 0) return;
+
+     struct Probe *probe = &_burst->probe;
+     LONG budget = _burst->budget;
+
+     Probe_Init(probe);
+     Probe_Set_Policy(probe, PROBE_POLICY_EVERY, 0);
+
+     for (LONG i = 0; i < _burst->probes; i++)
+     {
+          LONG index = i % _targets->target_count;
+          const struct Probe_Target *source = &_targets->target[index];
+          struct Probe_Target target = *source;
+
+          // Light probes only - HTTP is sampled by its handshake.
+          LONG cost = source->type == PROBE_TYPE_DNS ? BURST_COST_DNS : BURST_COST_TCP;
+          if (cost > budget) break;
+
+          if (target.type == PROBE_TYPE_HTTP) target.type = PROBE_TYPE_TCP;
+
+          // Address from the cache now - the copy must not look it up again.
+          if (target.name) target.families = Resolve_Address(target.name, &target.ip, target.ip6);
+          target.name = NULL;
+
+          if (target.families == 0) continue;
+
+          // One family per sample, the one that answered the latest probe - racing
+          // both would measure the race, not the path.
+          BYTE family = NET_FAMILY_V6;
+          if (source->family >= 0 && (target.families & (1 << source->family))) family = source->family;
+          else if (target.families & (1 << NET_FAMILY_V4))                    family = NET_FAMILY_V4;
+
+          target.families = 1 << family;
+
+          if (!Probe_Add_Parsed(probe, &target)) break;
+
+          _burst->source[probe->target_count - 1] = (UBYTE)index;
+          budget -= cost;
+     }
+
+     if (probe->target_count == 0) return;
+
+     _burst->probing = 1;
+     Probe_Start(probe);
+
+     if (probe->in_flight == 0)
+     {
+          Burst_Finish(_burst);
+          return;
+     }
+
+     Wheel_Add(_burst->wheel, &_burst->timer, Platform_Time() + _timeout_us);
+}
+
+LONG Burst_Watch(struct Burst *_burst, struct Net_Watch *_watch, LONG _max)
+{
+     if (!_burst->probing) return 0;
+
+     return Probe_Watch(&_burst->probe, _watch, _max);
+}
+
+void Burst_Service(struct Burst *_burst, struct Net_Watch *_watch, LONG _count)
+{
+     if (!_burst->probing) return;
+
+     Probe_Service(&_burst->probe, _watch, _count);
+
+     if (_burst->probe.in_flight == 0) Burst_Finish(_burst);
+}
+
+// Ends the tick - what is still in flight is lost - and moves the window on.
+static void Burst_Finish(struct Burst *_burst)
+{
+     struct Probe *probe = &_burst->probe;
+     struct Burst_Tick tick;
+
+     Wheel_Cancel(_burst->wheel, &_burst->timer);
+     Probe_Finish(probe);
+     _burst->probing = 0;
+
+     memset(&tick, 0, sizeof(tick));
+
+     for (LONG i = 0; i < probe->target_count; i++)
+     {
+          struct Probe_Target *target = &probe->target[i];
+          ULONG *last_rtt = &_burst->last_rtt[_burst->source[i]];
+
+          switch (target->status)
+          {
+               case IP_STATUS_CONNECTED:
+               case IP_STATUS_REFUSED:
+                    // Difference to the previous sample of the same target, as RFC 3550 takes it.
+                    if (*last_rtt)
+                    {
+                         tick.jitter_sum += target->rtt > *last_rtt ? target->rtt - *last_rtt : *last_rtt - target->rtt;
+                         tick.jitter_count++;
+                    }
+                    *last_rtt = target->rtt;
+                    tick.sent++;
+                    break;
+
+               case IP_STATUS_UNEXPECTED:
+                    tick.sent++;
+                    break;
+
+               case IP_STATUS_TIMEOUT:
+               case IP_STATUS_UNREACHABLE:
+                    tick.sent++;
+                    tick.lost++;
+                    break;
+
+               // Not sent - no socket, no address.
+               default:
+                    break;
+          }
+     }
+
+     Stats_Count(STATS_BURSTS);
+     stats.counter[STATS_BURST_SENT] += tick.sent;
+     stats.counter[STATS_BURST_LOST] += tick.lost;
+
+     // Window full - the oldest tick leaves the sums.
+     struct Burst_Tick *slot = &_burst->tick[_burst->next];
+
+     if (_burst->ticks == BURST_WINDOW)
+     {
+          _burst->sent -= slot->sent;
+          _burst->lost -= slot->lost;
+          _burst->jitter_sum -= slot->jitter_sum;
+          _burst->jitter_count -= slot->jitter_count;
+     }
+     else _burst->ticks++;
+
+     *slot = tick;
+     _burst->sent += tick.sent;
+     _burst->lost += tick.lost;
+     _burst->jitter_sum += tick.jitter_sum;
+     _burst->jitter_count += tick.jitter_count;
+
+     _burst->next = (_burst->next + 1) % BURST_WINDOW;
+}
+
+void Burst_Stop(struct Burst *_burst)
+{
+     if (_burst->probing) Probe_Finish(&_burst->probe);
+     Wheel_Cancel(_burst->wheel, &_burst->timer);
+
+     _burst->probing = 0;
+     _burst->ticks = 0;
+     _burst->next = 0;
+     _burst->sent = _burst->lost = 0;
+     _burst->jitter_sum = _burst->jitter_count = 0;
+
+     memset(_burst->last_rtt, 0, sizeof(_burst->last_rtt));
+}
+
+LONG Burst_Loss(struct Burst *_burst)
+{
+     if (_burst->sent == 0) return -1;
+
+     return (LONG)((_burst->lost * 1000 + _burst->sent / 2) / _burst->sent);
+}
+
+ULONG Burst_Jitter(struct Burst *_burst)
+{
+     if (_burst->jitter_count == 0) return 0;
+
+     return _burst->jitter_sum / _burst->jitter_count;
+}
@@ -0,0 +1,79 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - burst loss sampling
+ *
+ * A probe says online or offline, not how well - a line that
+ * drops every fifth packet still answers. In burst mode each
+ * probe is joined by K light probes (TCP connects, single
+ * queries for DNS targets) spread over the targets and
+ * waited for in the same select set. How many come back
+ * gives the loss, how much their round trip times differ
+ * from the previous sample of the same target the jitter.
+ * Both are kept over a window of recent ticks.
+ *
+ * A packet budget caps what one tick may send, so a large K
+ * on many targets never turns into a flood.
+ * ---------------------------------------------------------*/
+
+#ifndef BURST_H
+#define BURST_H
+
+#include "platform.h"
+#include "probe.h"
+#include "wheel.h"
+
+#define BURST_MAX_PROBES      16    // K per tick.
+#define BURST_WINDOW          20    // Ticks the loss and jitter are taken over.
+
+// Packets a light probe sends at most - SYN, ACK and FIN of a connect, one query.
+#define BURST_COST_TCP        3
+#define BURST_COST_DNS        1
+
+struct Burst_Tick
+{
+     UBYTE sent;              // Probes that went out.
+     UBYTE lost;              // Of them without an answer.
+     UBYTE jitter_count;      // RTT differences in jitter_sum.
+     ULONG jitter_sum;        // Microseconds.
+};
+
+struct Burst
+{
+     struct Probe        probe;
+     UBYTE               source[BURST_MAX_PROBES];   // Target of the monitor each probe samples.
+     ULONG               last_rtt[PROBE_MAX_TARGETS]; // Latest sample of each target, 0 - none.
+     LONG                probes;        // K, 0 - off.
+     LONG                budget;        // Packets per tick.
+     BYTE                probing;
+     struct Wheel       *wheel;
+     struct Wheel_Timer  timer;         // Timeout of the probes in flight.
+
+     struct Burst_Tick   tick[BURST_WINDOW];
+     LONG                ticks;         // Ticks in the window.
+     LONG                next;          // Slot the next tick goes to.
+     ULONG               sent;          // Sums over the window.
+     ULONG               lost;
+     ULONG               jitter_sum;
+     ULONG               jitter_count;
+};
+
+// _probes and _budget are clamped to 0..BURST_MAX_PROBES and at least one probe.
+void Burst_Init(struct Burst *_burst, LONG _probes, LONG _budget, struct Wheel *_wheel);
+
+// Fires the probes of a tick at the targets of _targets, round robin. Does nothing
+// while the previous tick is still in flight.
+void Burst_Start(struct Burst *_burst, const struct Probe *_targets, ULONG _timeout_us);
+
+// Same as Probe_Watch() and Probe_Service(). The tick ends when nothing is in flight.
+LONG Burst_Watch(struct Burst *_burst, struct Net_Watch *_watch, LONG _max);
+void Burst_Service(struct Burst *_burst, struct Net_Watch *_watch, LONG _count);
+
+// Drops the probes in flight and the window.
+void Burst_Stop(struct Burst *_burst);
+
+// Loss over the window in tenths of a percent, -1 if nothing was sent yet.
+LONG  Burst_Loss(struct Burst *_burst);
+
+// Mean jitter over the window in microseconds, 0 without two answers of a target.
+ULONG Burst_Jitter(struct Burst *_burst);
+
+#endif
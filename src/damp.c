@@ -0,0 +1,63 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - flap damping
+ * ---------------------------------------------------------*/
+
+#include "damp.h"
+
+void Damp_Init(struct Damp *_damp, LONG _failures, LONG _window, LONG _successes)
+{
+     if (_window < 1) _window = 1;
+     if (_window > DAMP_WINDOW_MAX) _window = DAMP_WINDOW_MAX;
+     if (_failures < 1) _failures = 1;
+     if (_failures > _window) _failures = _window;
+     if (_successes < 1) _successes = 1;
+     if (_successes > 255) _successes = 255;
+
+     _damp->failures_needed = (UBYTE)_failures;
+     _damp->window = (UBYTE)_window;
+     _damp->successes_needed = (UBYTE)_successes;
+
+     Damp_Reset(_damp);
+}
+
+void Damp_Reset(struct Damp *_damp)
+{
+     _damp->history = 0;
+     _damp->results = 0;
+     _damp->failures = 0;
+     _damp->successes = 0;
+     _damp->state = -1;
+}
+
+BYTE Damp_Add(struct Damp *_damp, BYTE _online)
+{
+     // Oldest result leaves the window as the new one comes in.
+     if (_damp->results == _damp->window) _damp->failures -= (_damp->history >> (_damp->window - 1)) & 1;
+     else _damp->results++;
+
+     _damp->history = (_damp->history << 1) | (_online ? 0 : 1);
+     if (_damp->window < DAMP_WINDOW_MAX) _damp->history &= (1UL << _damp->window) - 1;
+
+     if (_online)
+     {
+          if (_damp->successes < _damp->successes_needed) _damp->successes++;
+     }
+     else
+     {
+          _damp->failures++;
+          _damp->successes = 0;
+     }
+
+     // Nothing shown yet - there is nothing to flap from.
+     if (_damp->state < 0) _damp->state = _online;
+     else if (_damp->state && _damp->failures >= _damp->failures_needed) _damp->state = 0;
+     else if (!_damp->state && _damp->successes >= _damp->successes_needed)
+     {
+          // Back online - the failures of the outage must not vote it down again.
+          _damp->state = 1;
+          _damp->history = 0;
+          _damp->failures = 0;
+     }
+
+     return _damp->state;
+}
@@ -0,0 +1,43 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - flap damping
+ *
+ * Sits between the raw probe results and the published
+ * status. Going offline takes FLAP_FAILURES failed probes
+ * out of the last FLAP_WINDOW, coming back takes
+ * FLAP_SUCCESSES answered ones in a row - a single lost SYN
+ * does not wake up everything watching the ENV variable.
+ *
+ * The window is a bit mask with a running count of its
+ * failures, so a result costs a shift and two adds.
+ * ---------------------------------------------------------*/
+
+#ifndef DAMP_H
+#define DAMP_H
+
+#include "platform.h"
+
+#define DAMP_WINDOW_MAX     32    // Bits in the history.
+
+struct Damp
+{
+     UBYTE failures_needed;  // Failures in the window that make it offline.
+     UBYTE window;           // Results voted over, 1..DAMP_WINDOW_MAX.
+     UBYTE successes_needed; // Answers in a row that make it online again.
+
+     ULONG history;          // Bit 0 - the latest result, set - failed.
+     UBYTE results;          // Results in the history, up to window.
+     UBYTE failures;         // Set bits of the history.
+     UBYTE successes;        // Answers in a row, up to successes_needed.
+     BYTE  state;            // Damped status: -1 unknown, 0 offline, 1 online.
+};
+
+// 1 of 1 and 1 in a row is no damping at all. Values are clamped to sense.
+void Damp_Init(struct Damp *_damp, LONG _failures, LONG _window, LONG _successes);
+
+// Forgets the history - the next result is taken as it is.
+void Damp_Reset(struct Damp *_damp);
+
+// Votes with a raw result (1 online, 0 offline). Returns the damped status.
+BYTE Damp_Add(struct Damp *_damp, BYTE _online);
+
+#endif
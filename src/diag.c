@@ -0,0 +1,274 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - path diagnosis
+ * ---------------------------------------------------------*/
+
+#include "diag.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void Diag_Init(struct Diag *_diag)
+{
+     for (BYTE hop = 0; hop < DIAG_HOPS; hop++)
+     {
+          Probe_Init(&_diag->hop[(UBYTE)hop]);
+          _diag->slice[(UBYTE)hop] = 0;
+          _diag->hop_status[(UBYTE)hop] = -1;
+     }
+
+     _diag->probing = 0;
+     _diag->verdict = DIAG_VERDICT_NONE;
+     _diag->failure = DIAG_VERDICT_NONE;
+}
+
+BYTE Diag_Add(struct Diag *_diag, BYTE _hop, const struct Probe_Target *_target)
+{
+     struct Probe *hop = &_diag->hop[(UBYTE)_hop];
+
+     if (hop->target_count >= DIAG_MAX_TARGETS) return 0;
+
+     // The same address twice would only double the traffic.
+     for (LONG i = 0; i < hop->target_count; i++)
+     {
+          const struct Probe_Target *target = &hop->target[i];
+
+          if (target->families == _target->families && target->ip == _target->ip && memcmp(target->ip6, _target->ip6, 16) == 0 &&
+               target->port == _target->port && target->type == _target->type) return 1;
+     }
+
+     return Probe_Add_Parsed(hop, _target);
+}
+
+static BYTE Diag_Add_Ip(struct Diag *_diag, BYTE _hop, ULONG _ip, UWORD _port, BYTE _type)
+{
+     struct Probe_Target target;
+
+     memset(&target, 0, sizeof(target));
+     target.ip = _ip;
+     target.families = 1 << NET_FAMILY_V4;
+     target.port = _port;
+     target.type = _type;
+
+     return Diag_Add(_diag, _hop, &target);
+}
+
+LONG Diag_Add_Servers(struct Diag *_diag, const struct Resolver *_resolver)
+{
+     LONG added = 0;
+
+     // The root NS query of a DNS probe - a forwarder without its upstream answers SERVFAIL.
+     for (LONG i = 0; i < _resolver->server_count; i++)
+          if (Diag_Add_Ip(_diag, DIAG_HOP_DNS, _resolver->server[i].ip, _resolver->server[i].port, PROBE_TYPE_DNS)) added++;
+
+     return added;
+}
+
+LONG Diag_Read_Gateway(struct Diag *_diag, const char *_path, UWORD _port)
+{
+     FILE *file = fopen(_path, "r");
+     if (file == NULL) return 0;
+
+     char line[256];
+     LONG added = 0;
+
+     while (fgets(line, sizeof(line), file))
+     {
+          char *word[8];
+          LONG words = 0;
+
+          // Words up to the end of the line or a comment.
+          for (char *text = line; words < 8; )
+          {
+               while (*text == ' ' || *text == '\t') text++;
+               if (*text == 0 || *text == '\r' || *text == '\n' || *text == '#' || *text == ';') break;
+
+               word[words++] = text;
+
+               while (*text && *text != ' ' && *text != '\t' && *text != '\r' && *text != '\n') text++;
+               if (*text) *text++ = 0;
+          }
+
+          ULONG ip = 0;
+
+          // /proc/net/route - "Iface Destination Gateway Flags ...", hex words as the kernel keeps them,
+          // which is network order in memory. Flag 2 is RTF_GATEWAY.
+          if (words >= 4 && strcmp(word[1], "00000000") == 0 && strlen(word[2]) == 8 && (strtoul(word[3], NULL, 16) & 2))
+               ip = (ULONG)strtoul(word[2], NULL, 16);
+          else
+          {
+               // "DEFAULT 192.168.1.1", "route add default 192.168.1.1", "default via 192.168.1.1".
+               LONG i = 0;
+
+               while (i < words)
+               {
+                    const char *keyword = "default";
+                    LONG c = 0;
+
+                    while (keyword[c] && tolower((UBYTE)word[i][c]) == keyword[c]) c++;
+                    i++;
+
+                    if (keyword[c] == 0 && word[i - 1][c] == 0) break;
+               }
+
+               for (; i < words; i++)
+                    if (Net_Parse_Ip(word[i], &ip)) break;
+          }
+
+          if (ip && Diag_Add_Ip(_diag, DIAG_HOP_GATEWAY, ip, _port, PROBE_TYPE_TCP)) added++;
+     }
+
+     fclose(file);
+     return added;
+}
+
+// Refused is an answer from a gateway, but a name server has to answer the query.
+static BYTE Diag_Hop_Answered(struct Diag *_diag, BYTE _hop)
+{
+     struct Probe *probe = &_diag->hop[(UBYTE)_hop];
+
+     for (LONG i = 0; i < probe->target_count; i++)
+     {
+          BYTE status = probe->target[i].status;
+
+          if (status == IP_STATUS_CONNECTED || (status == IP_STATUS_REFUSED && _hop == DIAG_HOP_GATEWAY)) return 1;
+     }
+
+     return 0;
+}
+
+BYTE Diag_Enabled(struct Diag *_diag)
+{
+     for (BYTE hop = 0; hop < DIAG_HOPS; hop++)
+          if (_diag->hop[(UBYTE)hop].target_count) return 1;
+
+     return 0;
+}
+
+void Diag_Start(struct Diag *_diag)
+{
+     for (BYTE hop = 0; hop < DIAG_HOPS; hop++)
+     {
+          struct Probe *probe = &_diag->hop[(UBYTE)hop];
+
+          _diag->slice[(UBYTE)hop] = 0;
+          if (probe->target_count) Probe_Start(probe);
+     }
+
+     _diag->probing = 1;
+}
+
+BYTE Diag_Done(struct Diag *_diag)
+{
+     if (!_diag->probing) return 1;
+
+     for (BYTE hop = 0; hop < DIAG_HOPS; hop++)
+     {
+          struct Probe *probe = &_diag->hop[(UBYTE)hop];
+
+          if (!probe->done && probe->in_flight) return 0;
+     }
+
+     return 1;
+}
+
+LONG Diag_Watch(struct Diag *_diag, struct Net_Watch *_watch, LONG _max)
+{
+     LONG total = 0;
+
+     for (BYTE hop = 0; hop < DIAG_HOPS; hop++)
+     {
+          LONG count = 0;
+
+          if (_diag->probing) count = Probe_Watch(&_diag->hop[(UBYTE)hop], _watch + total, _max - total);
+
+          _diag->slice[(UBYTE)hop] = count;
+          total += count;
+     }
+
+     return total;
+}
+
+void Diag_Service(struct Diag *_diag, struct Net_Watch *_watch, LONG _count)
+{
+     LONG offset = 0;
+
+     for (BYTE hop = 0; hop < DIAG_HOPS && offset < _count; hop++)
+     {
+          LONG slice = _diag->slice[(UBYTE)hop];
+
+          if (slice) Probe_Service(&_diag->hop[(UBYTE)hop], _watch + offset, slice);
+          offset += slice;
+     }
+}
+
+void Diag_Finish(struct Diag *_diag, BYTE _online)
+{
+     for (BYTE hop = 0; hop < DIAG_HOPS; hop++)
+     {
+          struct Probe *probe = &_diag->hop[(UBYTE)hop];
+
+          _diag->slice[(UBYTE)hop] = 0;
+          _diag->hop_status[(UBYTE)hop] = -1;
+
+          if (!_diag->probing || probe->target_count == 0) continue;
+
+          // Online - a hop still in flight is not needed, and has not failed either.
+          if (_online && !probe->done && probe->in_flight)
+          {
+               probe->done = 1;
+               Probe_Finish(probe);
+               continue;
+          }
+
+          Probe_Finish(probe);
+          _diag->hop_status[(UBYTE)hop] = Diag_Hop_Answered(_diag, hop);
+     }
+
+     if (_online) _diag->verdict = DIAG_VERDICT_ONLINE;
+     else if (!_diag->probing) _diag->verdict = DIAG_VERDICT_LOCAL;
+     else
+     {
+          // Walk back from the targets - the break is right after the last hop that answered.
+          _diag->verdict = DIAG_VERDICT_WAN;
+
+          for (BYTE hop = DIAG_HOPS - 1; hop >= 0; hop--)
+          {
+               if (_diag->hop_status[(UBYTE)hop] > 0) break;
+               if (_diag->hop_status[(UBYTE)hop] == 0) _diag->verdict = DIAG_VERDICT_GATEWAY + hop;
+          }
+     }
+
+     if (_diag->verdict != DIAG_VERDICT_ONLINE) _diag->failure = _diag->verdict;
+
+     _diag->probing = 0;
+}
+
+void Diag_Stop(struct Diag *_diag)
+{
+     for (BYTE hop = 0; hop < DIAG_HOPS; hop++)
+     {
+          if (_diag->probing) Probe_Finish(&_diag->hop[(UBYTE)hop]);
+
+          _diag->slice[(UBYTE)hop] = 0;
+          _diag->hop_status[(UBYTE)hop] = -1;
+     }
+
+     _diag->probing = 0;
+     _diag->verdict = DIAG_VERDICT_NONE;
+     _diag->failure = DIAG_VERDICT_NONE;
+}
+
+const char* Diag_Verdict_Text(BYTE _verdict)
+{
+     switch (_verdict)
+     {
+          case DIAG_VERDICT_ONLINE:     return "online";
+          case DIAG_VERDICT_LOCAL:      return "local";
+          case DIAG_VERDICT_GATEWAY:    return "gateway";
+          case DIAG_VERDICT_DNS:        return "DNS";
+          case DIAG_VERDICT_WAN:        return "WAN";
+          default:                      return "-";
+     }
+}
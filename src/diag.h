@@ -0,0 +1,85 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - path diagnosis
+ *
+ * Says where the path breaks when a probe fails. Next to the
+ * targets (the WAN hop) it probes the hops on the way: the
+ * default gateway and the name servers. They start with the
+ * probe and wait in the same select set, so a diagnosis
+ * costs no time on top of the probe timeout.
+ *
+ * A hop that answers vouches for the ones before it - a
+ * gateway that drops our SYNs while the name server behind it
+ * answers is not where the path breaks. The verdict is the
+ * first failing hop after the last one that answered.
+ * ---------------------------------------------------------*/
+
+#ifndef DIAG_H
+#define DIAG_H
+
+#include "platform.h"
+#include "probe.h"
+
+// Hops in path order, the WAN hop are the probe targets themselves.
+#define DIAG_HOP_GATEWAY       0
+#define DIAG_HOP_DNS           1
+#define DIAG_HOPS              2
+
+#define DIAG_MAX_TARGETS       4    // Per hop.
+#define DIAG_MAX_WATCH         (DIAG_HOPS * DIAG_MAX_TARGETS * NET_FAMILIES)
+
+// Where the path breaks.
+#define DIAG_VERDICT_NONE     -1    // No probe yet.
+#define DIAG_VERDICT_ONLINE    0
+#define DIAG_VERDICT_LOCAL     1    // TCP/IP stack down - nothing could be sent.
+#define DIAG_VERDICT_GATEWAY   2    // DIAG_VERDICT_GATEWAY + DIAG_HOP_*
+#define DIAG_VERDICT_DNS       3
+#define DIAG_VERDICT_WAN       4    // Hops answer, the targets don't.
+
+struct Diag
+{
+     struct Probe hop[DIAG_HOPS];
+     LONG  slice[DIAG_HOPS];        // Watch entries of each hop, see Diag_Watch().
+     BYTE  probing;                 // Hops in flight with the probe.
+
+     BYTE  hop_status[DIAG_HOPS];   // Latest probe: -1 not checked, 0 failed, 1 answered.
+     BYTE  verdict;                 // DIAG_VERDICT_* of the latest probe.
+     BYTE  failure;                 // DIAG_VERDICT_* of the latest probe that failed.
+};
+
+void Diag_Init(struct Diag *_diag);
+
+// Adds a target to DIAG_HOP_*. Returns 0 if the hop has DIAG_MAX_TARGETS already.
+BYTE Diag_Add(struct Diag *_diag, BYTE _hop, const struct Probe_Target *_target);
+
+// Adds the name servers of the resolver as DNS targets. Returns number added.
+LONG Diag_Add_Servers(struct Diag *_diag, const struct Resolver *_resolver);
+
+// Adds the default gateway from a routing file - Linux /proc/net/route, or
+// "default ip" lines of Roadshow DEVS:Internet/routes and route scripts.
+// Returns number added.
+LONG Diag_Read_Gateway(struct Diag *_diag, const char *_path, UWORD _port);
+
+// Returns 1 if any hop has targets.
+BYTE Diag_Enabled(struct Diag *_diag);
+
+// Starts the hops along with a probe.
+void Diag_Start(struct Diag *_diag);
+
+// Returns 1 when every hop has its result (or none was started).
+BYTE Diag_Done(struct Diag *_diag);
+
+// Same as Probe_Watch() and Probe_Service() for all hops.
+LONG Diag_Watch(struct Diag *_diag, struct Net_Watch *_watch, LONG _max);
+void Diag_Service(struct Diag *_diag, struct Net_Watch *_watch, LONG _count);
+
+// Ends the hops with the result of the probe - what is still in flight has
+// failed - and sets the verdict.
+void Diag_Finish(struct Diag *_diag, BYTE _online);
+
+// Drops the hops in flight and forgets the verdict.
+void Diag_Stop(struct Diag *_diag);
+
+// Human readable DIAG_VERDICT_* - "gateway", "DNS", ...
+const char* Diag_Verdict_Text(BYTE _verdict);
+
+#endif
@@ -0,0 +1,144 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - DNS messages
+ * ---------------------------------------------------------*/
+
+#include "dns.h"
+
+#include <string.h>
+
+#define DNS_HEADER          12
+#define DNS_FLAG_QR         0x80      // In byte 2 - this is a response.
+#define DNS_FLAG_RD         0x01      // In byte 2 - recursion desired.
+#define DNS_CLASS_IN        1
+
+static UWORD dns_query_count;
+
+UWORD Dns_Next_Id(void)
+{
+     return (UWORD)(Platform_Time() ^ (++dns_query_count * 0x9e37));
+}
+
+LONG Dns_Query(UBYTE *_buffer, LONG _size, UWORD _id, const char *_name, UWORD _type)
+{
+     if (_size < DNS_HEADER + 5) return 0;
+
+     memset(_buffer, 0, DNS_HEADER);
+
+     // Big endian on the wire, written byte by byte - same on 68k and x86.
+     _buffer[0] = _id >> 8;
+     _buffer[1] = _id & 0xff;
+     _buffer[2] = DNS_FLAG_RD;
+     _buffer[5] = 1;                    // QDCOUNT
+
+     LONG length = DNS_HEADER;
+
+     // Labels with their lengths in front.
+     if (_name[0] == '.' && _name[1] == 0) _name++;
+
+     while (*_name)
+     {
+          const char *dot = strchr(_name, '.');
+          LONG label = dot ? dot - _name : (LONG)strlen(_name);
+
+          if (label == 0 || label > 63 || length + 1 + label + 5 > _size) return 0;
+
+          _buffer[length++] = label;
+          memcpy(_buffer + length, _name, label);
+          length += label;
+
+          _name += label;
+          if (*_name) _name++;
+     }
+
+     _buffer[length++] = 0;
+     _buffer[length++] = _type >> 8;
+     _buffer[length++] = _type & 0xff;
+     _buffer[length++] = 0;
+     _buffer[length++] = DNS_CLASS_IN;
+
+     return length;
+}
+
+LONG Dns_Reply_Code(const UBYTE *_reply, LONG _length, UWORD _id)
+{
+     if (_length < DNS_HEADER) return -1;
+
+     // Late answer to an older query, or not an answer at all.
+     if (((_reply[0] << 8) | _reply[1]) != _id) return -1;
+     if (!(_reply[2] & DNS_FLAG_QR)) return -1;
+
+     return _reply[3] & 0x0f;
+}
+
+// Offset just past the name at _offset, -1 if it runs out of the message.
+static LONG Dns_Skip_Name(const UBYTE *_reply, LONG _length, LONG _offset)
+{
+     while (_offset < _length)
+     {
+          UBYTE label = _reply[_offset];
+
+          // Compression pointer ends the name.
+          if ((label & 0xc0) == 0xc0) return _offset + 2 <= _length ? _offset + 2 : -1;
+          if (label == 0) return _offset + 1;
+
+          _offset += 1 + label;
+     }
+
+     return -1;
+}
+
+static ULONG Dns_Get_16(const UBYTE *_data)
+{
+     return (_data[0] << 8) | _data[1];
+}
+
+LONG Dns_Reply_Address(const UBYTE *_reply, LONG _length, UWORD _id, UWORD _type, UBYTE *_address, BYTE *_found, ULONG *_ttl)
+{
+     ULONG size = _type == DNS_TYPE_AAAA ? 16 : 4;
+
+     *_found = 0;
+     *_ttl = 0;
+
+     LONG rcode = Dns_Reply_Code(_reply, _length, _id);
+     if (rcode != 0) return rcode;
+
+     ULONG questions = Dns_Get_16(_reply + 4);
+     ULONG answers = Dns_Get_16(_reply + 6);
+     LONG offset = DNS_HEADER;
+
+     for (ULONG i = 0; i < questions && offset >= 0; i++)
+     {
+          offset = Dns_Skip_Name(_reply, _length, offset);
+          if (offset >= 0) offset += 4;
+     }
+
+     ULONG ttl = 0xffffffffUL;
+
+     // Type, class, TTL and data length - 10 bytes after the name.
+     for (ULONG i = 0; i < answers && offset >= 0; i++)
+     {
+          offset = Dns_Skip_Name(_reply, _length, offset);
+          if (offset < 0 || offset + 10 > _length) break;
+
+          const UBYTE *record = _reply + offset;
+          ULONG data_length = Dns_Get_16(record + 8);
+          ULONG record_ttl = (Dns_Get_16(record + 4) << 16) | Dns_Get_16(record + 6);
+
+          offset += 10 + data_length;
+          if (offset > _length) break;
+
+          if (Dns_Get_16(record + 2) != DNS_CLASS_IN) continue;
+          if (record_ttl < ttl) ttl = record_ttl;
+
+          if (Dns_Get_16(record) == _type && data_length == size)
+          {
+               // Already in network order on the wire.
+               memcpy(_address, record + 10, size);
+               *_found = 1;
+               *_ttl = ttl;
+               break;
+          }
+     }
+
+     return rcode;
+}
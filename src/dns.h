@@ -0,0 +1,37 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - DNS messages
+ *
+ * Just enough of RFC 1035 to ask one question over UDP,
+ * check that the reply belongs to it and take the first
+ * IPv4 or IPv6 address out of it.
+ * ---------------------------------------------------------*/
+
+#ifndef DNS_H
+#define DNS_H
+
+#include "platform.h"
+
+#define DNS_PORT            53
+#define DNS_MAX_MESSAGE     512       // Plain UDP, no EDNS.
+
+#define DNS_TYPE_A          1
+#define DNS_TYPE_NS         2
+#define DNS_TYPE_AAAA       28
+
+// ID for a new query - different for every query, so a late reply to an older one is not taken.
+UWORD Dns_Next_Id(void);
+
+// Builds a recursive query for _name ("" or "." is the root). Returns its length, 0 if
+// the name does not fit or has an empty or too long label.
+LONG Dns_Query(UBYTE *_buffer, LONG _size, UWORD _id, const char *_name, UWORD _type);
+
+// Checks a reply to the query with _id. Returns its RCODE (0..15), -1 if it is not one.
+LONG Dns_Reply_Code(const UBYTE *_reply, LONG _length, UWORD _id);
+
+// Same, and with RCODE 0 also the first A (4 bytes) or AAAA (16 bytes) record of the answer,
+// as _type says - CNAMEs in front of it are skipped. *_address gets it in network order,
+// *_ttl the lowest TTL on the way to it in seconds. Returns -1 if it is not a reply to _id,
+// *_found is 0 if there is no such record or the reply is cut short.
+LONG Dns_Reply_Address(const UBYTE *_reply, LONG _length, UWORD _id, UWORD _type, UBYTE *_address, BYTE *_found, ULONG *_ttl);
+
+#endif
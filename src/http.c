@@ -0,0 +1,555 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - status and metrics over HTTP
+ * ---------------------------------------------------------*/
+
+#include "http.h"
+#include "stats.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+// Answers that never change.
+static const char http_not_found[] = "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 10\r\nConnection: close\r\n\r\nNot found\n";
+static const char http_bad_method[] = "HTTP/1.0 405 Method Not Allowed\r\nAllow: GET, HEAD\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+static const char *http_content_type[HTTP_PAGES] = { "text/plain; version=0.0.4", "application/json" };
+
+// Text being built into a page, cut at the last line that fitted.
+struct Http_Text
+{
+     char *buffer;
+     LONG  length;
+     LONG  size;
+     BYTE  full;
+};
+
+static void Http_Append(struct Http_Text *_text, const char *_format, ...)
+{
+     if (_text->full) return;
+
+     va_list args;
+     va_start(args, _format);
+     LONG length = vsnprintf(_text->buffer + _text->length, _text->size - _text->length, _format, args);
+     va_end(args);
+
+     if (length < 0 || _text->length + length >= _text->size)
+     {
+          _text->buffer[_text->length] = 0;
+          _text->full = 1;
+          return;
+     }
+
+     _text->length += length;
+}
+
+// Quotes and backslashes escaped, the same rule for a metrics label and a JSON string.
+static void Http_Escape(const char *_text, char *_buffer, LONG _size)
+{
+     LONG length = 0;
+
+     for (LONG i = 0; _text[i] && length < _size - 2; i++)
+     {
+          if (_text[i] == '"' || _text[i] == '\\') _buffer[length++] = '\\';
+          _buffer[length++] = _text[i];
+     }
+
+     _buffer[length] = 0;
+}
+
+// "TCP:1.1.1.1:80", "HTTP:example.com:80/path".
+static void Http_Target_Label(const struct Probe_Target *_target, char *_buffer, LONG _size)
+{
+     char address[48], label[128];
+
+     if (_target->name) strcpy(address, _target->name->host);
+     else Probe_Format_Address(_target, (_target->families & (1 << NET_FAMILY_V4)) ? NET_FAMILY_V4 : NET_FAMILY_V6, address);
+
+     // The name a DNS probe asks for is kept without the slash.
+     snprintf(label, sizeof(label), "%s:%s:%u%s%s", Probe_Type_Text(_target->type), address, _target->port,
+          _target->type == PROBE_TYPE_DNS && _target->path[0] ? "/" : "", _target->path);
+
+     Http_Escape(label, _buffer, _size);
+}
+
+static BYTE Http_Target_Up(const struct Probe_Target *_target)
+{
+     return _target->status == IP_STATUS_CONNECTED || _target->status == IP_STATUS_REFUSED;
+}
+
+// RTT in ms, or what stands for "none" in the format.
+static void Http_Rtt(ULONG _micro, BYTE _valid, const char *_none, char *_buffer)
+{
+     if (_valid) Rtt_Format(_micro, _buffer);
+     else strcpy(_buffer, _none);
+}
+
+// Lines of the targets of one monitor - those of a channel carry its name as well.
+static void Http_Metrics_Targets(struct Http_Text *_text, struct Monitor *_monitor, const char *_channel)
+{
+     char value[16], label[128], name[80], prefix[96];
+
+     prefix[0] = 0;
+     if (_channel)
+     {
+          Http_Escape(_channel, name, sizeof(name));
+          snprintf(prefix, sizeof(prefix), "channel=\"%s\",", name);
+     }
+
+     for (LONG i = 0; i < _monitor->probe.target_count; i++)
+     {
+          struct Probe_Target *target = &_monitor->probe.target[i];
+
+          Http_Target_Label(target, label, sizeof(label));
+          Http_Append(_text, "msinternetstatus_target_up{%starget=\"%s\",result=\"%s\"} %d\n", prefix, label, Probe_Status_Text(target->status),
+               Http_Target_Up(target));
+
+          if (Http_Target_Up(target))
+          {
+               Rtt_Format(target->rtt, value);
+               Http_Append(_text, "msinternetstatus_target_rtt_ms{%starget=\"%s\"} %s\n", prefix, label, value);
+          }
+     }
+}
+
+static void Http_Build_Metrics(struct Http *_http, struct Http_Text *_text)
+{
+     struct Monitor *monitor = _http->monitor;
+     struct Rtt_Window *rtt = &monitor->rtt;
+     char value[16], label[80];
+
+     Http_Append(_text, "# HELP msinternetstatus_status 1 online, 0 offline, -1 unknown - damped, as published.\n");
+     Http_Append(_text, "# TYPE msinternetstatus_status gauge\n");
+     Http_Append(_text, "msinternetstatus_status %d\n", monitor->status);
+     Http_Append(_text, "msinternetstatus_raw_status %d\n", monitor->raw_status);
+     Http_Append(_text, "msinternetstatus_family_status{family=\"ipv4\"} %d\n", monitor->family_status[NET_FAMILY_V4]);
+     Http_Append(_text, "msinternetstatus_family_status{family=\"ipv6\"} %d\n", monitor->family_status[NET_FAMILY_V6]);
+
+     if (_http->channel_count)
+     {
+          Http_Append(_text, "# HELP msinternetstatus_channel_status Status of each named channel, the same values.\n");
+          Http_Append(_text, "# TYPE msinternetstatus_channel_status gauge\n");
+     }
+
+     for (LONG i = 0; i < _http->channel_count; i++)
+     {
+          Http_Escape(_http->channel[i].name, label, sizeof(label));
+          Http_Append(_text, "msinternetstatus_channel_status{channel=\"%s\"} %d\n", label, _http->channel[i].monitor->status);
+     }
+
+     for (LONG i = 0; i < _http->channel_count; i++)
+     {
+          struct Monitor *channel = _http->channel[i].monitor;
+
+          Http_Escape(_http->channel[i].name, label, sizeof(label));
+          Http_Rtt(channel->rtt.last, channel->raw_status > 0, "NaN", value);
+          Http_Append(_text, "msinternetstatus_channel_rtt_last_ms{channel=\"%s\"} %s\n", label, value);
+     }
+
+     Http_Append(_text, "# TYPE msinternetstatus_rtt_ms summary\n");
+     Http_Rtt(Rtt_Percentile(rtt, 50), rtt->count > 0, "NaN", value);
+     Http_Append(_text, "msinternetstatus_rtt_ms{quantile=\"0.5\"} %s\n", value);
+     Http_Rtt(Rtt_Percentile(rtt, 95), rtt->count > 0, "NaN", value);
+     Http_Append(_text, "msinternetstatus_rtt_ms{quantile=\"0.95\"} %s\n", value);
+     Http_Rtt(Rtt_Max(rtt), rtt->count > 0, "NaN", value);
+     Http_Append(_text, "msinternetstatus_rtt_ms{quantile=\"1\"} %s\n", value);
+     Http_Append(_text, "msinternetstatus_rtt_ms_count %d\n", rtt->count);
+     Http_Rtt(rtt->last, monitor->raw_status > 0, "NaN", value);
+     Http_Append(_text, "msinternetstatus_rtt_last_ms %s\n", value);
+     Rtt_Format(monitor->timeout_us, value);
+     Http_Append(_text, "msinternetstatus_timeout_ms %s\n", value);
+     Http_Append(_text, "msinternetstatus_next_probe_ms %lu\n", (unsigned long)monitor->next_probe_ms);
+
+     Http_Append(_text, "# HELP msinternetstatus_target_up Latest result of each target, 1 answered.\n");
+     Http_Append(_text, "# TYPE msinternetstatus_target_up gauge\n");
+
+     Http_Metrics_Targets(_text, monitor, NULL);
+     for (LONG i = 0; i < _http->channel_count; i++) Http_Metrics_Targets(_text, _http->channel[i].monitor, _http->channel[i].name);
+
+     Http_Append(_text, "# TYPE msinternetstatus_events_total counter\n");
+
+     for (LONG i = 0; i < STATS_COUNTERS; i++)
+          Http_Append(_text, "msinternetstatus_events_total{event=\"%s\"} %lu\n", Stats_Counter_Name(i), (unsigned long)stats.counter[i]);
+
+     Http_Append(_text, "# HELP msinternetstatus_phase_us Upper bound of the bucket of the percentile, in microseconds.\n");
+
+     for (LONG i = 0; i < STATS_PHASES; i++)
+     {
+          struct Stats_Histogram *histogram = &stats.phase[i];
+
+          Http_Append(_text, "msinternetstatus_phase_us{phase=\"%s\",quantile=\"0.5\"} %lu\n", Stats_Phase_Name(i),
+               (unsigned long)Stats_Percentile(histogram, 50));
+          Http_Append(_text, "msinternetstatus_phase_us{phase=\"%s\",quantile=\"0.95\"} %lu\n", Stats_Phase_Name(i),
+               (unsigned long)Stats_Percentile(histogram, 95));
+          Http_Append(_text, "msinternetstatus_phase_us{phase=\"%s\",quantile=\"1\"} %lu\n", Stats_Phase_Name(i), (unsigned long)histogram->max);
+     }
+}
+
+static const char* Http_Json_Status(BYTE _status)
+{
+     return _status < 0 ? "null" : _status ? "\"online\"" : "\"offline\"";
+}
+
+// The "targets" array of one monitor, each on its own line behind _indent.
+static void Http_Json_Targets(struct Http_Text *_text, struct Monitor *_monitor, const char *_indent)
+{
+     char rtt[16], label[128];
+
+     Http_Append(_text, "\"targets\":[");
+
+     for (LONG i = 0; i < _monitor->probe.target_count; i++)
+     {
+          struct Probe_Target *target = &_monitor->probe.target[i];
+
+          Http_Target_Label(target, label, sizeof(label));
+          Http_Rtt(target->rtt, Http_Target_Up(target), "null", rtt);
+          Http_Append(_text, "%s\n%s{\"target\":\"%s\",\"result\":\"%s\",\"up\":%s,\"rtt_ms\":%s}", i ? "," : "", _indent, label,
+               Probe_Status_Text(target->status), Http_Target_Up(target) ? "true" : "false", rtt);
+     }
+
+     Http_Append(_text, "]");
+}
+
+static void Http_Build_Json(struct Http *_http, struct Http_Text *_text)
+{
+     struct Monitor *monitor = _http->monitor;
+     struct Rtt_Window *rtt = &monitor->rtt;
+     char last[16], p50[16], p95[16], max[16], timeout[16], label[80];
+
+     Http_Rtt(rtt->last, monitor->raw_status > 0, "null", last);
+     Http_Rtt(Rtt_Percentile(rtt, 50), rtt->count > 0, "null", p50);
+     Http_Rtt(Rtt_Percentile(rtt, 95), rtt->count > 0, "null", p95);
+     Http_Rtt(Rtt_Max(rtt), rtt->count > 0, "null", max);
+     Rtt_Format(monitor->timeout_us, timeout);
+
+     Http_Append(_text, "{\"status\":%s,\"raw_status\":%s,\"ipv4\":%s,\"ipv6\":%s,\n", Http_Json_Status(monitor->status), Http_Json_Status(monitor->raw_status),
+          Http_Json_Status(monitor->family_status[NET_FAMILY_V4]), Http_Json_Status(monitor->family_status[NET_FAMILY_V6]));
+     Http_Append(_text, " \"rtt_ms\":{\"last\":%s,\"p50\":%s,\"p95\":%s,\"max\":%s,\"samples\":%d},\n", last, p50, p95, max, rtt->count);
+     Http_Append(_text, " \"timeout_ms\":%s,\"next_probe_ms\":%lu,\n", timeout, (unsigned long)monitor->next_probe_ms);
+     Http_Append(_text, " ");
+     Http_Json_Targets(_text, monitor, "  ");
+     Http_Append(_text, ",\n \"channels\":[");
+
+     for (LONG i = 0; i < _http->channel_count; i++)
+     {
+          struct Monitor *channel = _http->channel[i].monitor;
+
+          Http_Escape(_http->channel[i].name, label, sizeof(label));
+          Http_Rtt(channel->rtt.last, channel->raw_status > 0, "null", last);
+          Http_Append(_text, "%s\n  {\"name\":\"%s\",\"status\":%s,\"raw_status\":%s,\"rtt_ms\":%s,\"next_probe_ms\":%lu,\n   ", i ? "," : "", label,
+               Http_Json_Status(channel->status), Http_Json_Status(channel->raw_status), last, (unsigned long)channel->next_probe_ms);
+          Http_Json_Targets(_text, channel, "    ");
+          Http_Append(_text, "}");
+     }
+
+     Http_Append(_text, "],\n \"counters\":{");
+
+     for (LONG i = 0; i < STATS_COUNTERS; i++)
+          Http_Append(_text, "%s\"%s\":%lu", i ? "," : "", Stats_Counter_Name(i), (unsigned long)stats.counter[i]);
+
+     Http_Append(_text, "},\n \"phases_us\":{");
+
+     for (LONG i = 0; i < STATS_PHASES; i++)
+     {
+          struct Stats_Histogram *histogram = &stats.phase[i];
+
+          Http_Append(_text, "%s\"%s\":{\"p50\":%lu,\"p95\":%lu,\"max\":%lu}", i ? "," : "", Stats_Phase_Name(i),
+               (unsigned long)Stats_Percentile(histogram, 50), (unsigned long)Stats_Percentile(histogram, 95), (unsigned long)histogram->max);
+     }
+
+     Http_Append(_text, "}}\n");
+}
+
+// Body first, behind the room for the headers, then the headers right in front of it.
+static void Http_Build_Page(struct Http *_http, LONG _page)
+{
+     struct Http_Page *page = &_http->page[_page];
+     struct Http_Text text;
+     char header[HTTP_HEADER_SIZE];
+
+     text.buffer = page->buffer + HTTP_HEADER_SIZE;
+     text.length = 0;
+     text.size = HTTP_BUFFER_SIZE;
+     text.full = 0;
+
+     if (_page == HTTP_PAGE_JSON) Http_Build_Json(_http, &text);
+     else Http_Build_Metrics(_http, &text);
+
+     LONG header_length = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\n"
+          "Content-Type: %s\r\nContent-Length: %ld\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n",
+          http_content_type[_page], (long)text.length);
+
+     memcpy(text.buffer - header_length, header, header_length);
+
+     page->answer = text.buffer - header_length;
+     page->header_length = header_length;
+     page->length = header_length + text.length;
+}
+
+// Pages are rebuilt only while no answer is on its way out of them - the
+// answers that never change don't hold it up.
+static void Http_Build(struct Http *_http)
+{
+     if (!_http->stale) return;
+
+     for (LONG i = 0; i < HTTP_MAX_CLIENTS; i++)
+     {
+          struct Http_Client *client = &_http->client[i];
+          if (client->socket == NET_NO_SOCKET || !client->answer) continue;
+
+          for (LONG page = 0; page < HTTP_PAGES; page++)
+               if (client->answer == _http->page[page].answer) return;
+     }
+
+     for (LONG i = 0; i < HTTP_PAGES; i++) Http_Build_Page(_http, i);
+
+     _http->stale = 0;
+     _http->builds++;
+}
+
+void Http_Init(struct Http *_http, struct Monitor *_monitor, ULONG _address, UWORD _port)
+{
+     memset(_http, 0, sizeof(struct Http));
+
+     _http->monitor = _monitor;
+     _http->socket = NET_NO_SOCKET;
+     _http->address = _address;
+     _http->port = _port;
+     _http->stale = 1;
+
+     for (LONG i = 0; i < HTTP_MAX_CLIENTS; i++) _http->client[i].socket = NET_NO_SOCKET;
+}
+
+BYTE Http_Add_Channel(struct Http *_http, const char *_name, struct Monitor *_monitor)
+{
+     if (_http->channel_count >= HTTP_MAX_CHANNELS) return 0;
+
+     _http->channel[_http->channel_count].name = _name;
+     _http->channel[_http->channel_count].monitor = _monitor;
+     _http->channel_count++;
+
+     return 1;
+}
+
+// Returns 1 if the sockets belong to the current session - a closed one took them along.
+static BYTE Http_Socket_Valid(struct Http *_http)
+{
+     return _http->open_count == Net_Open_Count() && Net_Is_Open();
+}
+
+static void Http_Close_Client(struct Http *_http, struct Http_Client *_client)
+{
+     if (Http_Socket_Valid(_http)) Net_Close_Socket(_client->socket);
+
+     _client->socket = NET_NO_SOCKET;
+     _client->answer = NULL;
+}
+
+// Listening socket of the current session. Connections of an earlier one are gone.
+static BYTE Http_Socket(struct Http *_http)
+{
+     if (_http->socket != NET_NO_SOCKET && Http_Socket_Valid(_http)) return 1;
+
+     for (LONG i = 0; i < HTTP_MAX_CLIENTS; i++)
+     {
+          _http->client[i].socket = NET_NO_SOCKET;
+          _http->client[i].answer = NULL;
+     }
+
+     _http->socket = NET_NO_SOCKET;
+
+     if (!Net_Open()) return 0;
+
+     _http->socket = Net_Tcp_Listen(_http->address, _http->port);
+     _http->open_count = Net_Open_Count();
+
+     return _http->socket != NET_NO_SOCKET;
+}
+
+BYTE Http_Start(struct Http *_http)
+{
+     Http_Stop(_http);
+
+     _http->started = 1;
+     _http->stale = 1;
+
+     return Http_Socket(_http);
+}
+
+void Http_Stop(struct Http *_http)
+{
+     if (!_http->started) return;
+
+     for (LONG i = 0; i < HTTP_MAX_CLIENTS; i++)
+          if (_http->client[i].socket != NET_NO_SOCKET) Http_Close_Client(_http, &_http->client[i]);
+
+     if (_http->socket != NET_NO_SOCKET && Http_Socket_Valid(_http)) Net_Close_Socket(_http->socket);
+
+     _http->socket = NET_NO_SOCKET;
+     _http->started = 0;
+}
+
+LONG Http_Watch(struct Http *_http, struct Net_Watch *_watch, LONG _max)
+{
+     if (!_http->started || _max < 1 + HTTP_MAX_CLIENTS) return 0;
+
+     // Opened again once per session - a taken port is not tried on every wakeup.
+     if (!Http_Socket_Valid(_http) && Net_Is_Open()) Http_Socket(_http);
+     if (_http->socket == NET_NO_SOCKET || !Http_Socket_Valid(_http)) return 0;
+
+     _watch[0].socket = _http->socket;
+     _watch[0].want = NET_EVENT_READ;
+
+     for (LONG i = 0; i < HTTP_MAX_CLIENTS; i++)
+     {
+          struct Http_Client *client = &_http->client[i];
+
+          _watch[1 + i].socket = client->socket;
+          _watch[1 + i].want = client->answer ? NET_EVENT_WRITE : NET_EVENT_READ;
+     }
+
+     return 1 + HTTP_MAX_CLIENTS;
+}
+
+// As much of the answer as the socket takes - the rest when it is writable again.
+static void Http_Send(struct Http *_http, struct Http_Client *_client)
+{
+     BYTE state = NET_CONNECT_PENDING;
+     LONG sent = Net_Send(_client->socket, _client->answer + _client->answer_sent, _client->answer_length - _client->answer_sent, &state);
+
+     if (sent < 0 && state == NET_CONNECT_PENDING) return;
+
+     if (sent > 0) _client->answer_sent += sent;
+
+     if (sent < 0 || _client->answer_sent >= _client->answer_length) Http_Close_Client(_http, _client);
+}
+
+static void Http_Answer(struct Http *_http, struct Http_Client *_client)
+{
+     char *request = _client->request;
+     BYTE head = strncmp(request, "HEAD ", 5) == 0;
+
+     _http->requests++;
+
+     if (!head && strncmp(request, "GET ", 4) != 0)
+     {
+          _client->answer = http_bad_method;
+          _client->answer_length = sizeof(http_bad_method) - 1;
+     }
+     else
+     {
+          // Path up to the query or the version.
+          char *path = request + (head ? 5 : 4);
+          LONG length = strcspn(path, " ?\r\n");
+          LONG page = -1;
+
+          if ((length == 1 && path[0] == '/') || (length == 8 && strncmp(path, "/metrics", 8) == 0)) page = HTTP_PAGE_METRICS;
+          if (length == 5 && strncmp(path, "/json", 5) == 0) page = HTTP_PAGE_JSON;
+
+          if (page < 0)
+          {
+               _client->answer = http_not_found;
+               _client->answer_length = sizeof(http_not_found) - 1;
+          }
+          else
+          {
+               Http_Build(_http);
+
+               _client->answer = _http->page[page].answer;
+               _client->answer_length = head ? _http->page[page].header_length : _http->page[page].length;
+          }
+     }
+
+     _client->answer_sent = 0;
+     Http_Send(_http, _client);
+}
+
+// Keeps the start of the request, up to the empty line that ends it.
+static void Http_Read(struct Http *_http, struct Http_Client *_client)
+{
+     char buffer[256];
+     BYTE state = NET_CONNECT_PENDING;
+     LONG length = Net_Receive(_client->socket, buffer, sizeof(buffer), &state);
+
+     if (length < 0 && state == NET_CONNECT_PENDING) return;
+
+     if (length <= 0)
+     {
+          Http_Close_Client(_http, _client);
+          return;
+     }
+
+     for (LONG i = 0; i < length; i++)
+     {
+          if (_client->request_length < HTTP_REQUEST_SIZE - 1) _client->request[_client->request_length++] = buffer[i];
+          _client->request[_client->request_length] = 0;
+
+          if (buffer[i] == '\n')
+          {
+               if (_client->line_length == 0)
+               {
+                    Http_Answer(_http, _client);
+                    return;
+               }
+
+               _client->line_length = 0;
+          }
+          else if (buffer[i] != '\r') _client->line_length++;
+     }
+}
+
+static void Http_Accept(struct Http *_http)
+{
+     for (;;)
+     {
+          ULONG ip;
+          LONG client_socket = Net_Tcp_Accept(_http->socket, &ip);
+          if (client_socket == NET_NO_SOCKET) return;
+
+          // A free slot, or the oldest connection makes room.
+          struct Http_Client *client = &_http->client[0];
+
+          for (LONG i = 0; i < HTTP_MAX_CLIENTS; i++)
+          {
+               if (_http->client[i].socket == NET_NO_SOCKET)
+               {
+                    client = &_http->client[i];
+                    break;
+               }
+
+               if (_http->client[i].accepted < client->accepted) client = &_http->client[i];
+          }
+
+          if (client->socket != NET_NO_SOCKET) Http_Close_Client(_http, client);
+
+          client->socket = client_socket;
+          client->request_length = 0;
+          client->line_length = 0;
+          client->answer = NULL;
+          client->accepted = Platform_Time();
+     }
+}
+
+void Http_Service(struct Http *_http, struct Net_Watch *_watch, LONG _count)
+{
+     if (_count < 1 + HTTP_MAX_CLIENTS) return;
+
+     for (LONG i = 0; i < HTTP_MAX_CLIENTS; i++)
+     {
+          struct Http_Client *client = &_http->client[i];
+          UBYTE ready = _watch[1 + i].ready;
+
+          if (client->socket == NET_NO_SOCKET || client->socket != _watch[1 + i].socket || !ready) continue;
+
+          if (client->answer) Http_Send(_http, client);
+          else Http_Read(_http, client);
+     }
+
+     // After the connections - a new one may take the slot of one just served.
+     if (_watch[0].ready) Http_Accept(_http);
+}
+
+void Http_Publish(struct Http *_http)
+{
+     _http->stale = 1;
+}
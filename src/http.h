@@ -0,0 +1,116 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - status and metrics over HTTP
+ *
+ * A tiny HTTP/1.0 listener for monitoring boxes that scrape
+ * the status, so nothing else has to run on the machine.
+ * Its sockets wait in the same select set as the probes and
+ * are never waited for on their own:
+ *
+ *   GET /metrics  - plain text, one "name{labels} value" per
+ *                   line, as Prometheus reads it
+ *   GET /json     - the same as one JSON object
+ *   GET /         - the plain text one
+ *
+ * The main monitor comes first, the named channels follow
+ * with their status, latest RTT and targets.
+ *
+ * Both answers, headers included, are kept formatted. They
+ * are rebuilt on the first request after a probe finished,
+ * so a scrape costs a send() of the buffer. A connection is
+ * closed once its answer is out.
+ * ---------------------------------------------------------*/
+
+#ifndef HTTP_H
+#define HTTP_H
+
+#include "platform.h"
+#include "monitor.h"
+
+#define HTTP_PORT                8080
+
+// Connections at once - one more takes the place of the oldest.
+#define HTTP_MAX_CLIENTS         8
+
+// Request line and headers kept, the rest is not needed.
+#define HTTP_REQUEST_SIZE        256
+
+// Formatted answer - 64 targets of all channels with long labels fit.
+#define HTTP_BUFFER_SIZE         24576
+
+// Room in front of the body for the status line and headers.
+#define HTTP_HEADER_SIZE         160
+
+// Named channels next to the main monitor.
+#define HTTP_MAX_CHANNELS        8
+
+#define HTTP_PAGE_METRICS        0
+#define HTTP_PAGE_JSON           1
+#define HTTP_PAGES               2
+
+struct Http_Client
+{
+     LONG    socket;                   // NET_NO_SOCKET - free slot.
+     char    request[HTTP_REQUEST_SIZE];
+     LONG    request_length;
+     LONG    line_length;              // Of the header line read now - an empty one ends the request.
+     const char *answer;               // NULL while the request is read.
+     LONG    answer_length;
+     LONG    answer_sent;
+     TIME_US accepted;
+};
+
+struct Http_Page
+{
+     char    buffer[HTTP_HEADER_SIZE + HTTP_BUFFER_SIZE];
+     const char *answer;               // Headers and body, inside the buffer.
+     LONG    length;
+     LONG    header_length;            // All a HEAD request gets.
+};
+
+struct Http_Channel
+{
+     const char     *name;
+     struct Monitor *monitor;
+};
+
+struct Http
+{
+     struct Monitor     *monitor;
+     struct Http_Channel channel[HTTP_MAX_CHANNELS];
+     LONG    channel_count;
+
+     LONG    socket;                   // Listening one.
+     ULONG   open_count;               // Net_Open_Count() of the socket - a new session needs a new one.
+     ULONG   address;                  // Network order, 0 - all interfaces.
+     UWORD   port;
+     BYTE    started;
+
+     struct Http_Client client[HTTP_MAX_CLIENTS];
+     struct Http_Page   page[HTTP_PAGES];
+     BYTE    stale;                    // A probe finished since the pages were built.
+
+     ULONG   requests;
+     ULONG   builds;
+};
+
+void Http_Init(struct Http *_http, struct Monitor *_monitor, ULONG _address, UWORD _port);
+
+// Shows a named channel after the main monitor. _name is kept, not copied.
+// Returns 0 if there are HTTP_MAX_CHANNELS already.
+BYTE Http_Add_Channel(struct Http *_http, const char *_name, struct Monitor *_monitor);
+
+// Opens the listening socket. Returns 0 if it can't - the port is taken, or no stack.
+BYTE Http_Start(struct Http *_http);
+
+// Closes the listening socket and the connections.
+void Http_Stop(struct Http *_http);
+
+// Same as Probe_Watch() and Probe_Service() for the listening socket and the connections.
+// The listening socket is opened again here after the stack was restarted.
+LONG Http_Watch(struct Http *_http, struct Net_Watch *_watch, LONG _max);
+void Http_Service(struct Http *_http, struct Net_Watch *_watch, LONG _count);
+
+// The pages are built again with the next request. Called from Platform_Publish().
+void Http_Publish(struct Http *_http);
+
+#endif
@@ -0,0 +1,131 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - outage journal
+ * ---------------------------------------------------------*/
+
+#include "journal.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static void Journal_Put_Long(UBYTE *_buffer, ULONG _value)
+{
+     _buffer[0] = (UBYTE)(_value >> 24);
+     _buffer[1] = (UBYTE)(_value >> 16);
+     _buffer[2] = (UBYTE)(_value >> 8);
+     _buffer[3] = (UBYTE)_value;
+}
+
+static ULONG Journal_Get_Long(const UBYTE *_buffer)
+{
+     return ((ULONG)_buffer[0] << 24) | ((ULONG)_buffer[1] << 16) | ((ULONG)_buffer[2] << 8) | _buffer[3];
+}
+
+static UBYTE Journal_Put_Byte(BYTE _value)
+{
+     return _value < 0 ? JOURNAL_UNKNOWN : (UBYTE)_value;
+}
+
+static BYTE Journal_Get_Byte(UBYTE _value)
+{
+     return _value == JOURNAL_UNKNOWN ? -1 : (BYTE)_value;
+}
+
+void Journal_Encode(const struct Journal_Record *_record, UBYTE *_buffer)
+{
+     Journal_Put_Long(_buffer, _record->time);
+     _buffer[4] = (UBYTE)_record->type;
+     _buffer[5] = Journal_Put_Byte(_record->status);
+     _buffer[6] = Journal_Put_Byte(_record->raw_status);
+     _buffer[7] = Journal_Put_Byte(_record->verdict);
+     Journal_Put_Long(_buffer + 8, _record->rtt);
+     _buffer[12] = _record->answered;
+     _buffer[13] = _record->targets;
+     _buffer[14] = JOURNAL_VERSION;
+
+     UBYTE check = 0;
+     for (LONG i = 0; i < JOURNAL_RECORD_SIZE - 1; i++) check ^= _buffer[i];
+     _buffer[15] = check;
+}
+
+BYTE Journal_Decode(const UBYTE *_buffer, struct Journal_Record *_record)
+{
+     UBYTE check = 0;
+     for (LONG i = 0; i < JOURNAL_RECORD_SIZE - 1; i++) check ^= _buffer[i];
+
+     if (check != _buffer[15] || _buffer[14] != JOURNAL_VERSION) return 0;
+     if (_buffer[4] < JOURNAL_TYPE_START || _buffer[4] > JOURNAL_TYPE_CHANGE) return 0;
+
+     _record->time = Journal_Get_Long(_buffer);
+     _record->type = (BYTE)_buffer[4];
+     _record->status = Journal_Get_Byte(_buffer[5]);
+     _record->raw_status = Journal_Get_Byte(_buffer[6]);
+     _record->verdict = Journal_Get_Byte(_buffer[7]);
+     _record->rtt = Journal_Get_Long(_buffer + 8);
+     _record->answered = _buffer[12];
+     _record->targets = _buffer[13];
+
+     return 1;
+}
+
+void Journal_Init(struct Journal *_journal, const char *_path)
+{
+     memset(_journal, 0, sizeof(struct Journal));
+
+     _journal->path = _path;
+     _journal->status = -1;
+}
+
+BYTE Journal_Flush(struct Journal *_journal)
+{
+     if (_journal->count == 0) return 1;
+
+     LONG count = _journal->count;
+     _journal->count = 0;
+
+     // Opened for the batch only - nothing stays locked between them.
+     FILE *file = fopen(_journal->path, "ab");
+     if (file == NULL)
+     {
+          _journal->lost += count;
+          return 0;
+     }
+
+     // A batch torn by a full disk left the end off the record grid. The torn record is
+     // filled up with zeros - it fails its check, and the ones after it stay in place.
+     fseek(file, 0, SEEK_END);
+     LONG torn = ftell(file) % JOURNAL_RECORD_SIZE;
+
+     if (torn > 0)
+     {
+          UBYTE zero[JOURNAL_RECORD_SIZE];
+
+          memset(zero, 0, sizeof(zero));
+          fwrite(zero, 1, JOURNAL_RECORD_SIZE - torn, file);
+     }
+
+     LONG written = fwrite(_journal->buffer, JOURNAL_RECORD_SIZE, count, file);
+     if (fclose(file) != 0) written = 0;
+
+     _journal->records += written;
+     _journal->lost += count - written;
+     _journal->flushes++;
+
+     return written == count;
+}
+
+void Journal_Add(struct Journal *_journal, struct Journal_Record *_record)
+{
+     if (_record->type == JOURNAL_TYPE_PROBE && _record->status != _journal->status) _record->type = JOURNAL_TYPE_CHANGE;
+
+     // After a start the status is unknown until a probe says otherwise.
+     _journal->status = _record->type == JOURNAL_TYPE_START || _record->type == JOURNAL_TYPE_STOP ? -1 : _record->status;
+
+     if (_journal->count == 0) _journal->oldest = _record->time;
+
+     Journal_Encode(_record, _journal->buffer + _journal->count * JOURNAL_RECORD_SIZE);
+     _journal->count++;
+
+     // A clock set back is no reason to wait longer.
+     if (_journal->count == JOURNAL_BATCH || _record->type == JOURNAL_TYPE_STOP || _record->time - _journal->oldest >= JOURNAL_FLUSH_SECONDS ||
+          _record->time < _journal->oldest) Journal_Flush(_journal);
+}
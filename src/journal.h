@@ -0,0 +1,90 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - outage journal
+ *
+ * Keeps the history the ENV variable can't: every finished
+ * probe of the main targets and every change of the status,
+ * as fixed size binary records appended to a file. The
+ * report tool (tools/report.c) reads it back and works out
+ * uptime, MTBF, MTTR and the longest outages.
+ *
+ * Records are kept in memory and written in batches - when
+ * JOURNAL_BATCH of them are waiting, when the oldest one is
+ * JOURNAL_FLUSH_SECONDS old, and when the monitor stops - so
+ * the disk is not touched with every probe. The file is only
+ * open while a batch is written.
+ *
+ * A record is 16 bytes, big endian, the same on m68k and x86:
+ *
+ *   0  time       seconds since 1970 by the machine clock
+ *   4  type       JOURNAL_TYPE_*
+ *   5  status     published status, 0 / 1, 0xff unknown
+ *   6  raw        result of the probe before damping
+ *   7  verdict    DIAG_VERDICT_* of the path, 0xff none
+ *   8  rtt        microseconds, 0 without an answer
+ *  12  answered   targets that answered
+ *  13  targets
+ *  14  version    JOURNAL_VERSION
+ *  15  check      XOR of the bytes before - a torn write is skipped
+ *
+ * Time ordered, so a reader can find a time by bisection.
+ * ---------------------------------------------------------*/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "platform.h"
+
+#define JOURNAL_RECORD_SIZE      16
+#define JOURNAL_VERSION          1
+
+#define JOURNAL_BATCH            64        // 1 KB
+#define JOURNAL_FLUSH_SECONDS    600
+
+// Record types.
+#define JOURNAL_TYPE_START       1    // Monitor started - the time before it is not known.
+#define JOURNAL_TYPE_STOP        2    // Stopped - disabled, or the program ended.
+#define JOURNAL_TYPE_PROBE       3    // A probe finished, the status stays.
+#define JOURNAL_TYPE_CHANGE      4    // A probe finished and the published status changed.
+
+// Byte of "unknown" status or verdict.
+#define JOURNAL_UNKNOWN          0xff
+
+struct Journal_Record
+{
+     ULONG time;
+     BYTE  type;              // JOURNAL_TYPE_*
+     BYTE  status;            // -1 unknown, 0 offline, 1 online.
+     BYTE  raw_status;
+     BYTE  verdict;           // DIAG_VERDICT_*, -1 none.
+     ULONG rtt;
+     UBYTE answered;
+     UBYTE targets;
+};
+
+struct Journal
+{
+     const char *path;
+     UBYTE  buffer[JOURNAL_BATCH * JOURNAL_RECORD_SIZE];
+     LONG   count;            // Records in the buffer.
+     ULONG  oldest;           // Time of the first of them.
+     BYTE   status;           // Latest status recorded, for JOURNAL_TYPE_CHANGE.
+
+     ULONG  records;          // Written out,
+     ULONG  flushes;          // in that many batches,
+     ULONG  lost;             // and the ones that could not be written.
+};
+
+void Journal_Init(struct Journal *_journal, const char *_path);
+
+// Adds a record. A JOURNAL_TYPE_PROBE one becomes JOURNAL_TYPE_CHANGE when its status
+// differs from the latest one. JOURNAL_TYPE_STOP writes the batch out.
+void Journal_Add(struct Journal *_journal, struct Journal_Record *_record);
+
+// Writes out what is waiting. Returns 0 if the file can't be written - the batch is lost.
+BYTE Journal_Flush(struct Journal *_journal);
+
+// Record to the 16 bytes and back. Decode returns 0 for a damaged record.
+void Journal_Encode(const struct Journal_Record *_record, UBYTE *_buffer);
+BYTE Journal_Decode(const UBYTE *_buffer, struct Journal_Record *_record);
+
+#endif
@@ -26,30 +26,71 @@
 
 #include <proto/graphics.h>
 
+#include <proto/timer.h>
+
 #include <sys/socket.h>
 #include <proto/socket.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/ioctl.h>
 
+#include <errno.h>
 #include <stdio.h>
 
+#include "http.h"
+#include "journal.h"
+#include "monitor.h"
+#include "notify.h"
+#include "notify_port.h"
+#include "share.h"
+#include "snapshot.h"
+#include "stats.h"
+
 // Application name and version.
 #define   APP_NAME            "msIntenetStatus"
 #define   APP_VERSION         "v0.2"
 #define   APP_DESCRIPTION     "Checks Internet connection status."   
 #define   APP_ENV_NAME        "msInternetStatus"
 
-// Setting bsdsocket version to 3, if 4 some TCP/IP stacks like EasyNet wont work.
-#define   APP_BSDSOCKET_LIB_VERSION     3
+// Round trip times are published next to the status.
+#define   APP_ENV_RTT         APP_ENV_NAME"_RTT"
+#define   APP_ENV_RTT_P50     APP_ENV_NAME"_RTT_P50"
+#define   APP_ENV_RTT_P95     APP_ENV_NAME"_RTT_P95"
+#define   APP_ENV_RTT_MAX     APP_ENV_NAME"_RTT_MAX"
+
+// Counters and timings - written when Exchange asks to show the interface.
+#define   APP_ENV_STATS       APP_ENV_NAME"_STATS"
+
+// State of the host name cache (OK, STALE, FAILED) - only with host name targets.
+#define   APP_ENV_RESOLVER    APP_ENV_NAME"_RESOLVER"
+
+// Status per address family (Online, Offline) - once a probe has tried it.
+#define   APP_ENV_IPV4        APP_ENV_NAME"_IPV4"
+#define   APP_ENV_IPV6        APP_ENV_NAME"_IPV6"
+
+// Result of the latest probe before flap damping - for diagnostics, scripts should watch APP_ENV_NAME.
+#define   APP_ENV_RAW         APP_ENV_NAME"_RAW"
+
+// Where the path breaks, "Offline (gateway)" - only with the GATEWAY tooltype.
+#define   APP_ENV_PATH        APP_ENV_NAME"_PATH"
+
+// Loss in percent and jitter in ms over the recent burst ticks - only with BURST.
+#define   APP_ENV_LOSS        APP_ENV_NAME"_LOSS"
+#define   APP_ENV_JITTER      APP_ENV_NAME"_JITTER"
+
+// Role in the status sharing, "leader" or "follower 192.168.1.5" - only with SHARE.
+#define   APP_ENV_SHARE       APP_ENV_NAME"_SHARE"
+
+// Age in seconds of a status taken from the snapshot - only until the first probe.
+#define   APP_ENV_STALE       APP_ENV_NAME"_STALE"
 
 // Version that appears in Icon->Information.
 static const char  *APP_info_version =	"$VER: Version "APP_VERSION;
 
 // Libs.
 struct Library*     CxBase         = NULL;
-struct Library*     SocketBase     = NULL;
 struct Library*     IconBase       = NULL;
+struct Device*      TimerBase      = NULL;
 
 // Handlers to public screen and visual info.
 struct Screen *APP_pubscreen;
@@ -63,8 +104,32 @@ struct Window  *APP_window;
 #define   DEF_CX_POPUP             "YES"
 #define   DEF_PRIMARY_IP           "216.58.213.0"
 #define   DEF_SECONDARY_IP         "1.1.1.1"
+#define   DEF_PORT                 80
+#define   DEF_TARGETS              ""
+#define   DEF_POLICY               "FIRST"
+#define   DEF_QUORUM               2
 #define   DEF_TIME_INTERVAL        5
-#define   DEF_TCP_TIMEOUT          1
+#define   DEF_TIME_INTERVAL_MAX    0    // Same as the interval - no back-off.
+#define   DEF_CONFIRM_INTERVAL     1
+#define   DEF_JITTER               10
+#define   DEF_TCP_TIMEOUT          0         // Adaptive.
+#define   DEF_TCP_TIMEOUT_MIN      250       // Milliseconds.
+#define   DEF_TCP_TIMEOUT_MAX      5000
+#define   DEF_FLAP_FAILURES        2         // Failed probes of the last FLAP_WINDOW for Offline.
+#define   DEF_FLAP_WINDOW          3
+#define   DEF_FLAP_SUCCESSES       2         // Answered probes in a row for Online again.
+#define   DEF_DNS_SERVER           ""                  // Taken from the TCP/IP stack configuration.
+#define   DEF_DNS_FALLBACK         "1.1.1.1,8.8.8.8"   // If the stack has none in its files.
+#define   DEF_GATEWAY              ""                  // No path diagnosis.
+#define   DEF_GATEWAY_PORT         80                  // Routers answer on their web interface, or with RST.
+#define   DEF_BURST                0                   // Light probes per tick, 0 - no loss sampling.
+#define   DEF_BURST_BUDGET         30                  // Packets per tick - 10 connects.
+#define   DEF_SHARE                ""                  // Every copy probes by itself.
+#define   DEF_SHARE_PORT           SHARE_PORT
+#define   DEF_HTTP                 ""                  // No HTTP listener.
+#define   DEF_HTTP_PORT            HTTP_PORT
+#define   DEF_JOURNAL              ""                  // No outage journal.
+#define   DEF_SNAPSHOT             "ENVARC:msInternetStatus.snapshot"
 #define   DEF_MODE                 "WINDOW_BAR"
 #define   DEF_ONLINE_TXT           "Online"
 #define   DEF_OFFLINE_TXT          "Offline"
@@ -81,26 +146,39 @@ struct Window  *APP_window;
 enum { MODE_LABEL, MODE_BOX, MODE_WINDOW_BAR };
 
 // Input arguments holders.
-BYTE   arg_cx_popup, arg_mode, arg_debug;
-LONG   arg_time_interval, arg_tcp_timeout;
+BYTE   arg_cx_popup, arg_mode, arg_debug, arg_policy;
+LONG   arg_time_interval, arg_tcp_timeout, arg_tcp_timeout_min, arg_tcp_timeout_max;
+LONG   arg_time_interval_max, arg_confirm_interval, arg_jitter, arg_quorum;
+LONG   arg_flap_failures, arg_flap_window, arg_flap_successes;
+LONG   arg_burst, arg_burst_budget;
 LONG   arg_pos_x, arg_pos_y, arg_size_x, arg_size_y;
 LONG   arg_box_online_pen, arg_box_offline_pen;
-STRPTR arg_primary_ip, arg_secondary_ip, arg_online_txt, arg_offline_txt;
+STRPTR arg_primary_ip, arg_secondary_ip, arg_targets, arg_dns_server, arg_gateway, arg_share, arg_http, arg_journal, arg_snapshot;
+STRPTR arg_online_txt, arg_offline_txt;
 STRPTR arg_box_online_color, arg_box_offline_color;
 
 // Other variables.
 BYTE   APP_window_visible;
-LONG   APP_primary_ip_converted, APP_secondary_ip_converted;
 LONG   APP_status_longest_strlen;
 
-// For IP status
-#define IP_STATUS_FAILED       0
-#define IP_STATUS_CONNECTED    1
-#define IP_STATUS_NOT_USED    -1
-
-BYTE   APP_primary_ip_status, APP_secondary_ip_status;
 UBYTE  APP_debug_count;
 
+// What is currently written out - the output stage only touches ENV:,
+// the title bar and the RastPort when these differ from the new values.
+#define APP_ENV_RTT_VARS    4
+
+BYTE   APP_status = -1;                        // Latest probe result, -1 before the first one.
+BYTE   APP_shown_env = -1;                     // Status in APP_ENV_NAME, -1 if not written.
+BYTE   APP_shown_window = -1;                  // Status drawn in the window, -1 if not drawn.
+char   APP_shown_rtt[APP_ENV_RTT_VARS][16];    // Texts of the RTT variables, empty if not written.
+BYTE   APP_shown_resolver = -1;                // State in APP_ENV_RESOLVER, -1 if not written.
+BYTE   APP_shown_family[NET_FAMILIES] = { -1, -1 };    // Status in APP_ENV_IPV4 and APP_ENV_IPV6, -1 if not written.
+BYTE   APP_shown_raw = -1;                     // Status in APP_ENV_RAW, -1 if not written.
+BYTE   APP_shown_path = DIAG_VERDICT_NONE;     // Verdict in APP_ENV_PATH, DIAG_VERDICT_ONLINE for Online.
+char   APP_shown_loss[16];                     // Texts of APP_ENV_LOSS and APP_ENV_JITTER, empty if not written.
+char   APP_shown_jitter[16];
+char   APP_shown_share[32];                    // Text of APP_ENV_SHARE, empty if not written.
+
 // Commodity globals.
 struct NewBroker cx_newbroker = 
 {
@@ -118,21 +196,85 @@ struct NewBroker cx_newbroker =
 struct MsgPort*     cx_broker_message_port;
 CxObj*              cx_broker;
 
+// Notification globals - the public port, see notify_port.h.
+struct MsgPort*     notify_port;
+struct Notify       APP_notify;
+LONG                notify_out;        // CHANGED messages not replied yet.
+
 // Timer globals.
 struct MsgPort*     timer_message_port;
 struct timerequest* timer_io;
+BYTE                timer_armed;       // timer_io is out at timer.device.
+TIME_US             timer_deadline;    // Platform_Time() it was sent for.
 
 // Helper functions.
 void Timer_Send(ULONG _sec, ULONG _micro)
 {
      timer_io->tr_node.io_Command 	= TR_ADDREQUEST;
 
-     timer_io->tr_time.tv_micro	= _micro;
-     timer_io->tr_time.tv_sec      = 0;     
+     // tv_sec and tv_usec are only other names of these two fields,
+     // setting them too would zero the microseconds.
      timer_io->tr_time.tv_secs    	= _sec;
-     timer_io->tr_time.tv_usec     = 0;
+     timer_io->tr_time.tv_micro	= _micro;
      
      SendIO((struct IORequest *)timer_io);
+     timer_armed = 1;
+}
+// Microseconds from the E-Clock - deadlines of the monitor core are kept in these.
+TIME_US Platform_Time(void)
+{
+     if (TimerBase == NULL) return 0;
+
+     struct EClockVal eclock;
+     ULONG frequency = ReadEClock(&eclock);
+
+     TIME_US ticks = ((TIME_US)eclock.ev_hi << 32) | eclock.ev_lo;
+
+     return (ticks / frequency) * 1000000ULL + (ticks % frequency) * 1000000ULL / frequency;
+}
+// Seconds since 1970 by the system clock, which counts from 1978 - for the
+// journal and the snapshot, which outlive the process.
+ULONG Platform_Clock(void)
+{
+     struct DateStamp date;
+
+     DateStamp(&date);
+
+     return 252460800UL + (ULONG)date.ds_Days * 86400 + (ULONG)date.ds_Minute * 60 + (ULONG)date.ds_Tick / TICKS_PER_SECOND;
+}
+void Timer_Abort(void)
+{
+     if (!timer_armed) return;
+
+     AbortIO(timer_io); 
+     WaitIO(timer_io);
+     timer_armed = 0;
+
+     // Clear the signal, so it is not taken for the next request.
+     SetSignal(0L, 1L << timer_message_port->mp_SigBit);
+}
+// Makes timer_io fire at the given Platform_Time() - resent only if the deadline moved.
+// WHEEL_NEVER takes it back.
+void Timer_Arm(TIME_US _deadline)
+{
+     if (timer_armed && timer_deadline == _deadline) return;
+
+     if (_deadline == WHEEL_NEVER)
+     {
+          Timer_Abort();
+          return;
+     }
+
+     Timer_Abort();
+
+     TIME_US now = Platform_Time();
+     TIME_US wait = _deadline > now ? _deadline - now : 0;
+
+     // Zero is not a valid request - 1 us just means "as soon as possible".
+     if (wait == 0) wait = 1;
+
+     Timer_Send((ULONG)(wait / 1000000), (ULONG)(wait % 1000000));
+     timer_deadline = _deadline;
 }
 int  Timer_Init()
 {
@@ -150,7 +292,8 @@ int  Timer_Init()
 	if (OpenDevice(TIMERNAME, UNIT_VBLANK, (struct IORequest *)timer_io, 0L))
           return 0;
 
-     Timer_Send(0, 1);
+     // Needed for ReadEClock().
+     TimerBase = timer_io->tr_node.io_Device;
 
      return 1;
 }
@@ -159,11 +302,10 @@ void Timer_Cleanup()
      if (timer_io)
      {
           // All I/O requests must be complete before CloseDevice().
-          AbortIO(timer_io); 
+          Timer_Abort();
 
           // Clean up.
-          WaitIO(timer_io);
-          CloseDevice( (struct IORequest*) timer_io);     
+          if (TimerBase) CloseDevice( (struct IORequest*) timer_io);     
           DeleteExtIO( (struct IORequest*) timer_io);
      }
 
@@ -271,6 +413,9 @@ BYTE Intuition_Window_Create(void)
      {
           // Set Font - needed for Text() funciton.
           SetFont(APP_window->RPort, APP_pubscreen->RastPort.Font);
+
+          // New window is empty - the status has to be drawn again.
+          APP_shown_window = -1;
           return 1;
      }
 
@@ -289,126 +434,850 @@ void Intuition_Window_Cleanup(void)
      UnlockPubScreen(NULL, APP_pubscreen);
 }
 
-BYTE Test_Connection_Socket(LONG _ip_converted, BYTE *_ip_status)
+// Probing, scheduling and RTT statistics - the platform neutral core.
+// This file only waits for what it asks for and publishes the status.
+struct Monitor APP_monitor;
+
+// Deadlines of all monitors, timer_io is only ever out for the earliest one.
+struct Wheel APP_wheel;
+
+// Addresses of host name targets of all channels, looked up by our own
+// queries in the same WaitSelect() set - bsdsocket gethostbyname() blocks.
+struct Resolver APP_resolver;
+
+// Name server configuration of the common TCP/IP stacks, "nameserver ip" lines.
+static const char *APP_dns_config[] = { "DEVS:Internet/name_resolution", "AmiTCP:db/netdb" };
+
+// Gateway and name servers probed along with the main targets, with GATEWAY.
+struct Diag APP_diag;
+
+// Light probes of the main targets for loss and jitter, with BURST.
+struct Burst APP_burst;
+
+// One prober for the copies on the subnet, with SHARE.
+struct Share APP_share;
+
+// Status and metrics for a scraper on the LAN, with HTTP.
+struct Http APP_http;
+
+// History of the main status in a file, with JOURNAL - tools/report.c reads it.
+struct Journal APP_journal;
+BYTE   APP_journal_started;    // A START without its STOP yet.
+
+// Last status for the next start, with SNAPSHOT.
+struct Snapshot APP_snapshot;
+BYTE   APP_stale;              // APP_status came from it, no probe has finished yet.
+ULONG  APP_snapshot_age;       // Seconds, when it was read.
+
+// Default route for GATEWAY=AUTO - Roadshow keeps "DEFAULT ip" in its routes file.
+static const char *APP_route_config[] = { "DEVS:Internet/routes" };
+
+// Extra named channels (CHANNEL1..CHANNEL8 tooltypes), each with its own
+// targets, interval and ENV variable, served by the same loop and timer.
+#define   APP_MAX_CHANNELS    8
+#define   APP_ENV_CHANNEL     APP_ENV_NAME"."
+
+struct App_Channel
 {
-     // Try open a socket.
-	LONG my_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-	if (my_socket == -1) 
-          return 0;
+     char           name[32];
+     char           env_name[64];        // msInternetStatus.<name>
+     char           env_rtt[64];         // msInternetStatus.<name>_RTT
+     struct Monitor monitor;
+     BYTE           shown_env;           // Status in env_name, -1 if not written.
+     char           shown_rtt[16];       // Text in env_rtt, empty if not written.
+};
+
+struct App_Channel APP_channel[APP_MAX_CHANNELS];
+LONG   APP_channel_count;
+
+// All monitors served by the loop, the main one first.
+struct Monitor *APP_monitors[1 + APP_MAX_CHANNELS];
+LONG   APP_monitor_count;
+
+// Sockets of all channels go into one WaitSelect() set, next to the name lookups.
+#define   APP_MAX_TARGETS     64
+
+// All targets with an attempt of each family, the hops and the burst of the
+// main monitor, the lookups, the share socket and the HTTP listener with its clients.
+#define   APP_MAX_WATCH       (APP_MAX_TARGETS * NET_FAMILIES + DIAG_MAX_WATCH + BURST_MAX_PROBES + RESOLVE_MAX_NAMES + 1 + 1 + HTTP_MAX_CLIENTS)
 
-	// Try set socket to non-blocking mode.
-	LONG mode = 1;
-	LONG result = IoctlSocket(my_socket, FIONBIO, &mode);
-	if (result == -1) 
+#if APP_MAX_WATCH > NET_MAX_WATCH
+     #error "APP_MAX_WATCH does not fit in the socket table, raise NET_MAX_WATCH."
+#endif
+
+LONG   APP_target_total;
+
+// What opening bsdsocket.library on every probe would add to its
+// start cost (measured once, in debug mode).
+ULONG  APP_tick_reopen_micro;
+
+// Adds host[:port] entries separated by commas or spaces, invalid ones are skipped.
+// Returns number of targets added.
+LONG Targets_Parse(struct Monitor *_monitor, CONST_STRPTR _list)
+{
+     char entry[96];
+     LONG length = 0;
+     LONG added = 0;
+
+     for (CONST_STRPTR text = _list; ; text++)
      {
-          CloseSocket(my_socket);
-          return 0;
+          if (*text && *text != ',' && *text != ' ')
+          {
+               if (length < (LONG)sizeof(entry) - 1) entry[length++] = *text;
+               continue;
+          }
+
+          if (length)
+          {
+               struct Probe_Target target;
+
+               entry[length] = 0;
+               length = 0;
+
+               if (!Probe_Parse_Target(entry, DEF_PORT, &target, &APP_resolver))
+                    printf("%s: Error! Bad target %s.\n", APP_NAME, entry);
+               else if (APP_target_total >= APP_MAX_TARGETS || !Monitor_Add_Parsed(_monitor, &target))
+                    printf("%s: Error! Too many targets, %s skipped.\n", APP_NAME, entry);
+               else
+               {
+                    APP_target_total++;
+                    added++;
+               }
+          }
+
+          if (*text == 0) break;
      }
 
-     // Create primary IP adress structure.
-	struct sockaddr_in ip_addr;
-	memset ( &ip_addr , 0 , sizeof(struct sockaddr_in) );
+     return added;
+}
 
-	ip_addr.sin_family = AF_INET;
-	ip_addr.sin_addr.s_addr = _ip_converted;
-	ip_addr.sin_port = htons(80);
+// Adds ip[:port] name servers separated by commas or spaces. Returns number added.
+LONG Servers_Parse(CONST_STRPTR _list)
+{
+     char entry[32];
+     LONG length = 0;
+     LONG added = 0;
 
-     // Try to connect to primary IP.
-     connect(my_socket, (struct sockaddr*)&ip_addr, sizeof(ip_addr));
-   
-     struct timeval timeout;
-     timeout.tv_sec = arg_tcp_timeout;
-     timeout.tv_usec = 0;
- 
-     // initialize the bit sets
-     fd_set reading, writing, except;
-
-     FD_ZERO( &reading );
-     FD_ZERO( &writing );
-     FD_ZERO( &except );
- 
-     // add r, w, and e to the appropriate bit set
-     FD_SET( my_socket, &reading );
-     FD_SET( my_socket, &writing );
-     FD_SET( my_socket, &except );
- 
-     // for efficiency, what's the maximum socket number? 
-     LONG max_sock = 1;
-
-     // poll
-     LONG rc = WaitSelect( max_sock, &reading, &writing, &except, &timeout, NULL );
-
-     if (rc > 0)
-     {
-          // The connection with IP succeded.
-          *_ip_status = IP_STATUS_CONNECTED;
-          CloseSocket(my_socket);
-          return 1;
+     for (CONST_STRPTR text = _list; ; text++)
+     {
+          if (*text && *text != ',' && *text != ' ')
+          {
+               if (length < (LONG)sizeof(entry) - 1) entry[length++] = *text;
+               continue;
+          }
+
+          if (length)
+          {
+               entry[length] = 0;
+               length = 0;
+
+               if (Resolve_Add_Server(&APP_resolver, entry)) added++;
+               else printf("%s: Error! Bad DNS server %s.\n", APP_NAME, entry);
+          }
+
+          if (*text == 0) break;
+     }
+
+     return added;
+}
+
+// CHANNELn=NAME|TARGETS[|INTERVAL[|POLICY]] - POLICY is FIRST, ALL or number of answers needed.
+BYTE Channel_Init(struct App_Channel *_channel, CONST_STRPTR _text)
+{
+     char buffer[256];
+     STRPTR field[4] = { NULL, NULL, NULL, NULL };
+     LONG fields = 0;
+
+     strncpy(buffer, _text, sizeof(buffer) - 1);
+     buffer[sizeof(buffer) - 1] = 0;
+
+     for (STRPTR text = buffer; fields < 4; )
+     {
+          field[fields++] = text;
+
+          text = strchr(text, '|');
+          if (text == NULL) break;
+          *text++ = 0;
      }
+
+     if (fields < 2) return 0;
+
+     // Name becomes part of the ENV variable name.
+     STRPTR name = field[0];
+     if (name[0] == 0 || strlen(name) >= sizeof(_channel->name)) return 0;
+
+     for (STRPTR c = name; *c; c++)
+          if (*c == '/' || *c == ':' || *c == ' ') return 0;
+
+     LONG interval = arg_time_interval;
+     if (fields > 2 && field[2][0]) interval = atoi(field[2]);
+     if (interval < 2)    interval = arg_time_interval;
+     if (interval > 3600) interval = 3600;
+
+     // Backs off only when the main one does, never below its own interval.
+     LONG interval_max = arg_time_interval_max > arg_time_interval && arg_time_interval_max > interval ? arg_time_interval_max : interval;
+     LONG confirm = arg_confirm_interval < interval ? arg_confirm_interval : interval;
+
+     strcpy(_channel->name, name);
+     sprintf(_channel->env_name, "%s%s", APP_ENV_CHANNEL, name);
+     sprintf(_channel->env_rtt, "%s%s_RTT", APP_ENV_CHANNEL, name);
+
+     Monitor_Init(&_channel->monitor, interval * 1000, interval_max * 1000, confirm * 1000, arg_jitter, &APP_wheel);
+     Monitor_Set_Timeout(&_channel->monitor, arg_tcp_timeout * 1000000, arg_tcp_timeout_min * 1000, arg_tcp_timeout_max * 1000);
+     Monitor_Set_Damping(&_channel->monitor, arg_flap_failures, arg_flap_window, arg_flap_successes);
+     _channel->monitor.user = _channel;
+
+     if (fields > 3)
+     {
+          if (strcmp(field[3], "ALL") == 0)  Monitor_Set_Policy(&_channel->monitor, PROBE_POLICY_ALL, 0);
+          else if (atoi(field[3]) > 0)       Monitor_Set_Policy(&_channel->monitor, PROBE_POLICY_QUORUM, atoi(field[3]));
+     }
+
+     if (Targets_Parse(&_channel->monitor, field[1]) == 0) return 0;
+
+     _channel->shown_env = -1;
+     _channel->shown_rtt[0] = 0;
+
+     return 1;
+}
+
+void Test_Connection_Init(CONST_STRPTR *_tool_types)
+{
+     Wheel_Init(&APP_wheel);
+     Resolve_Init(&APP_resolver, &APP_wheel);
+
+     Monitor_Init(&APP_monitor, arg_time_interval * 1000, arg_time_interval_max * 1000, arg_confirm_interval * 1000, arg_jitter, &APP_wheel);
+     Monitor_Set_Policy(&APP_monitor, arg_policy, arg_quorum);
+     Monitor_Set_Timeout(&APP_monitor, arg_tcp_timeout * 1000000, arg_tcp_timeout_min * 1000, arg_tcp_timeout_max * 1000);
+     Monitor_Set_Damping(&APP_monitor, arg_flap_failures, arg_flap_window, arg_flap_successes);
+
+     APP_target_total = 0;
+
+     // All targets are tried at the same time, in one WaitSelect() set.
+     // This way the worst case is one TCP_TIMEOUT, not one per target.
+     Targets_Parse(&APP_monitor, arg_targets);
+
+     // No TARGETS - PRIMARY_IP and SECONDARY_IP (address or host name), invalid ones fall back to defaults.
+     if (APP_monitor.probe.target_count == 0)
+     {
+          struct Probe_Target target;
+
+          if (!Probe_Parse_Target((char*)arg_primary_ip, DEF_PORT, &target, &APP_resolver))
+          {
+               arg_primary_ip = (STRPTR)DEF_PRIMARY_IP;
+               Probe_Parse_Target((char*)arg_primary_ip, DEF_PORT, &target, NULL);
+          }
+          if (Monitor_Add_Parsed(&APP_monitor, &target)) APP_target_total++;
+
+          if (!Probe_Parse_Target((char*)arg_secondary_ip, DEF_PORT, &target, &APP_resolver))
+          {
+               arg_secondary_ip = (STRPTR)DEF_SECONDARY_IP;
+               Probe_Parse_Target((char*)arg_secondary_ip, DEF_PORT, &target, NULL);
+          }
+          if (Monitor_Add_Parsed(&APP_monitor, &target)) APP_target_total++;
+     }
+
+     APP_monitors[0] = &APP_monitor;
+     APP_monitor_count = 1;
+
+     // Named channels - invalid ones are left out.
+     APP_channel_count = 0;
+
+     for (LONG i = 0; i < APP_MAX_CHANNELS; i++)
+     {
+          char tool_type[16];
+          sprintf(tool_type, "CHANNEL%ld", (long)(i + 1));
+
+          CONST_STRPTR text = (CONST_STRPTR)ArgString(_tool_types, tool_type, "");
+          if (text[0] == 0) continue;
+
+          struct App_Channel *channel = &APP_channel[APP_channel_count];
+
+          if (!Channel_Init(channel, text))
+          {
+               printf("%s: Error! Bad %s.\n", APP_NAME, tool_type);
+               continue;
+          }
+
+          APP_monitors[APP_monitor_count++] = &channel->monitor;
+          APP_channel_count++;
+     }
+
+     // Name servers - only needed with host name targets and the path diagnosis. DNS_SERVER,
+     // then what the TCP/IP stack has in its files. With DHCP it may have them only in memory.
+     if (APP_resolver.name_count || arg_gateway[0])
+     {
+          Servers_Parse(arg_dns_server);
+
+          for (LONG i = 0; i < (LONG)(sizeof(APP_dns_config) / sizeof(APP_dns_config[0])) && APP_resolver.server_count == 0; i++)
+               Resolve_Read_Servers(&APP_resolver, APP_dns_config[i]);
+
+          if (APP_resolver.server_count == 0) Servers_Parse((CONST_STRPTR)DEF_DNS_FALLBACK);
+     }
+
+     // Path diagnosis of the main targets - the gateway and the name servers are probed with them.
+     if (arg_gateway[0])
+     {
+          struct Probe_Target target;
+
+          Diag_Init(&APP_diag);
+
+          if (strcmp(arg_gateway, "AUTO") == 0)
+          {
+               for (LONG i = 0; i < (LONG)(sizeof(APP_route_config) / sizeof(APP_route_config[0])) && APP_diag.hop[DIAG_HOP_GATEWAY].target_count == 0; i++)
+                    Diag_Read_Gateway(&APP_diag, APP_route_config[i], DEF_GATEWAY_PORT);
+
+               if (APP_diag.hop[DIAG_HOP_GATEWAY].target_count == 0) printf("%s: Error! No default gateway found, set GATEWAY.\n", APP_NAME);
+          }
+          else if (!Probe_Parse_Target((char*)arg_gateway, DEF_GATEWAY_PORT, &target, NULL) || !Diag_Add(&APP_diag, DIAG_HOP_GATEWAY, &target))
+               printf("%s: Error! Bad GATEWAY %s.\n", APP_NAME, arg_gateway);
+
+          Diag_Add_Servers(&APP_diag, &APP_resolver);
+          Monitor_Set_Diag(&APP_monitor, &APP_diag);
+     }
+
+     // Loss sampling of the main targets - BURST light probes with every probe, within BURST_BUDGET packets.
+     if (arg_burst)
+     {
+          Burst_Init(&APP_burst, arg_burst, arg_burst_budget, &APP_wheel);
+          Monitor_Set_Burst(&APP_monitor, &APP_burst);
+     }
+
+     // Status sharing of the main targets - the copies on the subnet elect one prober, the heartbeat is TIME_INTERVAL.
+     if (arg_share[0])
+     {
+          ULONG address;
+          UWORD port = DEF_SHARE_PORT;
+
+          if (Net_Parse_Target((char*)arg_share, &address, &port))
+               Share_Init(&APP_share, &APP_monitor, address, port, arg_time_interval * 1000, (ULONG)FindTask(NULL) ^ (ULONG)Platform_Time(), &APP_wheel);
+          else
+          {
+               printf("%s: Error! Bad SHARE %s.\n", APP_NAME, arg_share);
+               arg_share = (STRPTR)"";
+          }
+     }
+
+     // HTTP listener for the main monitor and the channels - a bare port listens on all interfaces.
+     if (arg_http[0])
+     {
+          ULONG address = 0;
+          UWORD port = DEF_HTTP_PORT;
+
+          if (Net_Parse_Port((char*)arg_http, &port) || Net_Parse_Target((char*)arg_http, &address, &port))
+          {
+               Http_Init(&APP_http, &APP_monitor, address, port);
+               for (LONG i = 0; i < APP_channel_count; i++) Http_Add_Channel(&APP_http, APP_channel[i].name, &APP_channel[i].monitor);
+          }
+          else
+          {
+               printf("%s: Error! Bad HTTP %s.\n", APP_NAME, arg_http);
+               arg_http = (STRPTR)"";
+          }
+     }
+
+     Journal_Init(&APP_journal, arg_journal);
+
+     // Last status of the previous run, if there is one - RTT and timeout are warm
+     // right away, the status is shown until the first probe is done.
+     Snapshot_Init(&APP_snapshot, arg_snapshot);
+     APP_status = Snapshot_Load(&APP_snapshot, &APP_monitor, Platform_Clock(), &APP_snapshot_age);
+     APP_stale = APP_status >= 0;
+
+     // For debug output - what one OpenLibrary()/CloseLibrary() pair would cost on each tick.
+     APP_tick_reopen_micro = 0;
+     if (arg_debug)
+     {
+          TIME_US start_time = Platform_Time();
+
+          struct Library *library = OpenLibrary("bsdsocket.library", NET_BSDSOCKET_LIB_VERSION);
+          if (library)
+          {
+               CloseLibrary(library);
+               APP_tick_reopen_micro = (ULONG)(Platform_Time() - start_time);
+          }
+     }
+}
+
+void Status_Set_Rtt_Var(char *_shown, CONST_STRPTR _name, ULONG _micro, BYTE _valid)
+{
+     char text[16];
+
+     if (_valid) Rtt_Format(_micro, text);
+     else        strcpy(text, "-");
+
+     // Shown with 0.1 ms resolution - often the same text as last time.
+     if (strcmp(text, _shown) == 0)
+     {
+          Stats_Count(STATS_ENV_WRITES_SAVED);
+          return;
+     }
+
+     SetVar(_name, text, -1, GVF_GLOBAL_ONLY);
+     strcpy(_shown, text);
+     Stats_Count(STATS_ENV_WRITES);
+}
+void Status_Show_Rtt(BYTE _online)
+{
+     // Current RTT only makes sense for a probe that got an answer,
+     // the percentiles describe the recent successful ones.
+     struct Rtt_Window *rtt = &APP_monitor.rtt;
+     BYTE have_samples = rtt->count > 0;
+
+     Status_Set_Rtt_Var(APP_shown_rtt[0], APP_ENV_RTT, rtt->last, _online);
+     Status_Set_Rtt_Var(APP_shown_rtt[1], APP_ENV_RTT_P50, Rtt_Percentile(rtt, 50), have_samples);
+     Status_Set_Rtt_Var(APP_shown_rtt[2], APP_ENV_RTT_P95, Rtt_Percentile(rtt, 95), have_samples);
+     Status_Set_Rtt_Var(APP_shown_rtt[3], APP_ENV_RTT_MAX, Rtt_Max(rtt), have_samples);
+}
+// Resolver state apart from the status - a stale or failed name is not a dead link.
+void Status_Show_Resolver(void)
+{
+     if (APP_resolver.name_count == 0) return;
+
+     BYTE state = Resolve_State(&APP_resolver);
+
+     if (state == APP_shown_resolver)
+     {
+          Stats_Count(STATS_ENV_WRITES_SAVED);
+          return;
+     }
+
+     SetVar(APP_ENV_RESOLVER, (STRPTR)Resolve_State_Text(state), -1, GVF_GLOBAL_ONLY);
+     APP_shown_resolver = state;
+     Stats_Count(STATS_ENV_WRITES);
+}
+// Undamped result next to the published one.
+void Status_Show_Raw(void)
+{
+     BYTE raw = APP_monitor.raw_status;
+
+     if (raw < 0) return;
+
+     if (raw == APP_shown_raw)
+     {
+          Stats_Count(STATS_ENV_WRITES_SAVED);
+          return;
+     }
+
+     SetVar(APP_ENV_RAW, raw ? arg_online_txt : arg_offline_txt, -1, GVF_GLOBAL_ONLY);
+     APP_shown_raw = raw;
+     Stats_Count(STATS_ENV_WRITES);
+}
+// Verdict of the path diagnosis - the hop of the latest failed probe while Offline.
+void Status_Show_Path(void)
+{
+     if (APP_monitor.diag == NULL || APP_monitor.status < 0) return;
+
+     BYTE verdict = APP_monitor.status ? DIAG_VERDICT_ONLINE : APP_diag.failure;
+
+     if (verdict == APP_shown_path)
+     {
+          Stats_Count(STATS_ENV_WRITES_SAVED);
+          return;
+     }
+
+     char text[64];
+
+     if (verdict == DIAG_VERDICT_ONLINE) strcpy(text, arg_online_txt);
+     else sprintf(text, "%.40s (%s)", arg_offline_txt, Diag_Verdict_Text(verdict));
+
+     SetVar(APP_ENV_PATH, text, -1, GVF_GLOBAL_ONLY);
+     APP_shown_path = verdict;
+     Stats_Count(STATS_ENV_WRITES);
+}
+// Loss and jitter of the burst probes - once a tick has been sampled.
+void Status_Show_Loss(void)
+{
+     LONG permille = Burst_Loss(&APP_burst);
+
+     if (APP_monitor.burst == NULL || permille < 0) return;
+
+     char text[16];
+     sprintf(text, "%ld.%ld", (long)(permille / 10), (long)(permille % 10));
+
+     if (strcmp(text, APP_shown_loss) == 0) Stats_Count(STATS_ENV_WRITES_SAVED);
      else
      {
-          // IP connection failed.
-          *_ip_status = IP_STATUS_FAILED;
-          CloseSocket(my_socket);   
-          return 0;
+          SetVar(APP_ENV_LOSS, text, -1, GVF_GLOBAL_ONLY);
+          strcpy(APP_shown_loss, text);
+          Stats_Count(STATS_ENV_WRITES);
      }
+
+     Status_Set_Rtt_Var(APP_shown_jitter, APP_ENV_JITTER, Burst_Jitter(&APP_burst), APP_burst.jitter_count > 0);
 }
-BYTE Test_Connection(void)
+// Role in the status sharing, and whose status a follower shows.
+void Status_Show_Share(void)
 {
-     // Try open socket library.
-     SocketBase = (struct Library*)OpenLibrary("bsdsocket.library", APP_BSDSOCKET_LIB_VERSION);
-	if (SocketBase == NULL) 
-          return 0;
+     if (!arg_share[0] || APP_share.role == SHARE_ROLE_NONE) return;
+
+     char text[32], ip_text[16];
 
-     // Connection status.
-     APP_primary_ip_status = IP_STATUS_NOT_USED;
-     APP_secondary_ip_status = IP_STATUS_NOT_USED;
+     Net_Format_Ip(APP_share.leader_ip, ip_text);
+     if (APP_share.role == SHARE_ROLE_FOLLOWER && APP_share.leader_id) sprintf(text, "%s %s", Share_Role_Text(APP_share.role), ip_text);
+     else strcpy(text, Share_Role_Text(APP_share.role));
 
-     // Trying primary IP.
-     APP_primary_ip_converted = inet_addr(arg_primary_ip);
-     if (APP_primary_ip_converted == INADDR_NONE) 
+     if (strcmp(text, APP_shown_share) == 0)
      {
-          APP_primary_ip_converted = inet_addr(DEF_PRIMARY_IP);
-          strcpy(arg_primary_ip, DEF_PRIMARY_IP);
+          Stats_Count(STATS_ENV_WRITES_SAVED);
+          return;
      }
 
-     if (Test_Connection_Socket(APP_primary_ip_converted, &APP_primary_ip_status))
+     SetVar(APP_ENV_SHARE, text, -1, GVF_GLOBAL_ONLY);
+     strcpy(APP_shown_share, text);
+     Stats_Count(STATS_ENV_WRITES);
+}
+// Status per address family - a family no probe has tried yet is not written.
+void Status_Show_Families(void)
+{
+     for (BYTE family = 0; family < NET_FAMILIES; family++)
      {
-          CloseLibrary(SocketBase);
-          return 1;
+          BYTE status = APP_monitor.family_status[(UBYTE)family];
+
+          if (status < 0) continue;
+
+          if (status == APP_shown_family[(UBYTE)family])
+          {
+               Stats_Count(STATS_ENV_WRITES_SAVED);
+               continue;
+          }
+
+          SetVar(family == NET_FAMILY_V6 ? APP_ENV_IPV6 : APP_ENV_IPV4, status ? arg_online_txt : arg_offline_txt, -1, GVF_GLOBAL_ONLY);
+          APP_shown_family[(UBYTE)family] = status;
+          Stats_Count(STATS_ENV_WRITES);
+     }
+}
+// Channel status and RTT - only what changed.
+void Channel_Output(struct App_Channel *_channel)
+{
+     BYTE status = _channel->monitor.status;
+     if (status < 0) return;
+
+     if (_channel->shown_env != status)
+     {
+          SetVar(_channel->env_name, status ? arg_online_txt : arg_offline_txt, -1, GVF_GLOBAL_ONLY);
+          _channel->shown_env = status;
+          Stats_Count(STATS_ENV_WRITES);
+     }
+     else
+          Stats_Count(STATS_ENV_WRITES_SAVED);
+
+     Status_Set_Rtt_Var(_channel->shown_rtt, _channel->env_rtt, _channel->monitor.rtt.last, status);
+}
+// Forgets what was written out, so the next Status_Output() writes everything again.
+void Status_Invalidate(void)
+{
+     APP_shown_env = -1;
+     APP_shown_window = -1;
+     APP_shown_resolver = -1;
+     APP_shown_family[NET_FAMILY_V4] = APP_shown_family[NET_FAMILY_V6] = -1;
+     APP_shown_raw = -1;
+     APP_shown_path = DIAG_VERDICT_NONE;
+     APP_shown_loss[0] = APP_shown_jitter[0] = 0;
+     APP_shown_share[0] = 0;
+
+     for (LONG i = 0; i < APP_ENV_RTT_VARS; i++) APP_shown_rtt[i][0] = 0;
+
+     for (LONG i = 0; i < APP_channel_count; i++)
+     {
+          APP_channel[i].shown_env = -1;
+          APP_channel[i].shown_rtt[0] = 0;
+     }
+}
+void Status_Delete(void)
+{
+     DeleteVar(APP_ENV_NAME, GVF_GLOBAL_ONLY);
+     DeleteVar(APP_ENV_RTT, GVF_GLOBAL_ONLY);
+     DeleteVar(APP_ENV_RTT_P50, GVF_GLOBAL_ONLY);
+     DeleteVar(APP_ENV_RTT_P95, GVF_GLOBAL_ONLY);
+     DeleteVar(APP_ENV_RTT_MAX, GVF_GLOBAL_ONLY);
+     DeleteVar(APP_ENV_STATS, GVF_GLOBAL_ONLY);
+     DeleteVar(APP_ENV_RESOLVER, GVF_GLOBAL_ONLY);
+     DeleteVar(APP_ENV_IPV4, GVF_GLOBAL_ONLY);
+     DeleteVar(APP_ENV_IPV6, GVF_GLOBAL_ONLY);
+     DeleteVar(APP_ENV_RAW, GVF_GLOBAL_ONLY);
+     DeleteVar(APP_ENV_PATH, GVF_GLOBAL_ONLY);
+     DeleteVar(APP_ENV_LOSS, GVF_GLOBAL_ONLY);
+     DeleteVar(APP_ENV_JITTER, GVF_GLOBAL_ONLY);
+     DeleteVar(APP_ENV_SHARE, GVF_GLOBAL_ONLY);
+     DeleteVar(APP_ENV_STALE, GVF_GLOBAL_ONLY);
+
+     for (LONG i = 0; i < APP_channel_count; i++)
+     {
+          DeleteVar(APP_channel[i].env_name, GVF_GLOBAL_ONLY);
+          DeleteVar(APP_channel[i].env_rtt, GVF_GLOBAL_ONLY);
+     }
+
+     Status_Invalidate();
+}
+// Writes out APP_status - only the parts that changed.
+void Status_Output(void)
+{
+     if (APP_status < 0) return;
+
+     STRPTR status_txt = APP_status ? arg_online_txt : arg_offline_txt;
+     LONG   box_pen    = APP_status ? arg_box_online_pen : arg_box_offline_pen;
+
+     // Set global ENV variable in System - each write wakes up everything watching ENV:.
+     if (APP_shown_env != APP_status)
+     {
+          SetVar(APP_ENV_NAME, status_txt, -1, GVF_GLOBAL_ONLY);
+          APP_shown_env = APP_status;
+          Stats_Count(STATS_ENV_WRITES);
      }
      else
+          Stats_Count(STATS_ENV_WRITES_SAVED);
+
+     Status_Show_Rtt(APP_monitor.raw_status > 0);
+     Status_Show_Raw();
+     Status_Show_Path();
+     Status_Show_Loss();
+     Status_Show_Share();
+     Status_Show_Resolver();
+     Status_Show_Families();
+
+     // Only if window is visible.
+     if (!APP_window_visible) return;
+
+     if (APP_shown_window == APP_status)
+     {
+          Stats_Count(STATS_REDRAWS_SAVED);
+          return;
+     }
+
+     switch(arg_mode)
+     {
+          case MODE_LABEL:
+               SetAPen(APP_window->RPort, 2);
+               RectFill(APP_window->RPort, 0, 0, arg_size_x, arg_size_y);
+               SetAPen(APP_window->RPort, 1);
+               SetBPen(APP_window->RPort, 2);
+               Move(APP_window->RPort, 0, APP_pubscreen->RastPort.TxBaseline);
+               Text(APP_window->RPort, (CONST_STRPTR)status_txt, strlen(status_txt));
+               SetWindowTitles(APP_window, status_txt, status_txt);
+               break;
+
+          case MODE_BOX:
+               SetAPen(APP_window->RPort, box_pen);
+               RectFill(APP_window->RPort, 0, 0, arg_size_x, arg_size_y);
+               SetWindowTitles(APP_window, status_txt, status_txt);
+               break;
+
+          case MODE_WINDOW_BAR:
+               SetWindowTitles(APP_window, status_txt, status_txt);
+               break;
+     }
+
+     APP_shown_window = APP_status;
+     Stats_Count(STATS_REDRAWS);
+}
+
+// Public port for the subscribers. A second copy can't run, so the name is ours.
+BYTE Notify_Port_Create(void)
+{
+     notify_port = CreateMsgPort();
+     if (notify_port == NULL) return 0;
+
+     notify_port->mp_Node.ln_Name = (char*)NOTIFY_PORT_NAME;
+     notify_port->mp_Node.ln_Pri = 0;
+     AddPort(notify_port);
+
+     Notify_Init(&APP_notify);
+     notify_out = 0;
+     return 1;
+}
+
+// The current state into a command or CHANGED message.
+void Notify_Port_Fill(struct Notify_Message *_message)
+{
+     struct Notify_State *state = &APP_notify.state;
+
+     _message->nm_Status = state->status;
+     _message->nm_Rtt = state->rtt;
+     _message->nm_RttBucket = state->rtt_bucket;
+     _message->nm_Sequence = state->status_seq;
+}
+
+// CHANGED messages to the subscribers that did not hear the state yet
+// and replied the previous one.
+void Notify_Port_Send(void)
+{
+     for (LONG i = 0; i < APP_notify.client_count; i++)
+     {
+          struct Notify_Client *client = &APP_notify.client[i];
+          if (!Notify_Pending(&APP_notify, client)) continue;
+
+          struct Notify_Message *message = AllocVec(sizeof(struct Notify_Message), MEMF_PUBLIC | MEMF_CLEAR);
+          if (message == NULL) return;
+
+          message->nm_Message.mn_ReplyPort = notify_port;
+          message->nm_Message.mn_Length = sizeof(struct Notify_Message);
+          message->nm_Command = NOTIFY_CMD_CHANGED;
+          message->nm_Events = client->events;
+          message->nm_Port = (struct MsgPort*)client->handle;
+          Notify_Port_Fill(message);
+
+          PutMsg((struct MsgPort*)client->handle, (struct Message*)message);
+          client->busy = 1;
+          notify_out++;
+          Notify_Delivered(&APP_notify, client);
+     }
+}
+
+// Commands of the clients, and our CHANGED messages coming back.
+void Notify_Port_Service(void)
+{
+     struct Notify_Message *message;
+
+     while ((message = (struct Notify_Message*)GetMsg(notify_port)))
      {
-          // Primary IP failed - testing secondary IP.
-          APP_secondary_ip_converted = inet_addr(arg_secondary_ip);
-          if (APP_secondary_ip_converted == INADDR_NONE)
+          if (message->nm_Message.mn_Node.ln_Type == NT_REPLYMSG)
           {
-               APP_secondary_ip_converted = inet_addr(DEF_SECONDARY_IP);
-               strcpy(arg_secondary_ip, DEF_SECONDARY_IP);
+               // Still subscribed - it may have missed a change meanwhile.
+               struct Notify_Client *client = Notify_Find(&APP_notify, message->nm_Port);
+               if (client) client->busy = 0;
+
+               FreeVec(message);
+               notify_out--;
+               continue;
           }
 
-          if (Test_Connection_Socket(APP_secondary_ip_converted, &APP_secondary_ip_status))
+          if (message->nm_Message.mn_Length < sizeof(struct Notify_Message))
           {
-               CloseLibrary(SocketBase);
-               return 1;
+               // Too short for nm_Result - it can only be given back.
+               ReplyMsg((struct Message*)message);
+               continue;
           }
-          else
+
+          struct MsgPort *port = message->nm_Port ? message->nm_Port : message->nm_Message.mn_ReplyPort;
+          message->nm_Result = NOTIFY_OK;
+
+          switch (message->nm_Command)
           {
-               CloseLibrary(SocketBase);
-               return 0;               
+               case NOTIFY_CMD_SUBSCRIBE:
+                    if (!Notify_Subscribe(&APP_notify, port, message->nm_Events ? message->nm_Events : NOTIFY_STATUS))
+                         message->nm_Result = NOTIFY_ERROR_FULL;
+                    break;
+
+               case NOTIFY_CMD_UNSUBSCRIBE:
+                    Notify_Unsubscribe(&APP_notify, port);
+                    break;
+
+               case NOTIFY_CMD_QUERY:
+                    break;
+
+               default:
+                    message->nm_Result = NOTIFY_ERROR_COMMAND;
+                    break;
           }
+
+          Notify_Port_Fill(message);
+          ReplyMsg((struct Message*)message);
      }
+
+     Notify_Port_Send();
+}
+
+// Takes the port off the list and waits up to a second for the CHANGED messages
+// still out. If some client never replies the port is left behind, ignoring them.
+void Notify_Port_Delete(void)
+{
+     if (notify_port == NULL) return;
+
+     RemPort(notify_port);
+     APP_notify.client_count = 0;
+
+     for (LONG i = 0; i < 50; i++)
+     {
+          struct Notify_Message *message;
+
+          while ((message = (struct Notify_Message*)GetMsg(notify_port)))
+          {
+               if (message->nm_Message.mn_Node.ln_Type == NT_REPLYMSG)
+               {
+                    FreeVec(message);
+                    notify_out--;
+               }
+               else
+               {
+                    if (message->nm_Message.mn_Length >= sizeof(struct Notify_Message)) message->nm_Result = NOTIFY_ERROR_GONE;
+                    ReplyMsg((struct Message*)message);
+               }
+          }
+
+          if (notify_out == 0) break;
+          Delay(1);
+     }
+
+     if (notify_out == 0) DeleteMsgPort(notify_port);
+     else notify_port->mp_Flags = PA_IGNORE;
+
+     notify_port = NULL;
+}
+
+// Record of the main monitor - the wall clock, the journal outlives the process.
+void Status_Journal(BYTE _type)
+{
+     if (!arg_journal || !arg_journal[0]) return;
+
+     // Stopped once, when disabled or leaving.
+     if (_type != JOURNAL_TYPE_START && !APP_journal_started) return;
+     APP_journal_started = _type != JOURNAL_TYPE_STOP;
+
+     struct Journal_Record record;
+
+     record.time = Platform_Clock();
+     record.type = _type;
+     record.status = APP_monitor.status;
+     record.raw_status = APP_monitor.raw_status;
+     record.verdict = APP_monitor.diag ? APP_diag.verdict : DIAG_VERDICT_NONE;
+     record.rtt = APP_monitor.raw_status > 0 ? APP_monitor.rtt.last : 0;
+     record.answered = (UBYTE)APP_monitor.probe.answered;
+     record.targets = (UBYTE)APP_monitor.probe.target_count;
+
+     Journal_Add(&APP_journal, &record);
+}
+
+// socket() failed - the TCP/IP stack was shut down or is restarting. The session is
+// only let go once nothing holds a socket of it, in the order of CXCMD_DISABLE - a
+// monitor can't do it alone, the other channels, the lookups and the listeners would
+// be left with sockets of a closed library. The probes and lookups end as failed and
+// come again at their time, the sockets that stay open are opened again right away.
+void Session_Restart(void)
+{
+     if (arg_share[0]) Share_Stop(&APP_share);
+     for (LONG i = 0; i < APP_monitor_count; i++) Monitor_Abort(APP_monitors[i]);
+     if (APP_monitor.burst) Burst_Stop(&APP_burst);
+     Resolve_Abort(&APP_resolver);
+     Http_Stop(&APP_http);
+
+     Net_Close();
+
+     if (arg_share[0]) Share_Start(&APP_share);
+     if (arg_http[0]) Http_Start(&APP_http);
 }
 
 void Cleanup()
 {
-     // Delete global ENV variable from system.
-     DeleteVar(APP_ENV_NAME, GVF_GLOBAL_ONLY);
+     // The journal writes out what it holds, the snapshot keeps the last status.
+     Status_Journal(JOURNAL_TYPE_STOP);
+     Snapshot_Save(&APP_snapshot, &APP_monitor, Platform_Clock());
+
+     // Delete global ENV variables from system.
+     Status_Delete();
 
      if (APP_window_visible) Intuition_Window_Cleanup();
 
+     // Drop the probes and lookups if we are leaving in the middle of them.
+     // A leader says bye first, so a follower takes over without waiting.
+     if (arg_share[0]) Share_Stop(&APP_share);
+     for (LONG i = 0; i < APP_monitor_count; i++) Monitor_Stop(APP_monitors[i]);
+     Resolve_Stop(&APP_resolver);
+     Http_Stop(&APP_http);
+     Net_Close();
+
      if (cx_broker) DeleteCxObj(cx_broker);
      if (cx_broker_message_port) DeletePort(cx_broker_message_port);
+     Notify_Port_Delete();
 
      // Cleanup Tooltypes.
      ArgArrayDone();
@@ -423,47 +1292,176 @@ void Debug_Print(char* _status)
 {
      APP_debug_count++;
 
-     char primary_string[16], secondary_string[16];
-     
-     memset(primary_string, 0, sizeof(primary_string));
-     memset(secondary_string, 0, sizeof(secondary_string));
+     printf("--- #%d ---\n", APP_debug_count);
+     printf("STATUS: %s\n", _status);
+     struct Damp *damp = &APP_monitor.damp;
+     printf("RAW: %s (%d of last %d probes failed, %d of %d needed for offline, %d answered in a row, %d needed)\n",
+          APP_monitor.raw_status ? arg_online_txt : arg_offline_txt, damp->failures, damp->results, damp->failures_needed, damp->window,
+          damp->successes, damp->successes_needed);
+     struct Probe *probe = &APP_monitor.probe;
+     printf("POLICY: %s (%d of %d targets needed)\n", Probe_Policy_Text(probe->policy), Probe_Needed(probe), probe->target_count);
+
+     for (LONG i = 0; i < probe->target_count; i++)
+     {
+          struct Probe_Target *target = &probe->target[i];
+          BYTE family = (target->families & (1 << NET_FAMILY_V4)) ? NET_FAMILY_V4 : NET_FAMILY_V6;
+          char address[48];
+          Probe_Format_Address(target, family, address);
+          printf("TARGET %d: %s %s%s%s:%u%s%s (%s", i + 1, Probe_Type_Text(target->type),
+               target->name ? target->name->host : "", target->name ? " " : "", target->families ? address : "-", target->port,
+               target->path[0] ? " " : "", target->path, Probe_Status_Text(target->status));
+          if (target->attempt[NET_FAMILY_V6].status != IP_STATUS_NOT_USED)
+               printf(", IPv6 %s, IPv4 %s", Probe_Status_Text(target->attempt[NET_FAMILY_V6].status), Probe_Status_Text(target->attempt[NET_FAMILY_V4].status));
+          printf(")\n");
+     }
+     for (BYTE family = 0; family < NET_FAMILIES; family++)
+     {
+          BYTE status = APP_monitor.family_status[(UBYTE)family];
+          printf("IPV%d: %s\n", family == NET_FAMILY_V6 ? 6 : 4, status < 0 ? (CONST_STRPTR)"-" : status ? arg_online_txt : arg_offline_txt);
+     }
+     for (LONG i = 0; i < APP_resolver.name_count; i++)
+     {
+          struct Resolve_Name *name = &APP_resolver.name[i];
+          char ip_text[16], ip6_text[40];
+          Net_Format_Ip(name->ip, ip_text);
+          Net_Format_Ip6(name->ip6, ip6_text);
+          printf("NAME %s: %s %s %s, TTL %lu s, %lu lookups, %lu failed (%s)\n", name->host,
+               (name->families & (1 << NET_FAMILY_V4)) ? ip_text : "-", (name->families & (1 << NET_FAMILY_V6)) ? ip6_text : "-",
+               Resolve_State_Text(name->state), name->ttl, name->lookups, name->lookups_failed, Resolve_Error_Text(name->error));
+     }
+     for (BYTE hop = 0; hop < DIAG_HOPS && APP_monitor.diag; hop++)
+     {
+          struct Probe *hop_probe = &APP_diag.hop[(UBYTE)hop];
+          BYTE status = APP_diag.hop_status[(UBYTE)hop];
 
-     switch(APP_primary_ip_status)
+          for (LONG i = 0; i < hop_probe->target_count; i++)
+          {
+               char address[48];
+               Probe_Format_Address(&hop_probe->target[i], hop_probe->target[i].families & (1 << NET_FAMILY_V4) ? NET_FAMILY_V4 : NET_FAMILY_V6, address);
+               printf("HOP %s: %s %s:%u (%s)\n", Diag_Verdict_Text(DIAG_VERDICT_GATEWAY + hop), Probe_Type_Text(hop_probe->target[i].type),
+                    address, hop_probe->target[i].port, Probe_Status_Text(hop_probe->target[i].status));
+          }
+          if (hop_probe->target_count) printf("HOP %s: %s\n", Diag_Verdict_Text(DIAG_VERDICT_GATEWAY + hop),
+               status < 0 ? (CONST_STRPTR)"-" : status ? arg_online_txt : arg_offline_txt);
+     }
+     if (APP_monitor.diag) printf("PATH: latest probe %s, latest failure at %s\n", Diag_Verdict_Text(APP_diag.verdict), Diag_Verdict_Text(APP_diag.failure));
+     if (APP_monitor.burst)
      {
-          case 0:
-               strcpy(primary_string, "FAILED");
-               break;
+          LONG permille = Burst_Loss(&APP_burst);
+          char jitter[16];
+          Rtt_Format(Burst_Jitter(&APP_burst), jitter);
+          printf("BURST: %ld probes per tick, budget %ld packets, loss %ld.%ld%% of %lu over %ld ticks, jitter %s ms\n", APP_burst.probes, APP_burst.budget,
+               permille < 0 ? 0 : permille / 10, permille < 0 ? 0 : permille % 10, APP_burst.sent, APP_burst.ticks, jitter);
+     }
+     if (arg_share[0])
+     {
+          char ip_text[16];
+          Net_Format_Ip(APP_share.leader_ip, ip_text);
+          printf("SHARE: %s%s%s, group %08lx, id %08lx, leader id %08lx, %lu sent, %lu received, %lu takeovers\n", Share_Role_Text(APP_share.role),
+               APP_share.role == SHARE_ROLE_FOLLOWER ? " of " : "", APP_share.role == SHARE_ROLE_FOLLOWER ? ip_text : "", APP_share.group, APP_share.id,
+               APP_share.leader_id, stats.counter[STATS_SHARE_SENT], stats.counter[STATS_SHARE_RECEIVED], stats.counter[STATS_SHARE_TAKEOVERS]);
+     }
+     if (arg_http[0]) printf("HTTP: port %u%s, %lu requests, pages built %lu times\n", APP_http.port,
+          APP_http.socket == NET_NO_SOCKET ? " (not listening)" : "", APP_http.requests, APP_http.builds);
+     if (arg_snapshot[0]) printf("SNAPSHOT: %s%s, %lu saves, %lu failed\n", arg_snapshot, APP_stale ? " (shown, no probe yet)" : "",
+          APP_snapshot.saves, APP_snapshot.failures);
+     if (arg_journal[0]) printf("JOURNAL: %lu records written in %lu batches, %lu lost, %ld waiting\n", APP_journal.records, APP_journal.flushes,
+          APP_journal.lost, APP_journal.count);
+     printf("NOTIFY: %ld subscribers, %lu changes sent, %ld not replied\n", APP_notify.client_count, APP_notify.sent, notify_out);
+     printf("IPV6 STACK: %s, %lu answered over IPv4\n", Net_Ipv6() ? "YES" : "NO", stats.counter[STATS_FALLBACKS]);
+     printf("SOCKET LIB: %s (opened %lu times)\n", Net_Lost() ? "LOST" : "OPEN", Net_Open_Count());
+     struct Rtt_Window *rtt = &APP_monitor.rtt;
+     char rtt_last[16], rtt_p50[16], rtt_p95[16], rtt_max[16];
+     Rtt_Format(rtt->last, rtt_last);
+     Rtt_Format(Rtt_Percentile(rtt, 50), rtt_p50);
+     Rtt_Format(Rtt_Percentile(rtt, 95), rtt_p95);
+     Rtt_Format(Rtt_Max(rtt), rtt_max);
+
+     printf("RTT: %s ms (p50 %s, p95 %s, max %s ms of %d)\n", rtt_last, rtt_p50, rtt_p95, rtt_max, rtt->count);
+     printf("OUTPUT: %lu ENV writes (%lu saved), %lu redraws (%lu saved)\n", stats.counter[STATS_ENV_WRITES], stats.counter[STATS_ENV_WRITES_SAVED],
+          stats.counter[STATS_REDRAWS], stats.counter[STATS_REDRAWS_SAVED]);
+     printf("PROBE START: %lu us (+%lu us if the library was opened every tick)\n", APP_monitor.start_micro, APP_tick_reopen_micro);
+     printf("TIME INTERVAL: %d..%d seconds, confirm %d, jitter %d%%\n", arg_time_interval, arg_time_interval_max, arg_confirm_interval, arg_jitter);
+     printf("NEXT PROBE: in %lu ms (%s, %lu same results in a row)\n", APP_monitor.next_probe_ms, APP_monitor.sched.confirming ? "confirming" : "stable",
+          APP_monitor.sched.stable_count);
+     char timeout_last[16], timeout_srtt[16], timeout_rttvar[16];
+     Rtt_Format(APP_monitor.timeout_us, timeout_last);
+     Rtt_Format(rtt->srtt, timeout_srtt);
+     Rtt_Format(rtt->rttvar, timeout_rttvar);
+
+     if (arg_tcp_timeout) printf("TCP TIMEOUT: %d seconds (fixed)\n", arg_tcp_timeout);
+     else printf("TCP TIMEOUT: %s ms (SRTT %s, RTTVAR %s ms, %d..%d ms, backoff %d)\n", timeout_last, timeout_srtt, timeout_rttvar,
+          arg_tcp_timeout_min, arg_tcp_timeout_max, APP_monitor.timeout_backoff);
+     printf("TIMER: %ld deadlines, %lu wakeups (%lu per hour), %lu fired, %lu coalesced\n", APP_wheel.count, APP_wheel.wakeups,
+          Wheel_Wakeups_Per_Hour(&APP_wheel, Platform_Time()), APP_wheel.fired, APP_wheel.coalesced);
+
+     for (LONG i = 0; i < APP_channel_count; i++)
+     {
+          struct Monitor *monitor = &APP_channel[i].monitor;
+          CONST_STRPTR status = monitor->status < 0 ? (CONST_STRPTR)"..." : monitor->status ? arg_online_txt : arg_offline_txt;
 
-          case 1:
-               strcpy(primary_string, "CONNECTED");
-               break;
-          
-          default:
-               strcpy(primary_string, "NOT USED");
-               break;
+          printf("CHANNEL %s: %s (%d targets, %s, next probe in %lu ms)\n", APP_channel[i].name, status,
+               monitor->probe.target_count, Probe_Policy_Text(monitor->probe.policy), monitor->next_probe_ms);
      }
+}
+
+// Snapshot of the counters in APP_ENV_STATS and, in debug mode, the full dump.
+void Stats_Show(void)
+{
+     char text[512];
+
+     Stats_Format(text, sizeof(text));
+     SetVar(APP_ENV_STATS, text, -1, GVF_GLOBAL_ONLY);
 
-     switch(APP_secondary_ip_status)
+     if (arg_debug)
      {
-          case 0:
-               strcpy(secondary_string, "FAILED");
-               break;
+          printf("--- STATS ---\n");
+          Stats_Print();
+     }
+}
 
-          case 1:
-               strcpy(secondary_string, "CONNECTED");
-               break;
-          
-          default:
-               strcpy(secondary_string, "NOT USED");
-               break;
+void Status_Show(BYTE _online)
+{
+     APP_status = _online;
+
+     TIME_US start = Platform_Time();
+     Status_Output();
+
+     // RTT of the latest probe, whatever is published - same as APP_ENV_RTT.
+     if (Notify_Update(&APP_notify, _online, APP_monitor.raw_status > 0, APP_monitor.rtt.last)) Notify_Port_Send();
+     Stats_Time(STATS_OUTPUT, start);
+
+     // If debug mode is on - display info in console.
+     if (arg_debug) Debug_Print(_online ? arg_online_txt : arg_offline_txt);
+}
+
+// Called by the monitor core after every finished probe.
+void Platform_Publish(struct Monitor *_monitor)
+{
+     // Named channels only have their ENV variables and the HTTP pages.
+     if (_monitor->user)
+     {
+          TIME_US start = Platform_Time();
+          Channel_Output((struct App_Channel*)_monitor->user);
+          Http_Publish(&APP_http);
+          Stats_Time(STATS_OUTPUT, start);
+          return;
      }
 
-     printf("--- #%d ---\n", APP_debug_count);
-     printf("STATUS: %s\n", _status);
-     printf("PRIMARY IP: %s (%s)\n", arg_primary_ip, primary_string);
-     printf("SECONDARY IP: %s (%s)\n", arg_secondary_ip, secondary_string);
-     printf("TIME INTERVAL: %d seconds\n", arg_time_interval);
-     printf("TCP TIMEOUT: %d seconds\n", arg_tcp_timeout);
+     // Followers hear it before anything is written here.
+     if (arg_share[0]) Share_Publish(&APP_share);
+     Http_Publish(&APP_http);
+
+     // A real status now - the one from the snapshot goes.
+     if (APP_stale)
+     {
+          DeleteVar(APP_ENV_STALE, GVF_GLOBAL_ONLY);
+          APP_stale = 0;
+     }
+
+     Status_Show(_monitor->status);
+     Status_Journal(JOURNAL_TYPE_PROBE);
+     Snapshot_Update(&APP_snapshot, &APP_monitor, Platform_Clock());
 }
 
 // -------------------
@@ -517,6 +1515,14 @@ int main(int argc, char **argv)
 
      cx_newbroker.nb_Port = cx_broker_message_port;
 
+     // Subscribers are told about changes through our public port.
+     if (!Notify_Port_Create())
+     {
+          printf("%s: Error! Can't create the notification port.", APP_NAME);
+          Cleanup();
+          return 1;
+     }
+
      // Get TOOLTYPES from Icon.
 
      // Get input arguments stored as TOOLTYPES in program .icon file.
@@ -534,16 +1540,93 @@ int main(int argc, char **argv)
      arg_primary_ip = (STRPTR)ArgString(tool_types_strings, "PRIMARY_IP", DEF_PRIMARY_IP);
      arg_secondary_ip = (STRPTR)ArgString(tool_types_strings, "SECONDARY_IP", DEF_SECONDARY_IP);
 
+     // Get TARGETS - if given, used instead of primary and secondary IP.
+     arg_targets = (STRPTR)ArgString(tool_types_strings, "TARGETS", DEF_TARGETS);
+
+     // Get DNS_SERVER - name servers for host name targets, empty takes the ones of the TCP/IP stack.
+     arg_dns_server = (STRPTR)ArgString(tool_types_strings, "DNS_SERVER", DEF_DNS_SERVER);
+
+     // Get GATEWAY - ip[:port] or AUTO turns on the path diagnosis, empty leaves it off.
+     arg_gateway = (STRPTR)ArgString(tool_types_strings, "GATEWAY", DEF_GATEWAY);
+
+     // Get SHARE - broadcast ip[:port] the copies on the subnet share one prober over, empty leaves it off.
+     arg_share = (STRPTR)ArgString(tool_types_strings, "SHARE", DEF_SHARE);
+
+     // Get HTTP - [ip:]port the status and metrics are served on, empty leaves it off.
+     arg_http = (STRPTR)ArgString(tool_types_strings, "HTTP", DEF_HTTP);
+
+     // Get JOURNAL - file the outage journal is appended to, empty leaves it off.
+     arg_journal = (STRPTR)ArgString(tool_types_strings, "JOURNAL", DEF_JOURNAL);
+
+     // Get SNAPSHOT - file the last status is kept in for the next start, empty leaves it off.
+     arg_snapshot = (STRPTR)ArgString(tool_types_strings, "SNAPSHOT", DEF_SNAPSHOT);
+
+     // Get POLICY - how many targets have to answer for online.
+     STRPTR tmp__policy = (STRPTR)ArgString(tool_types_strings, "POLICY", DEF_POLICY);
+     if (strcmp(tmp__policy, "QUORUM") == 0)   arg_policy = PROBE_POLICY_QUORUM;
+     else if (strcmp(tmp__policy, "ALL") == 0) arg_policy = PROBE_POLICY_ALL;
+     else                                      arg_policy = PROBE_POLICY_FIRST;
+
+     // Get and validate QUORUM - answers needed with POLICY=QUORUM (clamped to the number of targets).
+     arg_quorum = ArgInt(tool_types_strings, "QUORUM", DEF_QUORUM);
+     if (arg_quorum < 1) arg_quorum = 1;
+
      // Get and validate TIME_INTERVAL
      arg_time_interval = ArgInt(tool_types_strings, "TIME_INTERVAL", DEF_TIME_INTERVAL);
      if (arg_time_interval < 2)    arg_time_interval = DEF_TIME_INTERVAL;
      if (arg_time_interval > 3600) arg_time_interval = 3600;
 
-     // Get and validate TCP_TIMEOUT
+     // Get and validate TIME_INTERVAL_MAX - how far the interval may grow while nothing changes.
+     arg_time_interval_max = ArgInt(tool_types_strings, "TIME_INTERVAL_MAX", DEF_TIME_INTERVAL_MAX);
+     if (arg_time_interval_max < arg_time_interval) arg_time_interval_max = arg_time_interval;
+     if (arg_time_interval_max > 3600) arg_time_interval_max = 3600;
+
+     // Get and validate CONFIRM_INTERVAL - how soon a changed result is checked again.
+     arg_confirm_interval = ArgInt(tool_types_strings, "CONFIRM_INTERVAL", DEF_CONFIRM_INTERVAL);
+     if (arg_confirm_interval < 1) arg_confirm_interval = DEF_CONFIRM_INTERVAL;
+     if (arg_confirm_interval > arg_time_interval) arg_confirm_interval = arg_time_interval;
+
+     // Get and validate JITTER - random +/- percent added to every interval.
+     arg_jitter = ArgInt(tool_types_strings, "JITTER", DEF_JITTER);
+     if (arg_jitter < 0)  arg_jitter = 0;
+     if (arg_jitter > 50) arg_jitter = 50;
+
+     // Get and validate TCP_TIMEOUT - fixed seconds, 0 follows the RTT.
      arg_tcp_timeout = ArgInt(tool_types_strings, "TCP_TIMEOUT", DEF_TCP_TIMEOUT);
-     if (arg_tcp_timeout < 1) arg_tcp_timeout = DEF_TCP_TIMEOUT;
+     if (arg_tcp_timeout < 0) arg_tcp_timeout = DEF_TCP_TIMEOUT;
      if (arg_tcp_timeout > 5) arg_tcp_timeout = 5;
 
+     // Get and validate TCP_TIMEOUT_MIN and TCP_TIMEOUT_MAX - range of the adaptive timeout in ms.
+     arg_tcp_timeout_min = ArgInt(tool_types_strings, "TCP_TIMEOUT_MIN", DEF_TCP_TIMEOUT_MIN);
+     if (arg_tcp_timeout_min < 20)    arg_tcp_timeout_min = 20;
+     if (arg_tcp_timeout_min > 10000) arg_tcp_timeout_min = 10000;
+
+     arg_tcp_timeout_max = ArgInt(tool_types_strings, "TCP_TIMEOUT_MAX", DEF_TCP_TIMEOUT_MAX);
+     if (arg_tcp_timeout_max < arg_tcp_timeout_min) arg_tcp_timeout_max = arg_tcp_timeout_min;
+     if (arg_tcp_timeout_max > 30000) arg_tcp_timeout_max = 30000;
+
+     // Get and validate FLAP_FAILURES, FLAP_WINDOW and FLAP_SUCCESSES - Offline after that many
+     // failed probes of the last ones, Online after that many answered ones in a row.
+     arg_flap_window = ArgInt(tool_types_strings, "FLAP_WINDOW", DEF_FLAP_WINDOW);
+     if (arg_flap_window < 1)               arg_flap_window = 1;
+     if (arg_flap_window > DAMP_WINDOW_MAX) arg_flap_window = DAMP_WINDOW_MAX;
+
+     arg_flap_failures = ArgInt(tool_types_strings, "FLAP_FAILURES", DEF_FLAP_FAILURES);
+     if (arg_flap_failures < 1)               arg_flap_failures = 1;
+     if (arg_flap_failures > arg_flap_window) arg_flap_failures = arg_flap_window;
+
+     arg_flap_successes = ArgInt(tool_types_strings, "FLAP_SUCCESSES", DEF_FLAP_SUCCESSES);
+     if (arg_flap_successes < 1)  arg_flap_successes = 1;
+     if (arg_flap_successes > 32) arg_flap_successes = 32;
+
+     // Get and validate BURST and BURST_BUDGET - light probes per tick for the loss, and the packets they may send.
+     arg_burst = ArgInt(tool_types_strings, "BURST", DEF_BURST);
+     if (arg_burst < 0)                arg_burst = 0;
+     if (arg_burst > BURST_MAX_PROBES) arg_burst = BURST_MAX_PROBES;
+
+     arg_burst_budget = ArgInt(tool_types_strings, "BURST_BUDGET", DEF_BURST_BUDGET);
+     if (arg_burst_budget < 1) arg_burst_budget = DEF_BURST_BUDGET;
+
      // Get MODE string and conert to number for easy use.
      STRPTR tmp__mode = (STRPTR)ArgString(tool_types_strings, "MODE", DEF_MODE);
      if (strcmp(tmp__mode, "LABEL") == 0) arg_mode = MODE_LABEL;
@@ -573,6 +1656,9 @@ int main(int argc, char **argv)
      // Get debug status.
      arg_debug = ArgInt(tool_types_strings, "DEBUG", DEF_DEBUG);
 
+     // Prepare probe targets.
+     Test_Connection_Init(tool_types_strings);
+
      // Creating the Commodity broker.
 
      // The commodities.library function CxBroker() adds a broker to the master list.  It takes two arguments,
@@ -600,7 +1686,10 @@ int main(int argc, char **argv)
                printf("%s: Error! Can't create the window.", APP_NAME);
           }
           else
+          {
                APP_window_visible = 1;
+               Status_Output();
+          }
      }
      else 
           APP_window_visible = 0;
@@ -610,8 +1699,18 @@ int main(int argc, char **argv)
      // --- Enter the main processing loop ---
      // --------------------------------------
 
-     // Set global ENV variable to "..." at this place.
-     SetVar(APP_ENV_NAME, "...", -1, GVF_GLOBAL_ONLY);
+     // Set global ENV variable to "..." at this place - or to the status from the snapshot, with its age.
+     if (APP_stale)
+     {
+          char age[16];
+          sprintf(age, "%lu", APP_snapshot_age);
+
+          Status_Output();
+          SetVar(APP_ENV_STALE, age, -1, GVF_GLOBAL_ONLY);
+     }
+     else
+          SetVar(APP_ENV_NAME, "...", -1, GVF_GLOBAL_ONLY);
+     for (LONG i = 0; i < APP_channel_count; i++) SetVar(APP_channel[i].env_name, "...", -1, GVF_GLOBAL_ONLY);
 
      // Commodoty status (enabled/disabled).
      BYTE cx_enabled = 1;
@@ -619,17 +1718,60 @@ int main(int argc, char **argv)
      // The main processing loop status.
      BYTE cx_loop = 1;
 
-     // Send first, short interval to timer - 0 to get first result fast.
-     Timer_Send(0, 1);
+     // First probe is due right away - to get first result fast.
+     // Host names are looked up first, the probes wait for them.
+     Resolve_Start(&APP_resolver);
+     for (LONG i = 0; i < APP_monitor_count; i++) Monitor_Start(APP_monitors[i]);
+
+     // Main targets follow until we know whether another copy probes them.
+     if (arg_share[0] && !Share_Start(&APP_share)) printf("%s: Error! Can't open the SHARE socket, probing alone.\n", APP_NAME);
+     if (arg_http[0] && !Http_Start(&APP_http)) printf("%s: Error! Can't listen on HTTP %s.\n", APP_NAME, arg_http);
+
+     // The time before this is not known to the journal.
+     Status_Journal(JOURNAL_TYPE_START);
+     Timer_Arm(Wheel_Next(&APP_wheel));
 
      while(cx_loop)
      {
-          ULONG win_signal   = 1L << APP_window->UserPort->mp_SigBit;
+          ULONG win_signal   = APP_window_visible ? 1L << APP_window->UserPort->mp_SigBit : 0;
 	     ULONG timer_signal = 1L << timer_io->tr_node.io_Message.mn_ReplyPort->mp_SigBit;
 	     ULONG cx_signal    = 1L << cx_broker_message_port->mp_SigBit;
+          ULONG notify_signal = 1L << notify_port->mp_SigBit;
+
+          ULONG signals_wanted = win_signal | timer_signal | cx_signal | notify_signal | SIGBREAKF_CTRL_C;
+          ULONG signals_received = signals_wanted;
+
+          // Not on the stack - the icon gives the commodity 4096 bytes of it.
+          static struct Net_Watch probe_watch[APP_MAX_WATCH];
+          LONG probe_slice[1 + APP_MAX_CHANNELS];
+          LONG probe_ready = 0;
+
+          // Sockets of every channel with a probe in flight, then the name lookups.
+          LONG probe_watch_count = Monitor_Watch_All(APP_monitors, APP_monitor_count, probe_watch, APP_MAX_WATCH, probe_slice);
+          LONG resolve_watch_count = Resolve_Watch(&APP_resolver, probe_watch + probe_watch_count, APP_MAX_WATCH - probe_watch_count);
+          LONG share_watch_count = Share_Watch(&APP_share, probe_watch + probe_watch_count + resolve_watch_count,
+               APP_MAX_WATCH - probe_watch_count - resolve_watch_count);
+          LONG http_watch_count = Http_Watch(&APP_http, probe_watch + probe_watch_count + resolve_watch_count + share_watch_count,
+               APP_MAX_WATCH - probe_watch_count - resolve_watch_count - share_watch_count);
+          LONG watch_count = probe_watch_count + resolve_watch_count + share_watch_count + http_watch_count;
 
           // Wait until any signal appear.
-          ULONG signals_received = Wait(win_signal | timer_signal | cx_signal | SIGBREAKF_CTRL_C);          
+          // While a probe is in flight WaitSelect() also wakes up on its sockets,
+          // so Exchange and the window are serviced as fast as without the probe.
+          if (watch_count)
+          {
+               probe_ready = Net_Wait(probe_watch, watch_count, -1, 0, &signals_received);
+
+               // Broken off or failed - the signals that came meanwhile are still pending,
+               // taken here as Wait() would. Only a real failure ends the probes.
+               if (probe_ready < 0)
+               {
+                    signals_received = SetSignal(0, signals_wanted) & signals_wanted;
+                    if (Errno() == EINTR) probe_ready = 0;
+               }
+          }
+          else
+               signals_received = Wait(signals_wanted);
 
           // ------------------------------
           // --- Ctrl+C breaking signal ---
@@ -681,11 +1823,23 @@ int main(int argc, char **argv)
                                                        APP_window_visible = 0;
                                                   }
                                                   else
+                                                  {
                                                        APP_window_visible = 1;
+                                                       Status_Output();
+                                                  }
                                              }
 
-                                             // Send short interval for fast result.
-                                             Timer_Send(0, 1);
+                                             // Probe right away for fast result.
+                                             // The history is stale after being inactive,
+                                             // and the first result is written out in full.
+                                             // Names past their TTL are looked up again.
+                                             Resolve_Start(&APP_resolver);
+                                             for (LONG i = 0; i < APP_monitor_count; i++) Monitor_Start(APP_monitors[i]);
+                                             if (arg_share[0]) Share_Start(&APP_share);
+                                             if (arg_http[0]) Http_Start(&APP_http);
+                                             Status_Journal(JOURNAL_TYPE_START);
+                                             Status_Invalidate();
+                                             Timer_Arm(Wheel_Next(&APP_wheel));
 
                                              ActivateCxObj(cx_broker, 1L); 
                                              cx_enabled = 1;                                             
@@ -693,15 +1847,34 @@ int main(int argc, char **argv)
 
                                          // User is switching to INACTIVE.
                                         case CXCMD_DISABLE:
-                                             AbortIO(timer_io); 
-                                             WaitIO(timer_io);
+                                             Timer_Abort();
+
+                                             // Inactive time is not counted - the batch goes to the file now.
+                                             // The snapshot keeps the status it had.
+                                             Status_Journal(JOURNAL_TYPE_STOP);
+                                             Snapshot_Save(&APP_snapshot, &APP_monitor, Platform_Clock());
+                                             APP_stale = 0;
+
+                                             // Drop the probes and lookups in flight, if any.
+                                             if (arg_share[0]) Share_Stop(&APP_share);
+                                             for (LONG i = 0; i < APP_monitor_count; i++) Monitor_Stop(APP_monitors[i]);
+                                             Resolve_Stop(&APP_resolver);
+                                             Http_Stop(&APP_http);
+
+                                             // Don't hold the TCP/IP stack while inactive.
+                                             Net_Close();
 
                                              // If the window is visible - close it.
                                              if (APP_window_visible) Intuition_Window_Cleanup();
                                              APP_window_visible = 0;
 
-                                             // Remove global ENV variable from system when disabling commodity.
-                                             DeleteVar(APP_ENV_NAME, GVF_GLOBAL_ONLY);
+                                             // Remove global ENV variables from system when disabling commodity.
+                                             // Status is unknown until the first probe after enabling.
+                                             Status_Delete();
+                                             APP_status = -1;
+
+                                             // Subscribers hear it is unknown now.
+                                             if (Notify_Update(&APP_notify, -1, 0, 0)) Notify_Port_Send();
 
                                              ActivateCxObj(cx_broker, 0L);
                                              cx_enabled = 0;
@@ -709,6 +1882,9 @@ int main(int argc, char **argv)
 
                                         // User clicks - SHOW INTERFACE
                                         case CXCMD_APPEAR:                                        
+                                             // Also the way to ask for the counters.
+                                             Stats_Show();
+
                                              // Try to show window only if the window is not visible.
                                              if (!APP_window_visible && cx_enabled)
                                              {
@@ -718,7 +1894,10 @@ int main(int argc, char **argv)
                                                        APP_window_visible = 0;
                                                   }
                                                   else
+                                                  {
                                                        APP_window_visible = 1;
+                                                       Status_Output();
+                                                  }
                                              }
                                              break;
 
@@ -743,88 +1922,49 @@ int main(int argc, char **argv)
                }
           }
 
+          // ------------------------------------------------------------
+          // --- Subscribers' commands, replies to our notifications. ---
+          // ------------------------------------------------------------
+          if (signals_received & notify_signal) Notify_Port_Service();
+
+          // ---------------------------------------------------------------
+          // --- If probe sockets are ready, finish as soon as decided. ---
+          // ---------------------------------------------------------------
+          if (probe_ready > 0)
+          {
+               Monitor_Service_All(APP_monitors, APP_monitor_count, probe_watch, probe_slice);
+               Resolve_Service(&APP_resolver, probe_watch + probe_watch_count, resolve_watch_count);
+               Share_Service(&APP_share, probe_watch + probe_watch_count + resolve_watch_count, share_watch_count);
+               Http_Service(&APP_http, probe_watch + probe_watch_count + resolve_watch_count + share_watch_count, http_watch_count);
+          }
+
+          // WaitSelect() itself failed - don't spin on it until the timeout.
+          if (probe_ready < 0)
+          {
+               for (LONG i = 0; i < APP_monitor_count; i++) Monitor_Abort(APP_monitors[i]);
+               Resolve_Abort(&APP_resolver);
+          }
+
           // --------------------------------------------------------------------
           // --- If we get the signal from the timer and commodity is enabled, 
-          // --- execute our checking routine. 
+          // --- start the probe or, if it is already in flight, time it out.
           // --------------------------------------------------------------------
-          if ( (signals_received & timer_signal) && cx_enabled)
+          if ( (signals_received & timer_signal) && cx_enabled && timer_armed && CheckIO((struct IORequest*)timer_io))
           {
                // Using WaitIO() to handle request instead of GetMsg(). 
                WaitIO(timer_io);
+               timer_armed = 0;
 
-               if (Test_Connection())
-               {
-                    // Set global ENV variable in System to ONLINE.
-                    SetVar(APP_ENV_NAME, arg_online_txt, -1, GVF_GLOBAL_ONLY);
-                   
-                    // Only if window is visible.
-                    if (APP_window_visible)
-                    {
-                         switch(arg_mode)
-                         {
-                              case MODE_LABEL:
-                                   SetAPen(APP_window->RPort, 2);
-                                   RectFill(APP_window->RPort, 0, 0, arg_size_x, arg_size_y);
-                                   SetAPen(APP_window->RPort, 1);
-                                   SetBPen(APP_window->RPort, 2);
-                                   Move(APP_window->RPort, 0, APP_pubscreen->RastPort.TxBaseline);
-                                   Text(APP_window->RPort, (CONST_STRPTR)arg_online_txt, strlen(arg_online_txt));
-                                   SetWindowTitles(APP_window, arg_online_txt, arg_online_txt);
-                                   break;
-
-                              case MODE_BOX:
-                                   SetAPen(APP_window->RPort, arg_box_online_pen);
-                                   RectFill(APP_window->RPort, 0, 0, arg_size_x, arg_size_y);
-                                   SetWindowTitles(APP_window, arg_online_txt, arg_online_txt);
-                                   break;
-
-                              case MODE_WINDOW_BAR:
-                                   SetWindowTitles(APP_window, arg_online_txt, arg_online_txt);
-                                   break;
-                         }
-                    }
-             
-                    // If debug mode is on - display info in console.
-                    if (arg_debug) Debug_Print(arg_online_txt);
-               }
-               else
-               {
-                    // Set global ENV variable in System to OFFLINE.
-                    SetVar(APP_ENV_NAME, arg_offline_txt, -1, GVF_GLOBAL_ONLY);
-
-                    // Only if window is visible.
-                    if (APP_window_visible)
-                    {
-                         switch(arg_mode)
-                         {
-                              case MODE_LABEL:
-                                   SetAPen(APP_window->RPort, 2);
-                                   RectFill(APP_window->RPort, 0, 0, arg_size_x, arg_size_y);
-                                   SetAPen(APP_window->RPort, 1);
-                                   SetBPen(APP_window->RPort, 2);
-                                   Move(APP_window->RPort, 0, APP_pubscreen->RastPort.TxBaseline);
-                                   Text(APP_window->RPort, (CONST_STRPTR)arg_offline_txt, strlen(arg_offline_txt));
-                                   SetWindowTitles(APP_window, arg_offline_txt, arg_offline_txt);
-                                   break;
-
-                              case MODE_BOX:
-                                   SetAPen(APP_window->RPort, arg_box_offline_pen);
-                                   RectFill(APP_window->RPort, 0, 0, arg_size_x, arg_size_y);
-                                   SetWindowTitles(APP_window, arg_offline_txt, arg_offline_txt);
-                                   break;
-
-                              case MODE_WINDOW_BAR:
-                                   SetWindowTitles(APP_window, arg_offline_txt, arg_offline_txt);
-                                   break;
-                         }
-                    }
+               // Everything due in the same tick is served by this one wakeup.
+               Wheel_Advance(&APP_wheel, Platform_Time());
+          }
 
-                    // If debug mode is on - display info in console.
-                    if (arg_debug) Debug_Print(arg_offline_txt);
-               }
+          // Stack lost by any of them - everything lets go before the session does.
+          if (cx_enabled && Net_Lost()) Session_Restart();
 
-               Timer_Send(arg_time_interval, 0);
-          }                           
+          // Earliest deadline on the wheel (next probe or timeout of one in
+          // flight, of any channel) - the timer is only resent when it moved.
+          if (cx_enabled) Timer_Arm(Wheel_Next(&APP_wheel));
 
           // ------------------------------------------------------------------------
           // --- If signal from window (if visible), enter window processing loop ---
@@ -0,0 +1,1077 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - POSIX daemon
+ *
+ * Headless backend of the monitor core for Linux and other
+ * POSIX systems, driven by poll() instead of WaitSelect().
+ * Every result is logged to stdout. With -e the status is
+ * also kept in files named like the Amiga ENV variables,
+ * rewritten only when their text changes.
+ *
+ * Control messages come as lines on stdin, so the latency of
+ * the loop can be measured while a probe is in flight:
+ *
+ *   status  - prints current status
+ *   stats   - prints counters and timings, updates the stats file
+ *   quit    - leaves the loop (same as CXCMD_KILL)
+ *
+ * With -l the status is pushed to clients of a Unix socket, one
+ * line per message:
+ *
+ *   subscribe [status] [rtt]  - "STATE ..." now, "CHANGED ..." whenever
+ *                               the status (or the RTT bucket) changes
+ *   query                     - "STATE Online 12.3 4" - status, RTT in
+ *                               ms and its bucket, "-" without an answer
+ *   unsubscribe               - "OK", the connection stays open
+ *
+ * A client that stops reading is dropped once its socket is full.
+ *
+ * With -w [ip:]port the status, per-target results, RTT and counters
+ * are served over HTTP for a scraper, see http.h:
+ *
+ *   curl http://127.0.0.1:8080/metrics
+ *
+ * With -o FILE every probe and change of the status is appended to
+ * an outage journal, see journal.h - tools/report.c reads it.
+ *
+ * With -k FILE the last status is kept in FILE, see snapshot.h,
+ * and shown right from the next start - msInternetStatus_STALE
+ * has its age in seconds until the first probe is done.
+ *
+ * With -s the copies on a subnet share one prober, see share.h.
+ * Several of them can be tried on one host with the loopback
+ * broadcast address, -s 127.255.255.255.
+ *
+ * SIGINT and SIGTERM end the loop as well, end of stdin only
+ * stops reading it - so it can run with stdin on /dev/null.
+ * ---------------------------------------------------------*/
+
+#include "http.h"
+#include "journal.h"
+#include "monitor.h"
+#include "notify.h"
+#include "share.h"
+#include "snapshot.h"
+#include "stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define   APP_NAME                 "msInternetStatus"
+#define   APP_ENV_NAME             "msInternetStatus"
+
+// Round trip times are published next to the status.
+#define   APP_ENV_RTT              APP_ENV_NAME"_RTT"
+#define   APP_ENV_RTT_P50          APP_ENV_NAME"_RTT_P50"
+#define   APP_ENV_RTT_P95          APP_ENV_NAME"_RTT_P95"
+#define   APP_ENV_RTT_MAX          APP_ENV_NAME"_RTT_MAX"
+#define   APP_ENV_STATS            APP_ENV_NAME"_STATS"
+
+// State of the host name cache, only with host name targets.
+#define   APP_ENV_RESOLVER         APP_ENV_NAME"_RESOLVER"
+
+// Status per address family, once a probe has tried it.
+#define   APP_ENV_IPV4             APP_ENV_NAME"_IPV4"
+#define   APP_ENV_IPV6             APP_ENV_NAME"_IPV6"
+
+// Result of the latest probe before flap damping - for diagnostics.
+#define   APP_ENV_RAW              APP_ENV_NAME"_RAW"
+
+// Where the path breaks, "Offline (gateway)" - only with -g.
+#define   APP_ENV_PATH             APP_ENV_NAME"_PATH"
+
+// Loss in percent and jitter in ms over the recent burst ticks - only with -b.
+#define   APP_ENV_LOSS             APP_ENV_NAME"_LOSS"
+#define   APP_ENV_JITTER           APP_ENV_NAME"_JITTER"
+
+// Role in the status sharing, "leader" or "follower 192.168.1.5" - only with -s.
+#define   APP_ENV_SHARE            APP_ENV_NAME"_SHARE"
+
+// Age in seconds of a status taken from the snapshot - only until the first probe.
+#define   APP_ENV_STALE            APP_ENV_NAME"_STALE"
+
+#define   DEF_TIME_INTERVAL        5
+#define   DEF_TIME_INTERVAL_MAX    0    // Same as the interval - no back-off.
+#define   DEF_CONFIRM_INTERVAL     1
+#define   DEF_JITTER               10
+#define   DEF_TCP_TIMEOUT          0         // Adaptive.
+#define   DEF_TCP_TIMEOUT_MIN      250       // Milliseconds.
+#define   DEF_TCP_TIMEOUT_MAX      5000
+#define   DEF_PORT                 80
+#define   DEF_ONLINE_TXT           "Online"
+#define   DEF_OFFLINE_TXT          "Offline"
+#define   DEF_FLAP_FAILURES        2         // Failed probes of the last DEF_FLAP_WINDOW for Offline.
+#define   DEF_FLAP_WINDOW          3
+#define   DEF_FLAP_SUCCESSES       2         // Answered probes in a row for Online again.
+#define   DEF_RESOLV_CONF          "/etc/resolv.conf"
+#define   DEF_DNS_SERVERS          "1.1.1.1", "8.8.8.8"    // If nothing is configured.
+#define   DEF_ROUTES               "/proc/net/route"       // Default gateway for -g auto.
+#define   DEF_GATEWAY_PORT         80        // Routers answer on their web interface, or with RST.
+#define   DEF_BURST_BUDGET         30        // Packets per tick - 10 connects.
+#define   DEF_SHARE_PORT           SHARE_PORT
+#define   DEF_HTTP_PORT            HTTP_PORT
+
+LONG   arg_time_interval = DEF_TIME_INTERVAL;
+LONG   arg_tcp_timeout   = DEF_TCP_TIMEOUT;
+LONG   arg_tcp_timeout_min   = DEF_TCP_TIMEOUT_MIN;
+LONG   arg_tcp_timeout_max   = DEF_TCP_TIMEOUT_MAX;
+LONG   arg_time_interval_max = DEF_TIME_INTERVAL_MAX;
+LONG   arg_confirm_interval  = DEF_CONFIRM_INTERVAL;
+LONG   arg_jitter            = DEF_JITTER;
+BYTE   arg_policy            = PROBE_POLICY_FIRST;
+LONG   arg_quorum;
+LONG   arg_flap_failures     = DEF_FLAP_FAILURES;
+LONG   arg_flap_window       = DEF_FLAP_WINDOW;
+LONG   arg_flap_successes    = DEF_FLAP_SUCCESSES;
+BYTE   arg_quiet;
+char*  arg_gateway;
+LONG   arg_burst;
+LONG   arg_burst_budget      = DEF_BURST_BUDGET;
+char*  arg_share;
+char*  arg_notify_path;
+char*  arg_http;
+char*  arg_journal;
+char*  arg_snapshot;
+char*  arg_env_dir;
+
+// Probing, scheduling and RTT statistics - the same core as on Amiga.
+struct Monitor APP_monitor;
+
+// Its deadlines - the poll() timeout is the earliest one.
+struct Wheel APP_wheel;
+
+// Addresses of host name targets.
+struct Resolver APP_resolver;
+
+// Gateway and name servers probed along with the targets, with -g.
+struct Diag APP_diag;
+
+// Light probes for loss and jitter along with every probe, with -b.
+struct Burst APP_burst;
+
+// One prober for the copies on the subnet, with -s.
+struct Share APP_share;
+
+// History of the status, with -o.
+struct Journal APP_journal;
+
+// Last status for the next start, with -k.
+struct Snapshot APP_snapshot;
+BYTE   APP_restored = -1;     // Status from it, shown until the first probe.
+
+// Status and metrics for scrapers, with -w.
+struct Http APP_http;
+
+// Subscribers of the notification socket, with -l.
+struct Notify APP_notify;
+
+struct App_Client
+{
+     LONG  socket;            // NET_NO_SOCKET - free slot.
+     char  line[128];         // Command read so far.
+     LONG  line_len;
+};
+
+struct App_Client APP_client[NOTIFY_MAX_CLIENTS];
+LONG   APP_notify_socket = NET_NO_SOCKET;
+
+// Set from signal handlers.
+volatile sig_atomic_t APP_quit;
+
+// What is currently in the status files, empty if not written.
+#define APP_ENV_VARS    15
+
+char   APP_shown_env[APP_ENV_VARS][32];
+
+TIME_US Platform_Time(void)
+{
+     struct timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+     return (TIME_US)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+static const char* Status_Text(void)
+{
+     BYTE status = APP_monitor.status < 0 ? APP_restored : APP_monitor.status;
+
+     if (status < 0) return "...";
+     return status ? DEF_ONLINE_TXT : DEF_OFFLINE_TXT;
+}
+
+// Counterpart of SetVar() - the file is replaced in one rename(), readers never see it half written.
+static void Status_Set_Var(LONG _index, const char *_name, const char *_text)
+{
+     if (arg_env_dir == NULL) return;
+
+     if (strcmp(_text, APP_shown_env[_index]) == 0)
+     {
+          Stats_Count(STATS_ENV_WRITES_SAVED);
+          return;
+     }
+
+     char path[512], temp_path[512];
+     snprintf(path, sizeof(path), "%s/%s", arg_env_dir, _name);
+     snprintf(temp_path, sizeof(temp_path), "%s/.%s.tmp", arg_env_dir, _name);
+
+     FILE *file = fopen(temp_path, "w");
+     if (file == NULL) return;
+
+     BYTE written = fputs(_text, file) >= 0;
+     if (fclose(file) != 0) written = 0;
+
+     if (!written || rename(temp_path, path) != 0)
+     {
+          unlink(temp_path);
+          return;
+     }
+
+     strncpy(APP_shown_env[_index], _text, sizeof(APP_shown_env[_index]) - 1);
+     Stats_Count(STATS_ENV_WRITES);
+}
+
+static void Status_Set_Rtt_Var(LONG _index, const char *_name, ULONG _micro, BYTE _valid)
+{
+     char text[16];
+
+     if (_valid) Rtt_Format(_micro, text);
+     else        strcpy(text, "-");
+
+     Status_Set_Var(_index, _name, text);
+}
+
+// Counterpart of DeleteVar().
+static void Status_Delete_Var(LONG _index, const char *_name)
+{
+     char path[512];
+
+     if (arg_env_dir == NULL) return;
+
+     snprintf(path, sizeof(path), "%s/%s", arg_env_dir, _name);
+     unlink(path);
+
+     APP_shown_env[_index][0] = 0;
+}
+
+static void Status_Delete(void)
+{
+     static const char *names[APP_ENV_VARS] = { APP_ENV_NAME, APP_ENV_RTT, APP_ENV_RTT_P50, APP_ENV_RTT_P95, APP_ENV_RTT_MAX, APP_ENV_STATS,
+          APP_ENV_RESOLVER, APP_ENV_IPV4, APP_ENV_IPV6, APP_ENV_RAW, APP_ENV_PATH, APP_ENV_LOSS, APP_ENV_JITTER, APP_ENV_SHARE, APP_ENV_STALE };
+
+     for (LONG i = 0; i < APP_ENV_VARS; i++) Status_Delete_Var(i, names[i]);
+}
+
+static void Status_Output(void)
+{
+     struct Rtt_Window *rtt = &APP_monitor.rtt;
+     BYTE online = APP_monitor.raw_status > 0;    // RTT of the latest probe, whatever is published.
+     BYTE have_samples = rtt->count > 0;
+
+     Status_Set_Var(0, APP_ENV_NAME, Status_Text());
+     Status_Set_Rtt_Var(1, APP_ENV_RTT, rtt->last, online);
+     Status_Set_Rtt_Var(2, APP_ENV_RTT_P50, Rtt_Percentile(rtt, 50), have_samples);
+     Status_Set_Rtt_Var(3, APP_ENV_RTT_P95, Rtt_Percentile(rtt, 95), have_samples);
+     Status_Set_Rtt_Var(4, APP_ENV_RTT_MAX, Rtt_Max(rtt), have_samples);
+
+     if (APP_monitor.raw_status >= 0) Status_Set_Var(9, APP_ENV_RAW, APP_monitor.raw_status ? DEF_ONLINE_TXT : DEF_OFFLINE_TXT);
+
+     // Offline with the hop it broke at, from the latest probe that failed - damping may still show the one before.
+     if (APP_monitor.diag && APP_monitor.status >= 0)
+     {
+          char path[32];
+
+          if (APP_monitor.status) strcpy(path, DEF_ONLINE_TXT);
+          else snprintf(path, sizeof(path), "%s (%s)", DEF_OFFLINE_TXT, Diag_Verdict_Text(APP_diag.failure));
+
+          Status_Set_Var(10, APP_ENV_PATH, path);
+     }
+
+     if (APP_monitor.burst && Burst_Loss(&APP_burst) >= 0)
+     {
+          char loss[16];
+          LONG permille = Burst_Loss(&APP_burst);
+
+          sprintf(loss, "%ld.%ld", (long)(permille / 10), (long)(permille % 10));
+          Status_Set_Var(11, APP_ENV_LOSS, loss);
+          Status_Set_Rtt_Var(12, APP_ENV_JITTER, Burst_Jitter(&APP_burst), APP_burst.jitter_count > 0);
+     }
+
+     if (APP_share.role != SHARE_ROLE_NONE)
+     {
+          char role[32], ip_text[16];
+
+          Net_Format_Ip(APP_share.leader_ip, ip_text);
+          if (APP_share.role == SHARE_ROLE_FOLLOWER && APP_share.leader_id) snprintf(role, sizeof(role), "%s %s", Share_Role_Text(APP_share.role), ip_text);
+          else strcpy(role, Share_Role_Text(APP_share.role));
+
+          Status_Set_Var(13, APP_ENV_SHARE, role);
+     }
+
+     if (APP_resolver.name_count) Status_Set_Var(6, APP_ENV_RESOLVER, Resolve_State_Text(Resolve_State(&APP_resolver)));
+
+     for (BYTE family = 0; family < NET_FAMILIES; family++)
+     {
+          BYTE status = APP_monitor.family_status[(UBYTE)family];
+
+          if (status >= 0) Status_Set_Var(7 + family, family == NET_FAMILY_V6 ? APP_ENV_IPV6 : APP_ENV_IPV4, status ? DEF_ONLINE_TXT : DEF_OFFLINE_TXT);
+     }
+}
+
+static void Status_Log(void)
+{
+     struct Probe *probe = &APP_monitor.probe;
+     struct Rtt_Window *rtt = &APP_monitor.rtt;
+
+     printf("STATUS: %s", Status_Text());
+
+     // Held back by damping - the probe said otherwise.
+     if (APP_monitor.raw_status >= 0 && APP_monitor.raw_status != APP_monitor.status)
+          printf(" (raw %s, %d of last %d failed)", APP_monitor.raw_status ? DEF_ONLINE_TXT : DEF_OFFLINE_TXT, APP_monitor.damp.failures,
+               APP_monitor.damp.results);
+
+     // Not our probe - the leader's.
+     if (APP_share.role == SHARE_ROLE_FOLLOWER)
+     {
+          char ip_text[16];
+
+          Net_Format_Ip(APP_share.leader_ip, ip_text);
+          printf(" (from %s)", ip_text);
+     }
+
+     // How each target ended, in the order they were given - both families of a dual-stack one.
+     for (LONG i = 0; i < probe->target_count && APP_share.role != SHARE_ROLE_FOLLOWER; i++)
+     {
+          struct Probe_Target *target = &probe->target[i];
+
+          printf("%s%s", i ? ", " : " [", Probe_Status_Text(target->status));
+
+          if (target->attempt[NET_FAMILY_V6].status == IP_STATUS_NOT_USED) continue;
+
+          printf(" (IPv6 %s", Probe_Status_Text(target->attempt[NET_FAMILY_V6].status));
+          if (target->attempt[NET_FAMILY_V4].status != IP_STATUS_NOT_USED) printf(", IPv4 %s", Probe_Status_Text(target->attempt[NET_FAMILY_V4].status));
+          printf(")");
+     }
+
+     if (APP_share.role != SHARE_ROLE_FOLLOWER) printf("]");
+
+     for (BYTE family = 0; family < NET_FAMILIES; family++)
+     {
+          BYTE status = APP_monitor.family_status[(UBYTE)family];
+          if (status >= 0) printf(" IPv%d %s", family == NET_FAMILY_V6 ? 6 : 4, status ? DEF_ONLINE_TXT : DEF_OFFLINE_TXT);
+     }
+
+     // Hops of a failed probe and where that puts the break.
+     if (APP_monitor.diag && APP_monitor.raw_status == 0)
+     {
+          printf(" PATH");
+
+          for (BYTE hop = 0; hop < DIAG_HOPS; hop++)
+          {
+               BYTE status = APP_diag.hop_status[(UBYTE)hop];
+               if (status >= 0) printf(" %s %s,", Diag_Verdict_Text(DIAG_VERDICT_GATEWAY + hop), status ? DEF_ONLINE_TXT : DEF_OFFLINE_TXT);
+          }
+
+          printf(" broken at %s", Diag_Verdict_Text(APP_diag.verdict));
+     }
+
+     if (rtt->count)
+     {
+          char rtt_last[16], rtt_p50[16], rtt_p95[16], rtt_max[16];
+          Rtt_Format(rtt->last, rtt_last);
+          Rtt_Format(Rtt_Percentile(rtt, 50), rtt_p50);
+          Rtt_Format(Rtt_Percentile(rtt, 95), rtt_p95);
+          Rtt_Format(Rtt_Max(rtt), rtt_max);
+
+          printf(" RTT %s ms (p50 %s, p95 %s, max %s)", APP_monitor.raw_status > 0 ? rtt_last : "-", rtt_p50, rtt_p95, rtt_max);
+     }
+
+     if (APP_monitor.burst && Burst_Loss(&APP_burst) >= 0)
+     {
+          char jitter[16];
+          LONG permille = Burst_Loss(&APP_burst);
+
+          Rtt_Format(Burst_Jitter(&APP_burst), jitter);
+          printf(" LOSS %ld.%ld%% of %lu (jitter %s ms)", (long)(permille / 10), (long)(permille % 10), (unsigned long)APP_burst.sent, jitter);
+     }
+
+     char timeout[16];
+     Rtt_Format(APP_monitor.timeout_us, timeout);
+     printf(" timeout %s ms", timeout);
+
+     // Names without a fresh address - kept apart from the link status.
+     for (LONG i = 0; i < APP_resolver.name_count; i++)
+     {
+          struct Resolve_Name *name = &APP_resolver.name[i];
+
+          if (name->state == RESOLVE_NAME_STALE || name->state == RESOLVE_NAME_FAILED)
+               printf(" (%s %s: %s)", name->host, Resolve_State_Text(name->state), Resolve_Error_Text(name->error));
+     }
+
+     printf("\n");
+     fflush(stdout);
+}
+
+// Listening Unix socket at _path, a stale one from a crashed run is replaced.
+static LONG Client_Listen(const char *_path)
+{
+     struct sockaddr_un address;
+
+     if (strlen(_path) >= sizeof(address.sun_path)) return NET_NO_SOCKET;
+
+     LONG listen_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+     if (listen_socket == -1) return NET_NO_SOCKET;
+
+     memset(&address, 0, sizeof(address));
+     address.sun_family = AF_UNIX;
+     strcpy(address.sun_path, _path);
+     unlink(_path);
+
+     if (fcntl(listen_socket, F_SETFL, O_NONBLOCK) == -1 || bind(listen_socket, (struct sockaddr*)&address, sizeof(address)) == -1 ||
+          listen(listen_socket, 128) == -1)
+     {
+          close(listen_socket);
+          return NET_NO_SOCKET;
+     }
+
+     for (LONG i = 0; i < NOTIFY_MAX_CLIENTS; i++) APP_client[i].socket = NET_NO_SOCKET;
+
+     return listen_socket;
+}
+
+static void Client_Drop(struct App_Client *_client)
+{
+     Notify_Unsubscribe(&APP_notify, _client);
+     close(_client->socket);
+
+     _client->socket = NET_NO_SOCKET;
+     _client->line_len = 0;
+}
+
+// Returns 0 if the client was dropped - it does not read, or has gone.
+static BYTE Client_Write(struct App_Client *_client, const char *_text)
+{
+     LONG length = strlen(_text);
+
+     if (send(_client->socket, _text, length, MSG_NOSIGNAL) == length) return 1;
+
+     Client_Drop(_client);
+     return 0;
+}
+
+// "Online 12.3 4" - status, RTT in ms and its bucket.
+static BYTE Client_Write_State(struct App_Client *_client, const char *_kind)
+{
+     struct Notify_State *state = &APP_notify.state;
+     char text[64], rtt[16], bucket[8];
+
+     if (state->rtt_bucket >= 0)
+     {
+          Rtt_Format(state->rtt, rtt);
+          sprintf(bucket, "%d", state->rtt_bucket);
+     }
+     else strcpy(rtt, "-"), strcpy(bucket, "-");
+
+     snprintf(text, sizeof(text), "%s %s %s %s\n", _kind, state->status < 0 ? "..." : state->status ? DEF_ONLINE_TXT : DEF_OFFLINE_TXT, rtt, bucket);
+
+     return Client_Write(_client, text);
+}
+
+static void Client_Command(struct App_Client *_client, char *_line)
+{
+     char *word = strtok(_line, " \t");
+
+     if (word == NULL) return;
+
+     if (strcmp(word, "query") == 0) Client_Write_State(_client, "STATE");
+     else if (strcmp(word, "unsubscribe") == 0)
+     {
+          Notify_Unsubscribe(&APP_notify, _client);
+          Client_Write(_client, "OK\n");
+     }
+     else if (strcmp(word, "subscribe") == 0)
+     {
+          UBYTE events = 0;
+
+          while ((word = strtok(NULL, " \t")))
+          {
+               if (strcmp(word, "status") == 0) events |= NOTIFY_STATUS;
+               if (strcmp(word, "rtt") == 0)    events |= NOTIFY_RTT;
+          }
+
+          if (Notify_Subscribe(&APP_notify, _client, events ? events : NOTIFY_STATUS)) Client_Write_State(_client, "STATE");
+          else Client_Write(_client, "ERROR full\n");
+     }
+     else Client_Write(_client, "ERROR unknown command\n");
+}
+
+static void Client_Read(struct App_Client *_client)
+{
+     char buffer[256];
+     LONG length = recv(_client->socket, buffer, sizeof(buffer), 0);
+
+     if (length < 0 && (errno == EAGAIN || errno == EINTR)) return;
+
+     if (length <= 0)
+     {
+          Client_Drop(_client);
+          return;
+     }
+
+     for (LONG i = 0; i < length && _client->socket != NET_NO_SOCKET; i++)
+     {
+          if (buffer[i] == '\n' || buffer[i] == '\r')
+          {
+               _client->line[_client->line_len] = 0;
+               _client->line_len = 0;
+
+               Client_Command(_client, _client->line);
+          }
+          else if (_client->line_len < (LONG)sizeof(_client->line) - 1)
+               _client->line[_client->line_len++] = buffer[i];
+     }
+}
+
+static void Client_Accept(void)
+{
+     for (;;)
+     {
+          LONG client_socket = accept(APP_notify_socket, NULL, NULL);
+          if (client_socket == -1) return;
+
+          LONG i = 0;
+          while (i < NOTIFY_MAX_CLIENTS && APP_client[i].socket != NET_NO_SOCKET) i++;
+
+          if (i == NOTIFY_MAX_CLIENTS || fcntl(client_socket, F_SETFL, O_NONBLOCK) == -1)
+          {
+               close(client_socket);
+               continue;
+          }
+
+          APP_client[i].socket = client_socket;
+          APP_client[i].line_len = 0;
+     }
+}
+
+// Listening socket first, then the clients, in slot order.
+static LONG Client_Watch(struct Net_Watch *_watch)
+{
+     if (APP_notify_socket == NET_NO_SOCKET) return 0;
+
+     _watch[0].socket = APP_notify_socket;
+     _watch[0].want = NET_EVENT_READ;
+
+     for (LONG i = 0; i < NOTIFY_MAX_CLIENTS; i++)
+     {
+          _watch[1 + i].socket = APP_client[i].socket;
+          _watch[1 + i].want = NET_EVENT_READ;
+     }
+
+     return 1 + NOTIFY_MAX_CLIENTS;
+}
+
+static void Client_Service(struct Net_Watch *_watch, LONG _count)
+{
+     for (LONG i = 1; i < _count; i++)
+          if (_watch[i].ready && APP_client[i - 1].socket == _watch[i].socket) Client_Read(&APP_client[i - 1]);
+
+     if (_count && _watch[0].ready) Client_Accept();
+}
+
+// Pushes the state to the subscribers that did not hear it yet.
+static void Client_Notify(void)
+{
+     for (LONG i = 0; i < APP_notify.client_count; )
+     {
+          struct Notify_Client *client = &APP_notify.client[i];
+
+          if (!Notify_Pending(&APP_notify, client))
+          {
+               i++;
+               continue;
+          }
+
+          Notify_Delivered(&APP_notify, client);
+
+          // Dropped - the last subscriber took its place in the table.
+          if (Client_Write_State((struct App_Client*)client->handle, "CHANGED")) i++;
+     }
+}
+
+static void Client_Close(const char *_path)
+{
+     if (APP_notify_socket == NET_NO_SOCKET) return;
+
+     for (LONG i = 0; i < NOTIFY_MAX_CLIENTS; i++)
+          if (APP_client[i].socket != NET_NO_SOCKET) Client_Drop(&APP_client[i]);
+
+     close(APP_notify_socket);
+     APP_notify_socket = NET_NO_SOCKET;
+     unlink(_path);
+}
+
+// Record of the main monitor - the wall clock, the journal outlives the process.
+static void Status_Journal(BYTE _type)
+{
+     struct Journal_Record record;
+
+     if (!arg_journal) return;
+
+     record.time = (ULONG)time(NULL);
+     record.type = _type;
+     record.status = APP_monitor.status;
+     record.raw_status = APP_monitor.raw_status;
+     record.verdict = APP_monitor.diag ? APP_diag.verdict : DIAG_VERDICT_NONE;
+     record.rtt = APP_monitor.raw_status > 0 ? APP_monitor.rtt.last : 0;
+     record.answered = (UBYTE)APP_monitor.probe.answered;
+     record.targets = (UBYTE)APP_monitor.probe.target_count;
+
+     Journal_Add(&APP_journal, &record);
+}
+
+// socket() failed - the stack is going. Same order as on Amiga: everything with a socket
+// lets go before the session does, probes and lookups come again at their time.
+static void Session_Restart(void)
+{
+     Share_Stop(&APP_share);
+     Monitor_Abort(&APP_monitor);
+     if (APP_monitor.burst) Burst_Stop(&APP_burst);
+     Resolve_Abort(&APP_resolver);
+     Http_Stop(&APP_http);
+
+     Net_Close();
+
+     if (arg_share) Share_Start(&APP_share);
+     if (arg_http) Http_Start(&APP_http);
+}
+
+// Called by the monitor core after every finished probe.
+void Platform_Publish(struct Monitor *_monitor)
+{
+     (void)_monitor;
+
+     // Followers hear it before anything is written here.
+     if (arg_share) Share_Publish(&APP_share);
+     Http_Publish(&APP_http);
+
+     TIME_US start = Platform_Time();
+
+     // A real status now - the one from the snapshot goes.
+     if (APP_restored >= 0)
+     {
+          APP_restored = -1;
+          Status_Delete_Var(14, APP_ENV_STALE);
+     }
+
+     Status_Output();
+     Status_Journal(JOURNAL_TYPE_PROBE);
+     Snapshot_Update(&APP_snapshot, &APP_monitor, (ULONG)time(NULL));
+
+     // RTT of the latest probe, whatever is published - same as msInternetStatus_RTT.
+     if (Notify_Update(&APP_notify, APP_monitor.status, APP_monitor.raw_status > 0, APP_monitor.rtt.last)) Client_Notify();
+     Stats_Time(STATS_OUTPUT, start);
+
+     if (!arg_quiet) Status_Log();
+}
+
+// Returns 0 if the loop should end.
+static BYTE Control_Line(char *_line)
+{
+     if (strcmp(_line, "quit") == 0) return 0;
+
+     if (strcmp(_line, "status") == 0)
+     {
+          printf("%s\n", Status_Text());
+          fflush(stdout);
+     }
+
+     if (strcmp(_line, "stats") == 0)
+     {
+          char text[512];
+
+          Stats_Format(text, sizeof(text));
+          Status_Set_Var(5, APP_ENV_STATS, text);
+
+          Stats_Print();
+          printf("TIMER: %lu wakeups (%lu per hour), %lu fired, %lu coalesced\n", (unsigned long)APP_wheel.wakeups,
+               (unsigned long)Wheel_Wakeups_Per_Hour(&APP_wheel, Platform_Time()), (unsigned long)APP_wheel.fired, (unsigned long)APP_wheel.coalesced);
+
+          for (LONG i = 0; i < APP_resolver.name_count; i++)
+          {
+               struct Resolve_Name *name = &APP_resolver.name[i];
+               char ip_text[16], ip6_text[40];
+
+               Net_Format_Ip(name->ip, ip_text);
+               Net_Format_Ip6(name->ip6, ip6_text);
+               printf("NAME %s: %s %s %s, TTL %lu s, %lu lookups, %lu failed (%s)\n", name->host,
+                    (name->families & (1 << NET_FAMILY_V4)) ? ip_text : "-", (name->families & (1 << NET_FAMILY_V6)) ? ip6_text : "-",
+                    Resolve_State_Text(name->state), (unsigned long)name->ttl, (unsigned long)name->lookups, (unsigned long)name->lookups_failed,
+                    Resolve_Error_Text(name->error));
+          }
+          fflush(stdout);
+     }
+
+     return 1;
+}
+
+// Reads what is on stdin and runs complete lines.
+// Returns 0 if the loop should end, -1 if there is nothing more to read.
+static BYTE Control_Read(void)
+{
+     static char line[128];
+     static LONG line_len = 0;
+
+     char buffer[128];
+     LONG length = read(STDIN_FILENO, buffer, sizeof(buffer));
+
+     if (length < 0 && errno == EINTR) return 1;
+     if (length <= 0) return -1;
+
+     for (LONG i = 0; i < length; i++)
+     {
+          if (buffer[i] == '\n' || buffer[i] == '\r')
+          {
+               line[line_len] = 0;
+               line_len = 0;
+
+               if (line[0] && !Control_Line(line)) return 0;
+          }
+          else if (line_len < (LONG)sizeof(line) - 1)
+               line[line_len++] = buffer[i];
+     }
+
+     return 1;
+}
+
+static void Signal_Quit(int _signal)
+{
+     (void)_signal;
+     APP_quit = 1;
+}
+
+static void Usage(void)
+{
+     fprintf(stderr, "Usage: %s [-i interval_sec] [-m max_interval_sec] [-c confirm_sec] [-j jitter_percent]\n"
+          "   [-t timeout_sec] [-n min_timeout_ms] [-x max_timeout_ms]\n"
+          "   [-p first|all|answers_needed]\n"
+          "   [-d failures/window] [-u successes]\n"
+          "   [-g auto|gateway[:port]]\n"
+          "   [-b probes[/budget]]\n"
+          "   [-s broadcast[:port]]\n"
+          "   [-r dns_server[:port]]\n"
+          "   [-e status_dir] [-l notify_socket] [-w [ip:]http_port] [-o journal] [-k snapshot] [-q]\n"
+          "   host[:port] ...\n", APP_NAME);
+}
+
+int main(int argc, char **argv)
+{
+     // Before the options - -r adds servers to it.
+     Wheel_Init(&APP_wheel);
+     Resolve_Init(&APP_resolver, &APP_wheel);
+
+     int opt;
+     while ((opt = getopt(argc, argv, "i:m:c:j:t:n:x:p:d:u:g:b:s:r:e:l:w:o:k:q")) != -1)
+     {
+          switch (opt)
+          {
+               case 'i': arg_time_interval = atoi(optarg); break;
+               case 'm': arg_time_interval_max = atoi(optarg); break;
+               case 'c': arg_confirm_interval = atoi(optarg); break;
+               case 'j': arg_jitter = atoi(optarg); break;
+               case 't': arg_tcp_timeout = atoi(optarg); break;
+               case 'n': arg_tcp_timeout_min = atoi(optarg); break;
+               case 'x': arg_tcp_timeout_max = atoi(optarg); break;
+               case 'p':
+                    // Policy name or the number of answers needed.
+                    if (strcmp(optarg, "first") == 0)    arg_policy = PROBE_POLICY_FIRST;
+                    else if (strcmp(optarg, "all") == 0) arg_policy = PROBE_POLICY_ALL;
+                    else
+                    {
+                         arg_policy = PROBE_POLICY_QUORUM;
+                         arg_quorum = atoi(optarg);
+                         if (arg_quorum < 1)
+                         {
+                              Usage();
+                              return 1;
+                         }
+                    }
+                    break;
+               case 'd':
+                    // Failed probes out of the last ones that make it offline, "2/3".
+                    arg_flap_failures = atoi(optarg);
+                    arg_flap_window = strchr(optarg, '/') ? atoi(strchr(optarg, '/') + 1) : 0;
+
+                    if (arg_flap_failures < 1 || arg_flap_window < arg_flap_failures || arg_flap_window > DAMP_WINDOW_MAX)
+                    {
+                         Usage();
+                         return 1;
+                    }
+                    break;
+               case 'u': arg_flap_successes = atoi(optarg); break;
+               case 'g': arg_gateway = optarg; break;
+               case 'b':
+                    // Light probes per tick, and the packets they may send, "8/30".
+                    arg_burst = atoi(optarg);
+                    if (strchr(optarg, '/')) arg_burst_budget = atoi(strchr(optarg, '/') + 1);
+
+                    if (arg_burst < 1 || arg_burst > BURST_MAX_PROBES || arg_burst_budget < 1)
+                    {
+                         Usage();
+                         return 1;
+                    }
+                    break;
+               case 's': arg_share = optarg; break;
+               case 'r':
+                    if (!Resolve_Add_Server(&APP_resolver, optarg))
+                    {
+                         Usage();
+                         return 1;
+                    }
+                    break;
+               case 'e': arg_env_dir = optarg; break;
+               case 'l': arg_notify_path = optarg; break;
+               case 'w': arg_http = optarg; break;
+               case 'o': arg_journal = optarg; break;
+               case 'k': arg_snapshot = optarg; break;
+               case 'q': arg_quiet = 1; break;
+               default:  Usage(); return 1;
+          }
+     }
+
+     if (arg_time_interval < 1) arg_time_interval = DEF_TIME_INTERVAL;
+     if (arg_time_interval_max < arg_time_interval) arg_time_interval_max = arg_time_interval;
+     if (arg_tcp_timeout < 0)   arg_tcp_timeout = DEF_TCP_TIMEOUT;
+     if (arg_tcp_timeout_min < 1) arg_tcp_timeout_min = DEF_TCP_TIMEOUT_MIN;
+     if (arg_tcp_timeout_max < arg_tcp_timeout_min) arg_tcp_timeout_max = arg_tcp_timeout_min;
+     if (arg_confirm_interval < 1) arg_confirm_interval = DEF_CONFIRM_INTERVAL;
+     if (arg_jitter < 0 || arg_jitter > 50) arg_jitter = DEF_JITTER;
+     if (arg_flap_successes < 1) arg_flap_successes = DEF_FLAP_SUCCESSES;
+
+     Monitor_Init(&APP_monitor, arg_time_interval * 1000, arg_time_interval_max * 1000, arg_confirm_interval * 1000, arg_jitter, &APP_wheel);
+     Monitor_Set_Timeout(&APP_monitor, arg_tcp_timeout * 1000000, arg_tcp_timeout_min * 1000, arg_tcp_timeout_max * 1000);
+
+     Monitor_Set_Policy(&APP_monitor, arg_policy, arg_quorum);
+     Monitor_Set_Damping(&APP_monitor, arg_flap_failures, arg_flap_window, arg_flap_successes);
+
+     for (int i = optind; i < argc; i++)
+     {
+          struct Probe_Target target;
+
+          if (!Probe_Parse_Target(argv[i], DEF_PORT, &target, &APP_resolver) || !Monitor_Add_Parsed(&APP_monitor, &target))
+          {
+               fprintf(stderr, "%s: Error! Bad target %s.\n", APP_NAME, argv[i]);
+               return 1;
+          }
+     }
+
+     if (APP_monitor.probe.target_count == 0)
+     {
+          Usage();
+          return 1;
+     }
+
+     // Name servers for host name targets and the diagnosis - -r, the system ones or public ones.
+     if ((APP_resolver.name_count || arg_gateway) && APP_resolver.server_count == 0 && Resolve_Read_Servers(&APP_resolver, DEF_RESOLV_CONF) == 0)
+     {
+          static const char *servers[] = { DEF_DNS_SERVERS };
+
+          for (LONG i = 0; i < (LONG)(sizeof(servers) / sizeof(servers[0])); i++) Resolve_Add_Server(&APP_resolver, servers[i]);
+     }
+
+     // Path diagnosis - the gateway and the name servers are probed with the targets.
+     if (arg_gateway)
+     {
+          struct Probe_Target target;
+
+          Diag_Init(&APP_diag);
+
+          if (strcmp(arg_gateway, "auto") == 0)
+          {
+               if (Diag_Read_Gateway(&APP_diag, DEF_ROUTES, DEF_GATEWAY_PORT) == 0)
+                    fprintf(stderr, "%s: Warning! No default gateway in %s.\n", APP_NAME, DEF_ROUTES);
+          }
+          else if (!Probe_Parse_Target(arg_gateway, DEF_GATEWAY_PORT, &target, NULL) || !Diag_Add(&APP_diag, DIAG_HOP_GATEWAY, &target))
+          {
+               fprintf(stderr, "%s: Error! Bad gateway %s.\n", APP_NAME, arg_gateway);
+               return 1;
+          }
+
+          Diag_Add_Servers(&APP_diag, &APP_resolver);
+          Monitor_Set_Diag(&APP_monitor, &APP_diag);
+     }
+
+     // Loss sampling - K light probes with every probe, within the packet budget.
+     if (arg_burst)
+     {
+          Burst_Init(&APP_burst, arg_burst, arg_burst_budget, &APP_wheel);
+          Monitor_Set_Burst(&APP_monitor, &APP_burst);
+     }
+
+     // Status sharing - the copies on the subnet elect one prober, the heartbeat is the interval.
+     if (arg_share)
+     {
+          ULONG address;
+          UWORD port = DEF_SHARE_PORT;
+
+          if (!Net_Parse_Target(arg_share, &address, &port))
+          {
+               fprintf(stderr, "%s: Error! Bad broadcast address %s.\n", APP_NAME, arg_share);
+               return 1;
+          }
+
+          // Copies started in the same second on different hosts still get different ids.
+          Share_Init(&APP_share, &APP_monitor, address, port, arg_time_interval * 1000, (ULONG)getpid() * 2654435761UL ^ (ULONG)Platform_Time(), &APP_wheel);
+     }
+
+     // HTTP listener - a bare port listens on all interfaces.
+     if (arg_http)
+     {
+          ULONG address = 0;
+          UWORD port = DEF_HTTP_PORT;
+
+          if (!Net_Parse_Port(arg_http, &port) && !Net_Parse_Target(arg_http, &address, &port))
+          {
+               fprintf(stderr, "%s: Error! Bad HTTP address %s.\n", APP_NAME, arg_http);
+               return 1;
+          }
+
+          Http_Init(&APP_http, &APP_monitor, address, port);
+     }
+
+     // No SA_RESTART - poll() has to return, so the loop sees the flag.
+     struct sigaction action;
+     memset(&action, 0, sizeof(action));
+     action.sa_handler = Signal_Quit;
+     sigaction(SIGINT, &action, NULL);
+     sigaction(SIGTERM, &action, NULL);
+
+     // A reader of stdout going away must not kill the daemon.
+     signal(SIGPIPE, SIG_IGN);
+
+     // One socket session for the whole run.
+     Net_Open();
+
+     // Push notification instead of reading the status files over and over.
+     Notify_Init(&APP_notify);
+
+     if (arg_notify_path && (APP_notify_socket = Client_Listen(arg_notify_path)) == NET_NO_SOCKET)
+     {
+          fprintf(stderr, "%s: Error! Can't listen on %s.\n", APP_NAME, arg_notify_path);
+          return 1;
+     }
+
+     if (arg_http && !Http_Start(&APP_http))
+     {
+          fprintf(stderr, "%s: Error! Can't listen on HTTP port %s.\n", APP_NAME, arg_http);
+          return 1;
+     }
+
+     // Last status of the previous run, if there is one - RTT and timeout are warm
+     // right away. The first probe still goes out now.
+     Snapshot_Init(&APP_snapshot, arg_snapshot);
+
+     ULONG age;
+     APP_restored = Snapshot_Load(&APP_snapshot, &APP_monitor, (ULONG)time(NULL), &age);
+
+     // Same as SetVar() of "..." on Amiga - or of the restored status.
+     Status_Output();
+
+     if (APP_restored >= 0)
+     {
+          char text[16];
+
+          snprintf(text, sizeof(text), "%lu", (unsigned long)age);
+          Status_Set_Var(14, APP_ENV_STALE, text);
+
+          if (!arg_quiet) printf("STATUS: %s (from %s, %lu s old)\n", Status_Text(), arg_snapshot, (unsigned long)age);
+     }
+
+     // --------------------------------------
+     // --- Enter the main processing loop ---
+     // --------------------------------------
+
+     // Names are looked up right away, the first probe waits for them.
+     Resolve_Start(&APP_resolver);
+     Monitor_Start(&APP_monitor);
+
+     // The time before this is not known to the journal.
+     Journal_Init(&APP_journal, arg_journal);
+     Status_Journal(JOURNAL_TYPE_START);
+
+     // Follows until it knows whether somebody else probes.
+     if (arg_share && !Share_Start(&APP_share)) fprintf(stderr, "%s: Warning! Can't open the sharing socket, probing alone.\n", APP_NAME);
+
+     BYTE control = 1;
+     BYTE loop = 1;
+
+     while (loop && !APP_quit)
+     {
+          struct Net_Watch watch[1 + MONITOR_MAX_WATCH + RESOLVE_MAX_NAMES + 1 + 1 + HTTP_MAX_CLIENTS + 1 + NOTIFY_MAX_CLIENTS];
+
+          // Control channel is always the first entry, skipped by poll() once stdin has ended.
+          watch[0].socket = control ? STDIN_FILENO : NET_NO_SOCKET;
+          watch[0].want = NET_EVENT_READ;
+
+          LONG probe_count = Monitor_Watch(&APP_monitor, watch + 1, MONITOR_MAX_WATCH);
+          LONG resolve_count = Resolve_Watch(&APP_resolver, watch + 1 + probe_count, RESOLVE_MAX_NAMES);
+          LONG share_count = Share_Watch(&APP_share, watch + 1 + probe_count + resolve_count, 1);
+          LONG http_count = Http_Watch(&APP_http, watch + 1 + probe_count + resolve_count + share_count, 1 + HTTP_MAX_CLIENTS);
+          LONG client_count = Client_Watch(watch + 1 + probe_count + resolve_count + share_count + http_count);
+          LONG count = 1 + probe_count + resolve_count + share_count + http_count + client_count;
+
+          TIME_US now = Platform_Time();
+          TIME_US deadline = Wheel_Next(&APP_wheel);
+          TIME_US wait = deadline > now ? deadline - now : 0;
+
+          LONG ready = Net_Wait(watch, count, wait / 1000000, wait % 1000000, NULL);
+
+          // Interrupted by a signal - the flag is checked by the loop.
+          if (ready < 0 && errno == EINTR) continue;
+
+          if (ready > 0 && watch[0].ready)
+          {
+               BYTE result = Control_Read();
+
+               if (result == 0)  loop = 0;
+               if (result < 0)   control = 0;
+          }
+
+          // Probe sockets ready - finish as soon as decided.
+          if (ready > 0) Monitor_Service(&APP_monitor, watch + 1, probe_count);
+          if (ready > 0) Resolve_Service(&APP_resolver, watch + 1 + probe_count, resolve_count);
+          if (ready > 0) Share_Service(&APP_share, watch + 1 + probe_count + resolve_count, share_count);
+          if (ready > 0) Http_Service(&APP_http, watch + 1 + probe_count + resolve_count + share_count, http_count);
+          if (ready > 0) Client_Service(watch + 1 + probe_count + resolve_count + share_count + http_count, client_count);
+
+          // poll() itself failed - don't spin on it until the timeout.
+          if (ready < 0)
+          {
+               Monitor_Abort(&APP_monitor);
+               Resolve_Abort(&APP_resolver);
+          }
+
+          // Timer - start the probe or, if it is already in flight, time it out.
+          if (loop && Platform_Time() >= Wheel_Next(&APP_wheel)) Wheel_Advance(&APP_wheel, Platform_Time());
+
+          if (Net_Lost()) Session_Restart();
+     }
+
+     // Clean up - a leader says bye, so a follower takes over without waiting.
+     // The journal writes out what it holds, the snapshot keeps the last status.
+     Status_Journal(JOURNAL_TYPE_STOP);
+     Snapshot_Save(&APP_snapshot, &APP_monitor, (ULONG)time(NULL));
+     Share_Stop(&APP_share);
+     Monitor_Stop(&APP_monitor);
+     Resolve_Stop(&APP_resolver);
+     Client_Close(arg_notify_path);
+     Http_Stop(&APP_http);
+     Net_Close();
+     Status_Delete();
+
+     return 0;
+}
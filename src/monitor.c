@@ -0,0 +1,340 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - monitor core
+ * ---------------------------------------------------------*/
+
+#include "monitor.h"
+#include "stats.h"
+
+#include <string.h>
+
+// Timers may round - a deadline this close counts as reached.
+#define MONITOR_TIMER_SLACK_US     1000
+
+static void Monitor_Expired(struct Wheel_Timer *_timer)
+{
+     Monitor_Timer((struct Monitor*)_timer->data);
+}
+
+static void Monitor_Probe_Done(struct Monitor *_monitor);
+
+// Returns 1 when the probe has its result - and, if it failed, the diagnosis too.
+static BYTE Monitor_Settled(struct Monitor *_monitor)
+{
+     struct Probe *probe = &_monitor->probe;
+
+     if (!probe->done && probe->in_flight) return 0;
+     if (_monitor->diag && !probe->result && !Diag_Done(_monitor->diag)) return 0;
+
+     return 1;
+}
+
+static void Monitor_Stagger(struct Wheel_Timer *_timer)
+{
+     struct Monitor *monitor = (struct Monitor*)_timer->data;
+
+     if (!monitor->probing) return;
+
+     Probe_Stagger(&monitor->probe);
+
+     if (Monitor_Settled(monitor))
+     {
+          Monitor_Probe_Done(monitor);
+          return;
+     }
+
+     TIME_US next = Probe_Stagger_Time(&monitor->probe);
+     if (next) Wheel_Add(monitor->wheel, &monitor->stagger, next);
+}
+
+void Monitor_Init(struct Monitor *_monitor, ULONG _interval_ms, ULONG _interval_max_ms, ULONG _confirm_ms, LONG _jitter_percent, struct Wheel *_wheel)
+{
+     memset(_monitor, 0, sizeof(struct Monitor));
+
+     Probe_Init(&_monitor->probe);
+     Rtt_Init(&_monitor->rtt);
+     Sched_Init(&_monitor->sched, _interval_ms, _interval_max_ms, _confirm_ms, _jitter_percent);
+     Damp_Init(&_monitor->damp, 1, 1, 1);
+
+     _monitor->timeout_floor_us = MONITOR_TIMEOUT_FLOOR_US;
+     _monitor->timeout_ceiling_us = MONITOR_TIMEOUT_CEILING_US;
+     _monitor->status = -1;
+     _monitor->raw_status = -1;
+     for (BYTE family = 0; family < NET_FAMILIES; family++) _monitor->family_status[(UBYTE)family] = -1;
+
+     _monitor->wheel = _wheel;
+     Wheel_Timer_Init(&_monitor->timer, Monitor_Expired, _monitor);
+     Wheel_Timer_Init(&_monitor->stagger, Monitor_Stagger, _monitor);
+}
+
+static void Monitor_Set_Deadline(struct Monitor *_monitor, TIME_US _deadline)
+{
+     _monitor->deadline = _deadline;
+     Wheel_Add(_monitor->wheel, &_monitor->timer, _deadline);
+}
+
+BYTE Monitor_Add_Target(struct Monitor *_monitor, ULONG _ip, UWORD _port)
+{
+     return Probe_Add_Target(&_monitor->probe, _ip, _port);
+}
+
+BYTE Monitor_Add_Parsed(struct Monitor *_monitor, const struct Probe_Target *_target)
+{
+     return Probe_Add_Parsed(&_monitor->probe, _target);
+}
+
+void Monitor_Set_Policy(struct Monitor *_monitor, BYTE _policy, LONG _quorum)
+{
+     Probe_Set_Policy(&_monitor->probe, _policy, _quorum);
+}
+
+void Monitor_Set_Damping(struct Monitor *_monitor, LONG _failures, LONG _window, LONG _successes)
+{
+     Damp_Init(&_monitor->damp, _failures, _window, _successes);
+}
+
+void Monitor_Set_Diag(struct Monitor *_monitor, struct Diag *_diag)
+{
+     if (_monitor->diag) Diag_Stop(_monitor->diag);
+
+     _monitor->diag = _diag;
+}
+
+void Monitor_Set_Burst(struct Monitor *_monitor, struct Burst *_burst)
+{
+     if (_monitor->burst) Burst_Stop(_monitor->burst);
+
+     _monitor->burst = _burst;
+}
+
+void Monitor_Set_Timeout(struct Monitor *_monitor, ULONG _fixed_us, ULONG _floor_us, ULONG _ceiling_us)
+{
+     _monitor->timeout_fixed_us = _fixed_us;
+     _monitor->timeout_floor_us = _floor_us ? _floor_us : MONITOR_TIMEOUT_FLOOR_US;
+     _monitor->timeout_ceiling_us = _ceiling_us ? _ceiling_us : MONITOR_TIMEOUT_CEILING_US;
+
+     if (_monitor->timeout_ceiling_us < _monitor->timeout_floor_us) _monitor->timeout_ceiling_us = _monitor->timeout_floor_us;
+}
+
+ULONG Monitor_Timeout(struct Monitor *_monitor)
+{
+     if (_monitor->timeout_fixed_us) return _monitor->timeout_fixed_us;
+
+     ULONG timeout = Rtt_Timeout(&_monitor->rtt);
+     if (timeout == 0) timeout = MONITOR_TIMEOUT_INITIAL_US;
+
+     if (timeout < _monitor->timeout_floor_us) timeout = _monitor->timeout_floor_us;
+
+     // An answer slower than the timeout never becomes a sample, so
+     // without the backoff a link that got slower would stay offline.
+     for (UBYTE i = 0; i < _monitor->timeout_backoff && timeout < _monitor->timeout_ceiling_us; i++) timeout *= 2;
+
+     if (timeout > _monitor->timeout_ceiling_us) timeout = _monitor->timeout_ceiling_us;
+
+     return timeout;
+}
+
+void Monitor_Start(struct Monitor *_monitor)
+{
+     Monitor_Stop(_monitor);
+     Sched_Reset(&_monitor->sched);
+     Damp_Reset(&_monitor->damp);
+
+     Monitor_Set_Deadline(_monitor, Platform_Time());
+}
+
+void Monitor_Stop(struct Monitor *_monitor)
+{
+     if (_monitor->probing) Probe_Finish(&_monitor->probe);
+     if (_monitor->diag) Diag_Stop(_monitor->diag);
+     if (_monitor->burst) Burst_Stop(_monitor->burst);
+
+     Wheel_Cancel(_monitor->wheel, &_monitor->timer);
+     Wheel_Cancel(_monitor->wheel, &_monitor->stagger);
+
+     _monitor->probing = 0;
+     _monitor->status = -1;
+     _monitor->raw_status = -1;
+     for (BYTE family = 0; family < NET_FAMILIES; family++) _monitor->family_status[(UBYTE)family] = -1;
+}
+
+LONG Monitor_Watch(struct Monitor *_monitor, struct Net_Watch *_watch, LONG _max)
+{
+     _monitor->probe_watch = 0;
+     _monitor->diag_watch = 0;
+
+     if (_monitor->probing)
+     {
+          _monitor->probe_watch = Probe_Watch(&_monitor->probe, _watch, _max);
+          if (_monitor->diag) _monitor->diag_watch = Diag_Watch(_monitor->diag, _watch + _monitor->probe_watch, _max - _monitor->probe_watch);
+     }
+
+     LONG count = _monitor->probe_watch + _monitor->diag_watch;
+
+     // Burst probes may still be out after the probe they started with.
+     if (_monitor->burst) count += Burst_Watch(_monitor->burst, _watch + count, _max - count);
+
+     return count;
+}
+
+TIME_US Monitor_Deadline(struct Monitor *_monitor)
+{
+     return _monitor->deadline;
+}
+
+static void Monitor_Probe_Done(struct Monitor *_monitor)
+{
+     struct Probe *probe = &_monitor->probe;
+     BYTE online = probe->result;
+
+     Probe_Finish(probe);
+     _monitor->probing = 0;
+     Wheel_Cancel(_monitor->wheel, &_monitor->stagger);
+
+     if (_monitor->diag) Diag_Finish(_monitor->diag, online);
+
+     // A family nothing was tried over keeps what it had.
+     for (BYTE family = 0; family < NET_FAMILIES; family++)
+     {
+          if (probe->family_answered[(UBYTE)family]) _monitor->family_status[(UBYTE)family] = 1;
+          else if (probe->family_failed[(UBYTE)family]) _monitor->family_status[(UBYTE)family] = 0;
+     }
+
+     if (online)
+     {
+          Rtt_Add(&_monitor->rtt, _monitor->probe.rtt);
+          _monitor->timeout_backoff = 0;
+     }
+
+     // The published status only follows the votes - a lone lost probe stays in the raw one.
+     _monitor->raw_status = online;
+     _monitor->status = Damp_Add(&_monitor->damp, online);
+     _monitor->probe_count++;
+     Stats_Count(online ? STATS_ONLINE : STATS_OFFLINE);
+     if (_monitor->status != online) Stats_Count(STATS_DAMPED);
+
+     // The scheduler sees the raw result - a change is confirmed soon, so the vote is quick.
+     _monitor->next_probe_ms = Sched_Next(&_monitor->sched, online);
+     Monitor_Set_Deadline(_monitor, Platform_Time() + (TIME_US)_monitor->next_probe_ms * 1000);
+
+     Platform_Publish(_monitor);
+}
+
+static void Monitor_Probe_Start(struct Monitor *_monitor)
+{
+     TIME_US start_time = Platform_Time();
+
+     Stats_Count(STATS_PROBES);
+
+     // Socket library session stays open between probes, only the first one
+     // and the one after the stack was lost pay for opening it.
+     if (!Net_Open())
+     {
+          struct Probe *probe = &_monitor->probe;
+
+          for (LONG i = 0; i < probe->target_count; i++) probe->target[i].status = IP_STATUS_NOT_USED;
+          for (BYTE family = 0; family < NET_FAMILIES; family++) probe->family_answered[(UBYTE)family] = probe->family_failed[(UBYTE)family] = 0;
+          probe->result = 0;
+
+          Monitor_Probe_Done(_monitor);
+          return;
+     }
+
+     // IPv4 of a dual-stack target must still get half the timeout.
+     _monitor->timeout_us = Monitor_Timeout(_monitor);
+     Probe_Set_Stagger(&_monitor->probe, _monitor->timeout_us / 2);
+
+     // Before the probe clears its targets - a sample goes over the family that answered the latest one.
+     if (_monitor->burst) Burst_Start(_monitor->burst, &_monitor->probe, _monitor->timeout_us);
+
+     Probe_Start(&_monitor->probe);
+
+     // Hops race the targets in the same wait - unless they answered already.
+     if (_monitor->diag && !_monitor->probe.result) Diag_Start(_monitor->diag);
+
+     _monitor->start_micro = (ULONG)(Platform_Time() - start_time);
+
+     // Answer known right away, or nothing could be started.
+     if (Monitor_Settled(_monitor))
+     {
+          Monitor_Probe_Done(_monitor);
+          return;
+     }
+
+     // Sockets are serviced by the backend loop, nothing blocks here.
+     _monitor->probing = 1;
+     Monitor_Set_Deadline(_monitor, start_time + _monitor->timeout_us);
+
+     TIME_US stagger = Probe_Stagger_Time(&_monitor->probe);
+     if (stagger) Wheel_Add(_monitor->wheel, &_monitor->stagger, stagger);
+}
+
+void Monitor_Service(struct Monitor *_monitor, struct Net_Watch *_watch, LONG _count)
+{
+     LONG count = _monitor->probe_watch + _monitor->diag_watch;
+
+     // First - a tick that ends now is in what the probe publishes.
+     if (_monitor->burst) Burst_Service(_monitor->burst, _watch + count, _count - count);
+
+     if (!_monitor->probing) return;
+
+     Probe_Service(&_monitor->probe, _watch, _monitor->probe_watch);
+     if (_monitor->diag) Diag_Service(_monitor->diag, _watch + _monitor->probe_watch, _monitor->diag_watch);
+
+     // Result known or nothing left to wait for - no need to wait for the timeout.
+     if (Monitor_Settled(_monitor)) Monitor_Probe_Done(_monitor);
+}
+
+void Monitor_Timer(struct Monitor *_monitor)
+{
+     // Too early - back on the wheel.
+     if (Platform_Time() + MONITOR_TIMER_SLACK_US < _monitor->deadline)
+     {
+          Wheel_Add(_monitor->wheel, &_monitor->timer, _monitor->deadline);
+          return;
+     }
+
+     // Probe timeout - whatever is still in flight has failed. The timeout backs off
+     // only when a target was still waiting, not for anything that outlived the result.
+     if (_monitor->probing)
+     {
+          struct Probe *probe = &_monitor->probe;
+
+          if (!probe->done && probe->in_flight && _monitor->timeout_backoff < MONITOR_TIMEOUT_BACKOFF_MAX) _monitor->timeout_backoff++;
+          Monitor_Probe_Done(_monitor);
+     }
+     else if (Probe_Resolving(&_monitor->probe))
+     {
+          // No address to probe yet - a result now would only say so.
+          Monitor_Set_Deadline(_monitor, Platform_Time() + MONITOR_RESOLVE_WAIT_US);
+     }
+     else Monitor_Probe_Start(_monitor);
+}
+
+void Monitor_Abort(struct Monitor *_monitor)
+{
+     if (_monitor->probing) Monitor_Probe_Done(_monitor);
+}
+
+LONG Monitor_Watch_All(struct Monitor **_monitors, LONG _count, struct Net_Watch *_watch, LONG _max, LONG *_slice)
+{
+     LONG total = 0;
+
+     for (LONG i = 0; i < _count; i++)
+     {
+          _slice[i] = Monitor_Watch(_monitors[i], _watch + total, _max - total);
+          total += _slice[i];
+     }
+
+     return total;
+}
+
+void Monitor_Service_All(struct Monitor **_monitors, LONG _count, struct Net_Watch *_watch, LONG *_slice)
+{
+     LONG offset = 0;
+
+     for (LONG i = 0; i < _count; i++)
+     {
+          if (_slice[i]) Monitor_Service(_monitors[i], _watch + offset, _slice[i]);
+          offset += _slice[i];
+     }
+}
@@ -0,0 +1,136 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - monitor core
+ *
+ * The platform neutral part of the program: starts a probe
+ * when it is due, times it out, feeds the result to the RTT
+ * window and the scheduler, damps flapping and hands the
+ * status over to the backend.
+ *
+ * A backend (Amiga commodity, POSIX daemon) only waits for
+ * the sockets listed by Monitor_Watch() until Wheel_Next()
+ * of the wheel the monitors are on, then calls
+ * Monitor_Service() and Wheel_Advance(). It provides
+ * Platform_Time() and Platform_Publish().
+ *
+ * Several monitors can share one loop, one wheel and one
+ * timer - the *_All() functions put sockets of all of them
+ * into one Net_Wait() set.
+ *
+ * With a path diagnosis set, its hops are probed along with
+ * the targets and a failed probe waits for them, so the
+ * verdict comes with the result. Burst probes for the loss
+ * start with each probe as well, but run on by themselves -
+ * the status is never held back for them.
+ * ---------------------------------------------------------*/
+
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include "platform.h"
+#include "burst.h"
+#include "damp.h"
+#include "diag.h"
+#include "probe.h"
+#include "rtt.h"
+#include "sched.h"
+#include "wheel.h"
+
+// Adaptive probe timeout - SRTT + 4 * RTTVAR, clamped to the floor and
+// ceiling, doubled after every probe that timed out (as TCP backs off its
+// RTO) and back to normal with the first answer.
+#define MONITOR_TIMEOUT_FLOOR_US      250000
+#define MONITOR_TIMEOUT_CEILING_US    5000000
+#define MONITOR_TIMEOUT_INITIAL_US    1000000    // No RTT sample yet.
+#define MONITOR_TIMEOUT_BACKOFF_MAX   4
+
+// How often a probe held back for the first lookup of a host name looks again.
+// The lookup gives up by itself after RESOLVE_ATTEMPTS queries.
+#define MONITOR_RESOLVE_WAIT_US       100000
+
+// Watch entries of a monitor - its targets, the hops of a diagnosis and the burst probes.
+#define MONITOR_MAX_WATCH             (PROBE_MAX_TARGETS * NET_FAMILIES + DIAG_MAX_WATCH + BURST_MAX_PROBES)
+
+struct Monitor
+{
+     struct Probe       probe;
+     struct Rtt_Window  rtt;
+     struct Sched       sched;
+     struct Damp        damp;
+     struct Diag       *diag;       // Path diagnosis along with every probe, NULL - none.
+     struct Burst      *burst;      // Loss sampling along with every probe, NULL - none.
+
+     ULONG   timeout_fixed_us;  // TCP_TIMEOUT override, 0 - adaptive.
+     ULONG   timeout_floor_us;
+     ULONG   timeout_ceiling_us;
+     UBYTE   timeout_backoff;   // Probes in a row that timed out, up to MONITOR_TIMEOUT_BACKOFF_MAX.
+     ULONG   timeout_us;        // Timeout of the latest probe.
+
+     BYTE    probing;           // Probe in flight.
+     BYTE    status;            // Published status, damped: -1 unknown, 0 offline, 1 online.
+     BYTE    raw_status;        // Result of the latest probe as it came, same values.
+     BYTE    family_status[NET_FAMILIES];   // Same per address family, kept while a probe did not try it.
+     TIME_US deadline;          // Next probe or, while probing, its timeout.
+     struct Wheel       *wheel;
+     struct Wheel_Timer  timer; // Scheduled for the deadline while started.
+     struct Wheel_Timer  stagger;    // Next IPv4 attempt of a dual-stack target while probing.
+     ULONG   next_probe_ms;     // Interval picked after the latest result.
+     LONG    probe_watch;       // Watch entries of the targets,
+     LONG    diag_watch;        // of the diagnosis hops after them, and the burst probes after those.
+
+     ULONG   probe_count;       // Finished probes.
+     ULONG   start_micro;       // What starting the latest probe cost.
+
+     APTR    user;              // Backend data, not touched by the core.
+};
+
+void Monitor_Init(struct Monitor *_monitor, ULONG _interval_ms, ULONG _interval_max_ms, ULONG _confirm_ms, LONG _jitter_percent, struct Wheel *_wheel);
+BYTE Monitor_Add_Target(struct Monitor *_monitor, ULONG _ip, UWORD _port);
+BYTE Monitor_Add_Parsed(struct Monitor *_monitor, const struct Probe_Target *_target);
+void Monitor_Set_Policy(struct Monitor *_monitor, BYTE _policy, LONG _quorum);
+
+// Offline after _failures failed probes of the last _window, online again after
+// _successes answered ones in a row. 1, 1, 1 (the default) publishes every result.
+void Monitor_Set_Damping(struct Monitor *_monitor, LONG _failures, LONG _window, LONG _successes);
+
+// Probes the hops of _diag with every probe, NULL turns it off. The
+// backend keeps the Diag and its hop targets.
+void Monitor_Set_Diag(struct Monitor *_monitor, struct Diag *_diag);
+
+// Samples loss with _burst along with every probe, NULL turns it off. The
+// backend keeps the Burst.
+void Monitor_Set_Burst(struct Monitor *_monitor, struct Burst *_burst);
+
+// Fixed timeout, or 0 to derive it from the RTT within floor..ceiling. Zero floor or
+// ceiling keeps the MONITOR_TIMEOUT_* default.
+void Monitor_Set_Timeout(struct Monitor *_monitor, ULONG _fixed_us, ULONG _floor_us, ULONG _ceiling_us);
+
+// Timeout the next probe would get.
+ULONG Monitor_Timeout(struct Monitor *_monitor);
+
+// Forgets the history and makes the first probe due right now.
+void Monitor_Start(struct Monitor *_monitor);
+
+// Drops the probe in flight, if any, and takes the monitor off the wheel. Status becomes unknown.
+void Monitor_Stop(struct Monitor *_monitor);
+
+// Sockets to wait for, and until when.
+LONG    Monitor_Watch(struct Monitor *_monitor, struct Net_Watch *_watch, LONG _max);
+TIME_US Monitor_Deadline(struct Monitor *_monitor);
+
+// Readiness reported by Net_Wait() for the entries filled by Monitor_Watch().
+void Monitor_Service(struct Monitor *_monitor, struct Net_Watch *_watch, LONG _count);
+
+// Called by the wheel when the deadline has passed - starts the probe or times it out.
+void Monitor_Timer(struct Monitor *_monitor);
+
+// Ends the probe in flight right now, for example when waiting for its sockets failed.
+void Monitor_Abort(struct Monitor *_monitor);
+
+// Same for a group of monitors. _slice gets the number of watch entries of each one.
+LONG Monitor_Watch_All(struct Monitor **_monitors, LONG _count, struct Net_Watch *_watch, LONG _max, LONG *_slice);
+void Monitor_Service_All(struct Monitor **_monitors, LONG _count, struct Net_Watch *_watch, LONG *_slice);
+
+// Provided by the backend - called after every finished probe.
+void Platform_Publish(struct Monitor *_monitor);
+
+#endif
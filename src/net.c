@@ -0,0 +1,547 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - socket layer
+ *
+ * Amiga build talks to bsdsocket.library, opened once by
+ * Net_Open() and kept open, POSIX build uses plain BSD sockets
+ * and poll().
+ * ---------------------------------------------------------*/
+
+#include "net.h"
+
+// Before anything includes sys/types.h - its fd_set holds 64 descriptors unless told otherwise.
+#ifdef PLATFORM_AMIGA
+     #define FD_SETSIZE  NET_MAX_WATCH
+#endif
+
+#include "stats.h"
+
+#include <string.h>
+
+#ifdef PLATFORM_AMIGA
+     #include <proto/exec.h>
+     #include <sys/socket.h>
+     #include <proto/socket.h>
+     #include <amitcp/socketbasetags.h>
+     #include <netinet/in.h>
+     #include <netinet/tcp.h>
+     #include <sys/ioctl.h>
+     #include <errno.h>
+#else
+     #include <sys/socket.h>
+     #include <netinet/in.h>
+     #include <fcntl.h>
+     #include <poll.h>
+     #include <unistd.h>
+     #include <errno.h>
+#endif
+
+#if defined(PLATFORM_AMIGA) && FD_SETSIZE < NET_MAX_WATCH
+     #error "fd_set is smaller than the socket table, FD_SETSIZE must be at least NET_MAX_WATCH."
+#endif
+
+#if defined(PLATFORM_POSIX) && !defined(NET_IPV6)
+     #define NET_IPV6    1
+#endif
+
+#ifdef PLATFORM_AMIGA
+struct Library*     SocketBase     = NULL;
+#endif
+
+static BYTE  net_open       = 0;
+static BYTE  net_lost       = 0;
+static BYTE  net_ipv6       = 0;
+static ULONG net_open_count = 0;
+
+BYTE Net_Open(void)
+{
+     if (net_open) return 1;
+
+#ifdef PLATFORM_AMIGA
+     SocketBase = (struct Library*)OpenLibrary("bsdsocket.library", NET_BSDSOCKET_LIB_VERSION);
+     if (SocketBase == NULL)
+          return 0;
+
+     // AmiTCP compatible stacks give an opener 64 descriptors - fewer than the sockets we may watch at once.
+     // No break mask - Ctrl-C would end WaitSelect() with EINTR and be used up, it is one of our signals instead.
+     SocketBaseTags(SBTM_SETVAL(SBTC_DTABLESIZE), NET_MAX_WATCH, SBTM_SETVAL(SBTC_BREAKMASK), 0, TAG_END);
+#endif
+
+     net_open = 1;
+     net_lost = 0;
+     net_open_count++;
+
+     // A stack without IPv6 fails socket() - better once here than on every probe.
+     net_ipv6 = 0;
+#ifdef NET_IPV6
+     LONG test_socket = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+     if (test_socket != -1)
+     {
+          net_ipv6 = 1;
+          Net_Close_Socket(test_socket);
+     }
+#endif
+
+     return 1;
+}
+
+void Net_Close(void)
+{
+     if (!net_open) return;
+
+#ifdef PLATFORM_AMIGA
+     // Closing lets the stack be shut down or restarted - it can't be expunged while we hold it.
+     CloseLibrary(SocketBase);
+     SocketBase = NULL;
+#endif
+
+     net_open = 0;
+     net_lost = 0;
+}
+
+BYTE Net_Lost(void)
+{
+     return net_lost;
+}
+
+ULONG Net_Open_Count(void)
+{
+     return net_open_count;
+}
+
+BYTE Net_Is_Open(void)
+{
+     return net_open;
+}
+
+BYTE Net_Ipv6(void)
+{
+     return net_ipv6;
+}
+
+static BYTE Net_Set_Non_Blocking(LONG _socket)
+{
+#ifdef PLATFORM_AMIGA
+     LONG mode = 1;
+     return IoctlSocket(_socket, FIONBIO, (char*)&mode) != -1;
+#else
+     LONG flags = fcntl(_socket, F_GETFL, 0);
+     if (flags == -1) return 0;
+     return fcntl(_socket, F_SETFL, flags | O_NONBLOCK) != -1;
+#endif
+}
+
+static LONG Net_Errno(void)
+{
+#ifdef PLATFORM_AMIGA
+     return Errno();
+#else
+     return errno;
+#endif
+}
+
+// socket() failed. Out of descriptors or buffers is a busy moment of ours, and a family
+// the stack doesn't have is no news either - anything else means the stack is gone or going.
+static void Net_Socket_Failed(void)
+{
+     switch (Net_Errno())
+     {
+          case EMFILE:
+          case ENFILE:
+          case ENOBUFS:
+          case ENOMEM:
+          case EAFNOSUPPORT:
+          case EPROTONOSUPPORT:
+               return;
+
+          default:
+               net_lost = 1;
+     }
+}
+
+static BYTE Net_Connect_Error_State(LONG _error)
+{
+     switch (_error)
+     {
+          case 0:
+               return NET_CONNECT_DONE;
+
+          case EINPROGRESS:
+          case EALREADY:
+          case EWOULDBLOCK:
+               return NET_CONNECT_PENDING;
+
+          case ECONNREFUSED:
+          case ECONNRESET:
+               return NET_CONNECT_REFUSED;
+
+          case ENETUNREACH:
+          case EHOSTUNREACH:
+          case ENETDOWN:
+          case EHOSTDOWN:
+               return NET_CONNECT_UNREACHABLE;
+
+          case ETIMEDOUT:
+               return NET_CONNECT_TIMEOUT;
+
+          default:
+               return NET_CONNECT_FAILED;
+     }
+}
+
+// Non-blocking socket of given type connecting to the address.
+static LONG Net_Connect_Start(LONG _domain, LONG _type, LONG _protocol, struct sockaddr *_address, LONG _length, BYTE *_state)
+{
+     *_state = NET_CONNECT_FAILED;
+
+     // Try open a socket.
+     TIME_US start = Platform_Time();
+     LONG my_socket = socket(_domain, _type, _protocol);
+     Stats_Time(STATS_SOCKET, start);
+
+     if (my_socket == -1)
+     {
+          Net_Socket_Failed();
+          return NET_NO_SOCKET;
+     }
+
+     // Try set socket to non-blocking mode.
+     start = Platform_Time();
+     BYTE non_blocking = Net_Set_Non_Blocking(my_socket);
+     Stats_Time(STATS_IOCTL, start);
+
+     if (!non_blocking)
+     {
+          Net_Close_Socket(my_socket);
+          return NET_NO_SOCKET;
+     }
+
+     // Non-blocking connect - normally still in progress here and picked up later by Net_Wait().
+     start = Platform_Time();
+     LONG rc = connect(my_socket, _address, _length);
+     Stats_Time(STATS_CONNECT, start);
+
+     if (rc == 0)
+          *_state = NET_CONNECT_DONE;
+     else
+          *_state = Net_Connect_Error_State(Net_Errno());
+
+     return my_socket;
+}
+
+static LONG Net_Connect_Start4(LONG _type, LONG _protocol, ULONG _ip, UWORD _port, BYTE *_state)
+{
+     // Create IP adress structure.
+     struct sockaddr_in ip_addr;
+     memset(&ip_addr, 0, sizeof(struct sockaddr_in));
+
+     ip_addr.sin_family = AF_INET;
+     ip_addr.sin_addr.s_addr = _ip;
+     ip_addr.sin_port = htons(_port);
+
+     return Net_Connect_Start(AF_INET, _type, _protocol, (struct sockaddr*)&ip_addr, sizeof(ip_addr), _state);
+}
+
+static LONG Net_Connect_Start6(LONG _type, LONG _protocol, const UBYTE *_ip6, UWORD _port, BYTE *_state)
+{
+#ifdef NET_IPV6
+     struct sockaddr_in6 ip_addr;
+     memset(&ip_addr, 0, sizeof(struct sockaddr_in6));
+
+     ip_addr.sin6_family = AF_INET6;
+     memcpy(&ip_addr.sin6_addr, _ip6, 16);
+     ip_addr.sin6_port = htons(_port);
+
+     return Net_Connect_Start(AF_INET6, _type, _protocol, (struct sockaddr*)&ip_addr, sizeof(ip_addr), _state);
+#else
+     (void)_type; (void)_protocol; (void)_ip6; (void)_port;
+
+     *_state = NET_CONNECT_FAILED;
+     return NET_NO_SOCKET;
+#endif
+}
+
+LONG Net_Tcp_Connect_Start(ULONG _ip, UWORD _port, BYTE *_state)
+{
+     return Net_Connect_Start4(SOCK_STREAM, IPPROTO_TCP, _ip, _port, _state);
+}
+
+LONG Net_Tcp_Connect_Start6(const UBYTE *_ip6, UWORD _port, BYTE *_state)
+{
+     return Net_Connect_Start6(SOCK_STREAM, IPPROTO_TCP, _ip6, _port, _state);
+}
+
+BYTE Net_Tcp_Connect_State(LONG _socket, UBYTE _ready)
+{
+     LONG error = 0;
+
+#ifdef PLATFORM_AMIGA
+     LONG error_len = sizeof(error);
+#else
+     socklen_t error_len = sizeof(error);
+#endif
+
+     // Readiness alone says nothing - a refused connect is "ready" as well.
+     if (getsockopt(_socket, SOL_SOCKET, SO_ERROR, &error, &error_len) == -1)
+          return NET_CONNECT_FAILED;
+
+     // No error yet, but not writable either - the handshake is still going on.
+     if (error == 0 && !(_ready & NET_EVENT_WRITE))
+          return NET_CONNECT_PENDING;
+
+     return Net_Connect_Error_State(error);
+}
+
+LONG Net_Udp_Open(ULONG _ip, UWORD _port, BYTE *_state)
+{
+     // connect() on UDP only sets the peer - nothing goes out yet.
+     return Net_Connect_Start4(SOCK_DGRAM, IPPROTO_UDP, _ip, _port, _state);
+}
+
+LONG Net_Udp_Open6(const UBYTE *_ip6, UWORD _port, BYTE *_state)
+{
+     return Net_Connect_Start6(SOCK_DGRAM, IPPROTO_UDP, _ip6, _port, _state);
+}
+
+LONG Net_Udp_Bind(UWORD _port)
+{
+     LONG my_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+     if (my_socket == -1)
+     {
+          Net_Socket_Failed();
+          return NET_NO_SOCKET;
+     }
+
+     // Several copies on one host (or a test on loopback) bind the same port.
+     LONG on = 1;
+     setsockopt(my_socket, SOL_SOCKET, SO_REUSEADDR, (void*)&on, sizeof(on));
+#ifdef SO_REUSEPORT
+     setsockopt(my_socket, SOL_SOCKET, SO_REUSEPORT, (void*)&on, sizeof(on));
+#endif
+     setsockopt(my_socket, SOL_SOCKET, SO_BROADCAST, (void*)&on, sizeof(on));
+
+     struct sockaddr_in ip_addr;
+     memset(&ip_addr, 0, sizeof(struct sockaddr_in));
+
+     ip_addr.sin_family = AF_INET;
+     ip_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+     ip_addr.sin_port = htons(_port);
+
+     if (!Net_Set_Non_Blocking(my_socket) || bind(my_socket, (struct sockaddr*)&ip_addr, sizeof(ip_addr)) == -1)
+     {
+          Net_Close_Socket(my_socket);
+          return NET_NO_SOCKET;
+     }
+
+     return my_socket;
+}
+
+LONG Net_Tcp_Listen(ULONG _ip, UWORD _port)
+{
+     LONG my_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+     if (my_socket == -1)
+     {
+          Net_Socket_Failed();
+          return NET_NO_SOCKET;
+     }
+
+     // Restarted right away - the old connections may still be in TIME_WAIT.
+     LONG on = 1;
+     setsockopt(my_socket, SOL_SOCKET, SO_REUSEADDR, (void*)&on, sizeof(on));
+
+     struct sockaddr_in ip_addr;
+     memset(&ip_addr, 0, sizeof(struct sockaddr_in));
+
+     ip_addr.sin_family = AF_INET;
+     ip_addr.sin_addr.s_addr = _ip;
+     ip_addr.sin_port = htons(_port);
+
+     if (!Net_Set_Non_Blocking(my_socket) || bind(my_socket, (struct sockaddr*)&ip_addr, sizeof(ip_addr)) == -1 || listen(my_socket, 5) == -1)
+     {
+          Net_Close_Socket(my_socket);
+          return NET_NO_SOCKET;
+     }
+
+     return my_socket;
+}
+
+LONG Net_Tcp_Accept(LONG _socket, ULONG *_ip)
+{
+     struct sockaddr_in ip_addr;
+
+#ifdef PLATFORM_AMIGA
+     LONG ip_addr_len = sizeof(ip_addr);
+#else
+     socklen_t ip_addr_len = sizeof(ip_addr);
+#endif
+
+     memset(&ip_addr, 0, sizeof(struct sockaddr_in));
+
+     LONG my_socket = accept(_socket, (struct sockaddr*)&ip_addr, &ip_addr_len);
+     if (my_socket == -1) return NET_NO_SOCKET;
+
+     if (!Net_Set_Non_Blocking(my_socket))
+     {
+          Net_Close_Socket(my_socket);
+          return NET_NO_SOCKET;
+     }
+
+     *_ip = ip_addr.sin_addr.s_addr;
+     return my_socket;
+}
+
+LONG Net_Send_To(LONG _socket, ULONG _ip, UWORD _port, const void *_data, LONG _length, BYTE *_state)
+{
+     struct sockaddr_in ip_addr;
+     memset(&ip_addr, 0, sizeof(struct sockaddr_in));
+
+     ip_addr.sin_family = AF_INET;
+     ip_addr.sin_addr.s_addr = _ip;
+     ip_addr.sin_port = htons(_port);
+
+     LONG rc = sendto(_socket, (void*)_data, _length, 0, (struct sockaddr*)&ip_addr, sizeof(ip_addr));
+
+     if (rc < 0) *_state = Net_Connect_Error_State(Net_Errno());
+     return rc;
+}
+
+LONG Net_Receive_From(LONG _socket, void *_buffer, LONG _size, ULONG *_ip, BYTE *_state)
+{
+     struct sockaddr_in ip_addr;
+
+#ifdef PLATFORM_AMIGA
+     LONG ip_addr_len = sizeof(ip_addr);
+#else
+     socklen_t ip_addr_len = sizeof(ip_addr);
+#endif
+
+     memset(&ip_addr, 0, sizeof(struct sockaddr_in));
+
+     LONG rc = recvfrom(_socket, _buffer, _size, 0, (struct sockaddr*)&ip_addr, &ip_addr_len);
+
+     if (rc < 0) *_state = Net_Connect_Error_State(Net_Errno());
+     else        *_ip = ip_addr.sin_addr.s_addr;
+
+     return rc;
+}
+
+LONG Net_Send(LONG _socket, const void *_data, LONG _length, BYTE *_state)
+{
+     LONG rc = send(_socket, (void*)_data, _length, 0);
+
+     if (rc < 0) *_state = Net_Connect_Error_State(Net_Errno());
+     return rc;
+}
+
+LONG Net_Receive(LONG _socket, void *_buffer, LONG _size, BYTE *_state)
+{
+     LONG rc = recv(_socket, _buffer, _size, 0);
+
+     if (rc < 0) *_state = Net_Connect_Error_State(Net_Errno());
+     return rc;
+}
+
+void Net_Close_Socket(LONG _socket)
+{
+     if (_socket == NET_NO_SOCKET) return;
+
+#ifdef PLATFORM_AMIGA
+     CloseSocket(_socket);
+#else
+     close(_socket);
+#endif
+}
+
+#ifdef PLATFORM_AMIGA
+
+LONG Net_Wait(struct Net_Watch *_watch, LONG _count, LONG _sec, LONG _micro, ULONG *_signals)
+{
+     fd_set reading, writing, except;
+
+     FD_ZERO(&reading);
+     FD_ZERO(&writing);
+     FD_ZERO(&except);
+
+     // WaitSelect() wants the highest socket number + 1, not the count.
+     LONG max_sock = -1;
+
+     for (LONG i = 0; i < _count; i++)
+     {
+          _watch[i].ready = 0;
+
+          // Past the end of the fd_set - never handed out with the table at NET_MAX_WATCH.
+          if (_watch[i].socket == NET_NO_SOCKET || _watch[i].socket >= FD_SETSIZE) continue;
+
+          if (_watch[i].want & NET_EVENT_READ)  FD_SET(_watch[i].socket, &reading);
+          if (_watch[i].want & NET_EVENT_WRITE) FD_SET(_watch[i].socket, &writing);
+          FD_SET(_watch[i].socket, &except);
+
+          if (_watch[i].socket > max_sock) max_sock = _watch[i].socket;
+     }
+
+     struct timeval timeout;
+     timeout.tv_sec = _sec;
+     timeout.tv_usec = _micro;
+
+     LONG rc = WaitSelect(max_sock + 1, &reading, &writing, &except, _sec < 0 ? NULL : &timeout, _signals);
+
+     if (rc > 0)
+     {
+          for (LONG i = 0; i < _count; i++)
+          {
+               if (_watch[i].socket == NET_NO_SOCKET || _watch[i].socket >= FD_SETSIZE) continue;
+
+               if (FD_ISSET(_watch[i].socket, &reading)) _watch[i].ready |= NET_EVENT_READ;
+               if (FD_ISSET(_watch[i].socket, &writing)) _watch[i].ready |= NET_EVENT_WRITE;
+               if (FD_ISSET(_watch[i].socket, &except))  _watch[i].ready |= NET_EVENT_ERROR;
+          }
+     }
+
+     return rc;
+}
+
+#else
+
+LONG Net_Wait(struct Net_Watch *_watch, LONG _count, LONG _sec, LONG _micro, ULONG *_signals)
+{
+     struct pollfd poll_list[NET_MAX_WATCH];
+
+     if (_count > NET_MAX_WATCH) _count = NET_MAX_WATCH;
+
+     for (LONG i = 0; i < _count; i++)
+     {
+          _watch[i].ready = 0;
+
+          // poll() skips negative descriptors, same as NET_NO_SOCKET.
+          poll_list[i].fd = _watch[i].socket;
+          poll_list[i].events = 0;
+          poll_list[i].revents = 0;
+
+          if (_watch[i].want & NET_EVENT_READ)  poll_list[i].events |= POLLIN;
+          if (_watch[i].want & NET_EVENT_WRITE) poll_list[i].events |= POLLOUT;
+     }
+
+     // There are no Exec signals here.
+     if (_signals) *_signals = 0;
+
+     // Round up, so a short timeout never turns into busy polling.
+     LONG timeout_ms = -1;
+     if (_sec >= 0) timeout_ms = _sec * 1000 + (_micro + 999) / 1000;
+
+     LONG rc = poll(poll_list, _count, timeout_ms);
+
+     if (rc > 0)
+     {
+          for (LONG i = 0; i < _count; i++)
+          {
+               if (poll_list[i].revents & POLLIN)                           _watch[i].ready |= NET_EVENT_READ;
+               if (poll_list[i].revents & POLLOUT)                          _watch[i].ready |= NET_EVENT_WRITE;
+               if (poll_list[i].revents & (POLLERR | POLLHUP | POLLNVAL))   _watch[i].ready |= NET_EVENT_ERROR;
+          }
+     }
+
+     return rc;
+}
+
+#endif
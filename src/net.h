@@ -0,0 +1,150 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - socket layer
+ *
+ * Thin wrapper over bsdsocket.library (Amiga) or BSD sockets
+ * (POSIX). Everything above this layer only sees socket
+ * numbers and Net_Watch lists.
+ *
+ * IPv6 is always built on POSIX. On Amiga it needs an SDK
+ * with sockaddr_in6 - build with -DNET_IPV6 - and a stack
+ * that opens AF_INET6 sockets, otherwise Net_Ipv6() is 0.
+ * ---------------------------------------------------------*/
+
+#ifndef NET_H
+#define NET_H
+
+#include "platform.h"
+
+// Setting bsdsocket version to 3, if 4 some TCP/IP stacks like EasyNet wont work.
+#define NET_BSDSOCKET_LIB_VERSION     3
+
+// Socket number used for "no socket".
+#define NET_NO_SOCKET       -1
+
+// What we wait for on a socket (want) and what happened (ready).
+#define NET_EVENT_READ      1
+#define NET_EVENT_WRITE     2
+#define NET_EVENT_ERROR     4
+
+// Address families, also used as index.
+#define NET_FAMILY_V4       0
+#define NET_FAMILY_V6       1
+#define NET_FAMILIES        2
+
+// Upper limit of sockets waited for at once, also the size of the socket
+// table on Amiga. The backends size their watch arrays from the real maxima
+// of the modules and refuse to build when those do not fit in here.
+#ifdef PLATFORM_POSIX
+     #define NET_MAX_WATCH  1024
+#else
+     #define NET_MAX_WATCH  192
+#endif
+
+struct Net_Watch
+{
+     LONG  socket;
+     UBYTE want;
+     UBYTE ready;
+};
+
+// Opens the socket library session if it is not open yet. The session is kept
+// for the whole program life. Returns 1 if sockets can be used.
+BYTE Net_Open(void);
+void Net_Close(void);
+
+// Returns 1 if socket() failed since Net_Open() - the TCP/IP stack is probably
+// shut down or restarting, so the session should be closed and opened again.
+// Only the backend does that, once every user has closed its sockets.
+BYTE Net_Lost(void);
+
+// Number of times the session was opened (1 unless the stack was restarted).
+ULONG Net_Open_Count(void);
+
+// Returns 1 while the session is open - sockets of a closed one are gone.
+BYTE Net_Is_Open(void);
+
+// Returns 1 if the stack opens IPv6 sockets - checked when the session is opened.
+BYTE Net_Ipv6(void);
+
+// Parses dotted IPv4 address into network byte order. Returns 0 if not valid.
+BYTE Net_Parse_Ip(const char *_text, ULONG *_ip);
+
+// Parses port number 1..65535. Returns 0 if not valid.
+BYTE Net_Parse_Port(const char *_text, UWORD *_port);
+
+// Parses "ip[:port]" - *_port is left as it is if no port is given. Returns 0 if not valid.
+BYTE Net_Parse_Target(const char *_text, ULONG *_ip, UWORD *_port);
+
+// Formats IP (network order) as dotted text. The buffer should have room for 16 chars.
+void Net_Format_Ip(ULONG _ip, char *_buffer);
+
+// Parses IPv6 address text ("2001:db8::1", "::ffff:1.2.3.4") into 16 bytes in network order.
+// Returns 0 if not valid.
+BYTE Net_Parse_Ip6(const char *_text, UBYTE *_ip6);
+
+// Parses "[ip6]:port", "[ip6]" or a bare "ip6" - *_port is left as it is if no port is given.
+BYTE Net_Parse_Target6(const char *_text, UBYTE *_ip6, UWORD *_port);
+
+// Formats IPv6 address with the longest run of zeros shortened. Room for 40 chars.
+void Net_Format_Ip6(const UBYTE *_ip6, char *_buffer);
+
+// What happened to a connect.
+#define NET_CONNECT_PENDING       0    // Still in progress.
+#define NET_CONNECT_DONE          1    // Handshake completed.
+#define NET_CONNECT_REFUSED       2    // RST from the host - it is reachable.
+#define NET_CONNECT_UNREACHABLE   3    // No route, network or host down.
+#define NET_CONNECT_TIMEOUT       4    // Stack gave up waiting.
+#define NET_CONNECT_FAILED        5    // Any other error.
+
+// Creates non-blocking TCP socket and starts connecting it to given IP (network order) and port.
+// Returns the socket or NET_NO_SOCKET. *_state gets NET_CONNECT_PENDING or, if connect()
+// already knows the answer (common on loopback), its final state.
+LONG Net_Tcp_Connect_Start(ULONG _ip, UWORD _port, BYTE *_state);
+
+// Same for IPv6 address (16 bytes, network order).
+LONG Net_Tcp_Connect_Start6(const UBYTE *_ip6, UWORD _port, BYTE *_state);
+
+// Reads the outcome of a connect from SO_ERROR, after Net_Wait() reported the socket ready.
+BYTE Net_Tcp_Connect_State(LONG _socket, UBYTE _ready);
+
+// Creates non-blocking UDP socket connected to given IP and port, so only its answers
+// and ICMP errors come back. Returns the socket or NET_NO_SOCKET, *_state as above.
+LONG Net_Udp_Open(ULONG _ip, UWORD _port, BYTE *_state);
+LONG Net_Udp_Open6(const UBYTE *_ip6, UWORD _port, BYTE *_state);
+
+// Creates non-blocking UDP socket bound to the port on all interfaces, allowed to send
+// broadcasts. Other programs that bind the port the same way share it - each of them gets
+// every broadcast. Returns the socket or NET_NO_SOCKET.
+LONG Net_Udp_Bind(UWORD _port);
+
+// Creates non-blocking TCP socket listening on IP (network order, 0 - all interfaces)
+// and port. Returns the socket or NET_NO_SOCKET.
+LONG Net_Tcp_Listen(ULONG _ip, UWORD _port);
+
+// Takes a waiting connection of a listening socket, made non-blocking. *_ip gets the
+// address of the other side. Returns NET_NO_SOCKET if there is none.
+LONG Net_Tcp_Accept(LONG _socket, ULONG *_ip);
+
+// Sends a datagram to IP (network order) and port over a socket from Net_Udp_Bind().
+// Returns number of bytes sent, or -1 with *_state set.
+LONG Net_Send_To(LONG _socket, ULONG _ip, UWORD _port, const void *_data, LONG _length, BYTE *_state);
+
+// Same as Net_Receive(), *_ip gets the address of the sender (network order).
+LONG Net_Receive_From(LONG _socket, void *_buffer, LONG _size, ULONG *_ip, BYTE *_state);
+
+// Returns number of bytes sent, or -1 with *_state set to what went wrong.
+LONG Net_Send(LONG _socket, const void *_data, LONG _length, BYTE *_state);
+
+// Returns number of bytes received, 0 if the other side closed the connection, or -1 with
+// *_state set - NET_CONNECT_PENDING if there is nothing yet. ICMP port unreachable on UDP
+// shows up as NET_CONNECT_REFUSED.
+LONG Net_Receive(LONG _socket, void *_buffer, LONG _size, BYTE *_state);
+
+void Net_Close_Socket(LONG _socket);
+
+// Waits until any watched socket is ready, timeout passes (_sec < 0 means no timeout)
+// or - on Amiga - one of the signals in *_signals arrives (WaitSelect() semantics).
+// Returns number of ready sockets, 0 on timeout/signal, -1 on error.
+LONG Net_Wait(struct Net_Watch *_watch, LONG _count, LONG _sec, LONG _micro, ULONG *_signals);
+
+#endif
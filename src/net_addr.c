@@ -0,0 +1,230 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - address text
+ *
+ * Parsing and formatting of IPv4 and IPv6 addresses - the
+ * Amiga bsdsocket.library has no inet_pton(). Kept apart from
+ * the sockets so the benchmark can use it with its simulated
+ * network.
+ * ---------------------------------------------------------*/
+
+#include "net.h"
+
+#include <stdio.h>
+#include <string.h>
+
+BYTE Net_Parse_Ip(const char *_text, ULONG *_ip)
+{
+     UBYTE bytes[4];
+
+     for (LONG part = 0; part < 4; part++)
+     {
+          LONG value = 0, digits = 0;
+
+          while (*_text >= '0' && *_text <= '9' && digits < 4)
+          {
+               value = value * 10 + (*_text++ - '0');
+               digits++;
+          }
+
+          if (digits == 0 || digits > 3 || value > 255) return 0;
+          bytes[part] = value;
+
+          if (part < 3 && *_text++ != '.') return 0;
+     }
+
+     if (*_text) return 0;
+
+     // Network byte order is the order of bytes in memory.
+     memcpy(_ip, bytes, 4);
+     return 1;
+}
+
+BYTE Net_Parse_Port(const char *_text, UWORD *_port)
+{
+     LONG port = 0;
+
+     if (*_text == 0) return 0;
+
+     // 1..65535, digits only.
+     for (; *_text; _text++)
+     {
+          if (*_text < '0' || *_text > '9') return 0;
+          port = port * 10 + (*_text - '0');
+          if (port > 65535) return 0;
+     }
+
+     if (port == 0) return 0;
+
+     *_port = port;
+     return 1;
+}
+
+BYTE Net_Parse_Target(const char *_text, ULONG *_ip, UWORD *_port)
+{
+     char ip_text[16];
+     LONG length = 0;
+
+     while (_text[length] && _text[length] != ':')
+     {
+          if (length == sizeof(ip_text) - 1) return 0;
+          ip_text[length] = _text[length];
+          length++;
+     }
+     ip_text[length] = 0;
+
+     if (!Net_Parse_Ip(ip_text, _ip)) return 0;
+     if (_text[length] == 0) return 1;
+
+     return Net_Parse_Port(_text + length + 1, _port);
+}
+
+void Net_Format_Ip(ULONG _ip, char *_buffer)
+{
+     UBYTE bytes[4];
+     memcpy(bytes, &_ip, 4);
+
+     sprintf(_buffer, "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+}
+
+static LONG Net_Hex_Digit(char _c)
+{
+     if (_c >= '0' && _c <= '9') return _c - '0';
+     if (_c >= 'a' && _c <= 'f') return _c - 'a' + 10;
+     if (_c >= 'A' && _c <= 'F') return _c - 'A' + 10;
+     return -1;
+}
+
+BYTE Net_Parse_Ip6(const char *_text, UBYTE *_ip6)
+{
+     UBYTE bytes[16];
+     LONG length = 0;         // Bytes parsed.
+     LONG gap = -1;           // Where "::" was, in bytes.
+
+     memset(bytes, 0, sizeof(bytes));
+
+     if (_text[0] == ':')
+     {
+          if (_text[1] != ':') return 0;
+          gap = 0;
+          _text += 2;
+     }
+
+     while (*_text && length < 16)
+     {
+          // Dotted IPv4 tail, as in ::ffff:1.2.3.4.
+          const char *end = _text;
+          while (Net_Hex_Digit(*end) >= 0) end++;
+
+          if (*end == '.')
+          {
+               ULONG ip;
+               if (length > 12 || !Net_Parse_Ip(_text, &ip)) return 0;
+
+               memcpy(bytes + length, &ip, 4);
+               length += 4;
+               _text += strlen(_text);
+               break;
+          }
+
+          LONG value = 0, digits = 0;
+
+          for (; Net_Hex_Digit(*_text) >= 0; _text++)
+          {
+               value = value * 16 + Net_Hex_Digit(*_text);
+               if (++digits > 4) return 0;
+          }
+
+          if (digits == 0) return 0;
+
+          bytes[length++] = value >> 8;
+          bytes[length++] = value & 0xff;
+
+          if (*_text == 0) break;
+          if (*_text++ != ':') return 0;
+
+          if (*_text == ':')
+          {
+               if (gap >= 0) return 0;
+               gap = length;
+               _text++;
+               if (*_text == 0) break;
+          }
+          else if (*_text == 0) return 0;
+     }
+
+     if (*_text) return 0;
+
+     // Zeros of "::" go in the gap, the rest moves to the end.
+     if (gap >= 0)
+     {
+          if (length == 16) return 0;
+
+          memmove(bytes + 16 - (length - gap), bytes + gap, length - gap);
+          memset(bytes + gap, 0, 16 - length);
+     }
+     else if (length != 16) return 0;
+
+     memcpy(_ip6, bytes, 16);
+     return 1;
+}
+
+BYTE Net_Parse_Target6(const char *_text, UBYTE *_ip6, UWORD *_port)
+{
+     char ip_text[48];
+
+     if (*_text != '[')
+     {
+          if (strlen(_text) >= sizeof(ip_text)) return 0;
+          return Net_Parse_Ip6(_text, _ip6);
+     }
+
+     // Brackets keep the port apart from the colons of the address.
+     const char *end = strchr(_text, ']');
+     if (end == NULL || end - _text - 1 >= (LONG)sizeof(ip_text)) return 0;
+
+     memcpy(ip_text, _text + 1, end - _text - 1);
+     ip_text[end - _text - 1] = 0;
+
+     if (!Net_Parse_Ip6(ip_text, _ip6)) return 0;
+
+     if (end[1] == 0) return 1;
+     if (end[1] != ':') return 0;
+
+     return Net_Parse_Port(end + 2, _port);
+}
+
+void Net_Format_Ip6(const UBYTE *_ip6, char *_buffer)
+{
+     // Longest run of zero groups, if longer than one, becomes "::".
+     LONG best = -1, best_length = 1;
+
+     for (LONG i = 0; i < 8; )
+     {
+          LONG run = 0;
+          while (i + run < 8 && _ip6[(i + run) * 2] == 0 && _ip6[(i + run) * 2 + 1] == 0) run++;
+
+          if (run > best_length)
+          {
+               best = i;
+               best_length = run;
+          }
+
+          i += run ? run : 1;
+     }
+
+     char *text = _buffer;
+     *text = 0;
+
+     for (LONG i = 0; i < 8; i++)
+     {
+          if (i == best)
+          {
+               text += sprintf(text, "::");
+               i += best_length - 1;
+               continue;
+          }
+
+          if (i && i != best + best_length) *text++ = ':';
+          text += sprintf(text, "%x", (_ip6[i * 2] << 8) | _ip6[i * 2 + 1]);
+     }
+}
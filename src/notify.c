@@ -0,0 +1,108 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - change notification
+ * ---------------------------------------------------------*/
+
+#include "notify.h"
+
+#include <string.h>
+
+void Notify_Init(struct Notify *_notify)
+{
+     memset(_notify, 0, sizeof(struct Notify));
+
+     _notify->state.status = -1;
+     _notify->state.rtt_bucket = -1;
+}
+
+struct Notify_Client* Notify_Find(struct Notify *_notify, APTR _handle)
+{
+     for (LONG i = 0; i < _notify->client_count; i++)
+          if (_notify->client[i].handle == _handle) return &_notify->client[i];
+
+     return NULL;
+}
+
+struct Notify_Client* Notify_Subscribe(struct Notify *_notify, APTR _handle, UBYTE _events)
+{
+     struct Notify_Client *client = Notify_Find(_notify, _handle);
+
+     if (client == NULL)
+     {
+          if (_notify->client_count >= NOTIFY_MAX_CLIENTS) return NULL;
+
+          client = &_notify->client[_notify->client_count++];
+          client->handle = _handle;
+          client->busy = 0;
+     }
+
+     client->events = _events;
+     client->status_seen = _notify->state.status_seq;
+     client->rtt_seen = _notify->state.rtt_seq;
+
+     return client;
+}
+
+BYTE Notify_Unsubscribe(struct Notify *_notify, APTR _handle)
+{
+     struct Notify_Client *client = Notify_Find(_notify, _handle);
+
+     if (client == NULL) return 0;
+
+     // Order does not matter - the last one takes the place.
+     *client = _notify->client[--_notify->client_count];
+
+     return 1;
+}
+
+BYTE Notify_Rtt_Bucket(ULONG _rtt)
+{
+     // Bit length of the milliseconds, as the stats histograms do it.
+     BYTE bucket = 0;
+
+     for (ULONG rest = _rtt / 1000; rest && bucket < NOTIFY_RTT_BUCKETS - 1; rest >>= 1) bucket++;
+
+     return bucket;
+}
+
+UBYTE Notify_Update(struct Notify *_notify, BYTE _status, BYTE _rtt_valid, ULONG _rtt)
+{
+     struct Notify_State *state = &_notify->state;
+     BYTE bucket = _rtt_valid ? Notify_Rtt_Bucket(_rtt) : -1;
+     UBYTE changed = 0;
+
+     if (_status != state->status)
+     {
+          state->status = _status;
+          state->status_seq++;
+          changed |= NOTIFY_STATUS;
+     }
+
+     if (bucket != state->rtt_bucket)
+     {
+          state->rtt_bucket = bucket;
+          state->rtt_seq++;
+          changed |= NOTIFY_RTT;
+     }
+
+     // The value goes along with the next message either way.
+     state->rtt = _rtt_valid ? _rtt : 0;
+
+     return changed;
+}
+
+BYTE Notify_Pending(struct Notify *_notify, struct Notify_Client *_client)
+{
+     if (_client->busy) return 0;
+
+     if ((_client->events & NOTIFY_STATUS) && _client->status_seen != _notify->state.status_seq) return 1;
+     if ((_client->events & NOTIFY_RTT) && _client->rtt_seen != _notify->state.rtt_seq) return 1;
+
+     return 0;
+}
+
+void Notify_Delivered(struct Notify *_notify, struct Notify_Client *_client)
+{
+     _client->status_seen = _notify->state.status_seq;
+     _client->rtt_seen = _notify->state.rtt_seq;
+     _notify->sent++;
+}
@@ -0,0 +1,83 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - change notification
+ *
+ * Clients that want to know the status no longer have to
+ * read the ENV variable over and over. They subscribe -
+ * through a public message port on Amiga, a Unix socket on
+ * POSIX - and get a message only when the status changes,
+ * or, if they ask for it, the RTT moves to another bucket.
+ *
+ * This part keeps the current state and the subscribers.
+ * Each subscriber has seen a state, identified by sequence
+ * numbers of the status and of the RTT bucket. A subscriber
+ * still busy with the previous message gets the state that
+ * is current when it is done - changes in between are
+ * coalesced, a slow client never makes a queue.
+ *
+ * The transport is the backend's.
+ * ---------------------------------------------------------*/
+
+#ifndef NOTIFY_H
+#define NOTIFY_H
+
+#include "platform.h"
+
+// What a subscriber wants to hear about.
+#define NOTIFY_STATUS            1
+#define NOTIFY_RTT               2    // The bucket of the RTT - not every 0.1 ms.
+
+#define NOTIFY_MAX_CLIENTS       512
+
+// Bucket n holds RTTs below 2^n ms (0 - below 1 ms), the last one everything from ~1 s up.
+#define NOTIFY_RTT_BUCKETS       12
+
+struct Notify_State
+{
+     BYTE  status;            // -1 unknown, 0 offline, 1 online.
+     BYTE  rtt_bucket;        // -1 - no answer to take the RTT of.
+     ULONG rtt;               // Microseconds, 0 with rtt_bucket -1.
+     ULONG status_seq;        // Bumped with every change of the status,
+     ULONG rtt_seq;           // and of the bucket.
+};
+
+struct Notify_Client
+{
+     APTR  handle;            // Backend's - the reply port, the connection.
+     UBYTE events;            // NOTIFY_*
+     BYTE  busy;              // Previous message not done yet - Amiga message not replied.
+     ULONG status_seen;       // Sequence numbers of the state it was sent last.
+     ULONG rtt_seen;
+};
+
+struct Notify
+{
+     struct Notify_Client client[NOTIFY_MAX_CLIENTS];
+     LONG  client_count;
+     struct Notify_State state;
+     ULONG sent;              // Messages delivered.
+};
+
+void Notify_Init(struct Notify *_notify);
+
+// Adds the subscriber, or changes what it wants if it is there already. It has
+// seen the current state - it gets that in the answer. NULL if the table is full.
+struct Notify_Client* Notify_Subscribe(struct Notify *_notify, APTR _handle, UBYTE _events);
+
+// Returns 0 if there is no such subscriber.
+BYTE Notify_Unsubscribe(struct Notify *_notify, APTR _handle);
+
+struct Notify_Client* Notify_Find(struct Notify *_notify, APTR _handle);
+
+// Takes the new state. Returns NOTIFY_* bits of what changed.
+UBYTE Notify_Update(struct Notify *_notify, BYTE _status, BYTE _rtt_valid, ULONG _rtt);
+
+// Returns 1 if the subscriber should get the current state now.
+BYTE Notify_Pending(struct Notify *_notify, struct Notify_Client *_client);
+
+// Marks the current state as sent to the subscriber.
+void Notify_Delivered(struct Notify *_notify, struct Notify_Client *_client);
+
+// Bucket of an RTT in microseconds, see NOTIFY_RTT_BUCKETS.
+BYTE Notify_Rtt_Bucket(ULONG _rtt);
+
+#endif
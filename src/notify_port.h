@@ -0,0 +1,65 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - notification port protocol
+ *
+ * Include this in a program that wants to hear about the
+ * status instead of reading ENV:msInternetStatus.
+ *
+ * The commodity has a public message port, NOTIFY_PORT_NAME.
+ * Find it under Forbid() and PutMsg() a Notify_Message to it,
+ * with mn_Length set and your reply port. Every command is
+ * replied at once, with the current state filled in:
+ *
+ *   NOTIFY_CMD_QUERY        - only the state.
+ *   NOTIFY_CMD_SUBSCRIBE    - nm_Events (NOTIFY_STATUS, NOTIFY_RTT)
+ *                             are sent to nm_Port from now on.
+ *   NOTIFY_CMD_UNSUBSCRIBE  - no more of them.
+ *
+ * A change comes as a NOTIFY_CMD_CHANGED message to nm_Port -
+ * reply it. Until it is replied no other one is sent, the
+ * state that is current then follows - changes in between
+ * are coalesced, nm_Sequence tells how many there were.
+ *
+ * Before deleting nm_Port unsubscribe, then reply whatever
+ * is still queued at it. When the commodity quits its port
+ * is gone - check the nm_Result of every command.
+ * ---------------------------------------------------------*/
+
+#ifndef NOTIFY_PORT_H
+#define NOTIFY_PORT_H
+
+#include <exec/ports.h>
+
+#define NOTIFY_PORT_NAME         "msInternetStatus"
+
+// nm_Command
+#define NOTIFY_CMD_SUBSCRIBE     1
+#define NOTIFY_CMD_UNSUBSCRIBE   2
+#define NOTIFY_CMD_QUERY         3
+#define NOTIFY_CMD_CHANGED       4    // From the commodity.
+
+// nm_Events - same bits as in notify.h.
+#ifndef NOTIFY_STATUS
+#define NOTIFY_STATUS            1
+#define NOTIFY_RTT               2
+#endif
+
+// nm_Result
+#define NOTIFY_OK                0
+#define NOTIFY_ERROR_COMMAND     1    // Unknown command, or mn_Length too short.
+#define NOTIFY_ERROR_FULL        2    // Too many subscribers.
+#define NOTIFY_ERROR_GONE        3    // The commodity is quitting.
+
+struct Notify_Message
+{
+     struct Message nm_Message;
+     UWORD  nm_Command;           // NOTIFY_CMD_*
+     UWORD  nm_Events;            // NOTIFY_STATUS, NOTIFY_RTT - with NOTIFY_CMD_SUBSCRIBE.
+     struct MsgPort *nm_Port;     // Where the changes go, NULL - the reply port.
+     LONG   nm_Status;            // -1 unknown, 0 Offline, 1 Online.
+     ULONG  nm_Rtt;               // Microseconds of the latest answer, 0 without one.
+     LONG   nm_RttBucket;         // Below 2^n ms, -1 without an answer.
+     ULONG  nm_Sequence;          // Changes of the status so far.
+     LONG   nm_Result;            // NOTIFY_OK or NOTIFY_ERROR_*
+};
+
+#endif
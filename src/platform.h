@@ -0,0 +1,37 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - platform glue
+ *
+ * Lets the probe code build both for AmigaOS (bsdsocket.library)
+ * and for POSIX systems, where it can be run and measured
+ * against loopback listeners.
+ * ---------------------------------------------------------*/
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#if defined(AMIGA) || defined(__amigaos__) || defined(__AMIGA__)
+     #define PLATFORM_AMIGA   1
+     #include <exec/types.h>
+#else
+     #define PLATFORM_POSIX   1
+     #include <stdint.h>
+
+     // Same names as exec/types.h, so shared code reads like the rest of the program.
+     typedef int8_t      BYTE;
+     typedef uint8_t     UBYTE;
+     typedef int16_t     WORD;
+     typedef uint16_t    UWORD;
+     typedef int32_t     LONG;
+     typedef uint32_t    ULONG;
+     typedef char*       STRPTR;
+     typedef const char* CONST_STRPTR;
+     typedef void*       APTR;
+#endif
+
+// Microseconds from a monotonic clock.
+typedef unsigned long long TIME_US;
+
+// Each backend provides its own clock - E-Clock on Amiga, CLOCK_MONOTONIC on POSIX.
+TIME_US Platform_Time(void);
+
+#endif
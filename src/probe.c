@@ -0,0 +1,729 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - probe engine
+ * ---------------------------------------------------------*/
+
+#include "probe.h"
+#include "dns.h"
+#include "stats.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+// What a probe type does - how it starts, what it waits for and how it reads an event.
+struct Probe_Type
+{
+     const char *name;
+     UWORD       port;    // 0 - the port given to Probe_Parse_Target().
+
+     // Returns the socket, *_status IP_STATUS_*.
+     LONG      (*start)(struct Probe_Target *_target, struct Probe_Attempt *_attempt, BYTE _family, BYTE *_status);
+     UBYTE     (*want)(struct Probe_Attempt *_attempt);                                               // NET_EVENT_*
+     BYTE      (*service)(struct Probe_Target *_target, struct Probe_Attempt *_attempt, UBYTE _ready); // IP_STATUS_*
+};
+
+// Packets are built and read one at a time - one buffer for all targets.
+static UBYTE probe_packet[DNS_MAX_MESSAGE];
+
+static BYTE Probe_Net_Status(BYTE _state)
+{
+     switch (_state)
+     {
+          case NET_CONNECT_PENDING:      return IP_STATUS_PENDING;
+          case NET_CONNECT_DONE:         return IP_STATUS_CONNECTED;
+          case NET_CONNECT_REFUSED:      return IP_STATUS_REFUSED;
+          case NET_CONNECT_UNREACHABLE:  return IP_STATUS_UNREACHABLE;
+          case NET_CONNECT_TIMEOUT:      return IP_STATUS_TIMEOUT;
+          default:                       return IP_STATUS_FAILED;
+     }
+}
+
+static BYTE Probe_Family(const struct Probe_Target *_target, const struct Probe_Attempt *_attempt)
+{
+     return (BYTE)(_attempt - _target->attempt);
+}
+
+// --- TCP - the handshake is the answer. ---
+
+static LONG Probe_Tcp_Start(struct Probe_Target *_target, struct Probe_Attempt *_attempt, BYTE _family, BYTE *_status)
+{
+     BYTE state;
+     LONG socket;
+
+     (void)_attempt;
+
+     if (_family == NET_FAMILY_V6) socket = Net_Tcp_Connect_Start6(_target->ip6, _target->port, &state);
+     else                          socket = Net_Tcp_Connect_Start(_target->ip, _target->port, &state);
+
+     *_status = Probe_Net_Status(state);
+     return socket;
+}
+
+static UBYTE Probe_Tcp_Want(struct Probe_Attempt *_attempt)
+{
+     (void)_attempt;
+     return NET_EVENT_WRITE;
+}
+
+static BYTE Probe_Tcp_Service(struct Probe_Target *_target, struct Probe_Attempt *_attempt, UBYTE _ready)
+{
+     (void)_target;
+     return Probe_Net_Status(Net_Tcp_Connect_State(_attempt->socket, _ready));
+}
+
+// --- DNS - one query, any reply that belongs to it. ---
+
+static LONG Probe_Dns_Start(struct Probe_Target *_target, struct Probe_Attempt *_attempt, BYTE _family, BYTE *_status)
+{
+     BYTE state;
+     LONG socket;
+
+     if (_family == NET_FAMILY_V6) socket = Net_Udp_Open6(_target->ip6, _target->port, &state);
+     else                          socket = Net_Udp_Open(_target->ip, _target->port, &state);
+
+     *_status = Probe_Net_Status(state);
+     if (socket == NET_NO_SOCKET || *_status != IP_STATUS_CONNECTED) return socket;
+
+     _attempt->query_id = Dns_Next_Id();
+
+     LONG length = Dns_Query(probe_packet, sizeof(probe_packet), _attempt->query_id, _target->path, _target->path[0] ? DNS_TYPE_A : DNS_TYPE_NS);
+
+     if (length == 0) *_status = IP_STATUS_FAILED;
+     else if (Net_Send(socket, probe_packet, length, &state) == length) *_status = IP_STATUS_PENDING;
+     else *_status = Probe_Net_Status(state);
+
+     return socket;
+}
+
+static UBYTE Probe_Dns_Want(struct Probe_Attempt *_attempt)
+{
+     (void)_attempt;
+     return NET_EVENT_READ;
+}
+
+static BYTE Probe_Dns_Service(struct Probe_Target *_target, struct Probe_Attempt *_attempt, UBYTE _ready)
+{
+     BYTE state;
+     LONG length = Net_Receive(_attempt->socket, probe_packet, sizeof(probe_packet), &state);
+
+     (void)_target;
+     (void)_ready;
+
+     // Port unreachable comes back as refused - the host is there.
+     if (length < 0) return Probe_Net_Status(state);
+
+     switch (Dns_Reply_Code(probe_packet, length, _attempt->query_id))
+     {
+          case -1:  return IP_STATUS_PENDING;          // Not ours - keep waiting.
+          case 0:                                      // NOERROR
+          case 3:   return IP_STATUS_CONNECTED;        // NXDOMAIN - an answer as well.
+
+          // SERVFAIL and the like - a forwarder that can't reach its upstream.
+          default:  return IP_STATUS_UNEXPECTED;
+     }
+}
+
+// --- HTTP - HEAD request after the handshake, then the status line. ---
+
+static BYTE Probe_Http_Request(struct Probe_Target *_target, struct Probe_Attempt *_attempt)
+{
+     char address[48];
+     BYTE state = NET_CONNECT_PENDING;
+
+     // Virtual hosts need the name, an address target only has the address.
+     const char *host = address;
+     if (_target->name) host = _target->name->host;
+     else Probe_Format_Address(_target, Probe_Family(_target, _attempt), address);
+
+     LONG length = sprintf((char*)probe_packet, "HEAD %s HTTP/1.0\r\nHost: %s\r\nUser-Agent: msInternetStatus\r\nConnection: close\r\n\r\n",
+          _target->path, host);
+
+     // A fresh socket takes the whole request - a part of it, or a full buffer, fails the attempt.
+     LONG sent = Net_Send(_attempt->socket, probe_packet, length, &state);
+
+     if (sent >= 0 && sent < length) return IP_STATUS_FAILED;
+     if (sent < 0) return state == NET_CONNECT_PENDING ? IP_STATUS_FAILED : Probe_Net_Status(state);
+
+     _attempt->stage = 1;
+     return IP_STATUS_PENDING;
+}
+
+static LONG Probe_Http_Start(struct Probe_Target *_target, struct Probe_Attempt *_attempt, BYTE _family, BYTE *_status)
+{
+     _attempt->stage = 0;
+     _attempt->reply_length = 0;
+
+     LONG socket = Probe_Tcp_Start(_target, _attempt, _family, _status);
+
+     // Connected right away (loopback) - ask right away.
+     if (*_status == IP_STATUS_CONNECTED)
+     {
+          _attempt->socket = socket;
+          *_status = Probe_Http_Request(_target, _attempt);
+     }
+
+     return socket;
+}
+
+static UBYTE Probe_Http_Want(struct Probe_Attempt *_attempt)
+{
+     return _attempt->stage ? NET_EVENT_READ : NET_EVENT_WRITE;
+}
+
+static BYTE Probe_Http_Service(struct Probe_Target *_target, struct Probe_Attempt *_attempt, UBYTE _ready)
+{
+     if (_attempt->stage == 0)
+     {
+          BYTE status = Probe_Tcp_Service(_target, _attempt, _ready);
+          return status == IP_STATUS_CONNECTED ? Probe_Http_Request(_target, _attempt) : status;
+     }
+
+     BYTE state;
+     LONG length = Net_Receive(_attempt->socket, _attempt->reply + _attempt->reply_length, sizeof(_attempt->reply) - 1 - _attempt->reply_length, &state);
+
+     if (length < 0) return Probe_Net_Status(state);
+
+     _attempt->reply_length += length;
+     _attempt->reply[_attempt->reply_length] = 0;
+
+     // "HTTP/1.1 204" is all that is needed.
+     if (length > 0 && _attempt->reply_length < 12) return IP_STATUS_PENDING;
+     if (_attempt->reply_length < 12 || strncmp(_attempt->reply, "HTTP/", 5) != 0) return IP_STATUS_UNEXPECTED;
+
+     LONG code = 0;
+     for (LONG i = 9; i < 12 && isdigit((UBYTE)_attempt->reply[i]); i++) code = code * 10 + (_attempt->reply[i] - '0');
+
+     if (_target->expect ? code == _target->expect : code >= 200 && code <= 299) return IP_STATUS_CONNECTED;
+     return IP_STATUS_UNEXPECTED;
+}
+
+static const struct Probe_Type probe_type[PROBE_TYPES] =
+{
+     { "TCP",  0,        Probe_Tcp_Start,  Probe_Tcp_Want,  Probe_Tcp_Service  },
+     { "DNS",  DNS_PORT, Probe_Dns_Start,  Probe_Dns_Want,  Probe_Dns_Service  },
+     { "HTTP", 80,       Probe_Http_Start, Probe_Http_Want, Probe_Http_Service },
+};
+
+static void Probe_Target_Clear(struct Probe_Target *_target)
+{
+     _target->status = IP_STATUS_NOT_USED;
+     _target->family = -1;
+
+     for (BYTE family = 0; family < NET_FAMILIES; family++)
+     {
+          _target->attempt[family].status = IP_STATUS_NOT_USED;
+          _target->attempt[family].socket = NET_NO_SOCKET;
+     }
+}
+
+void Probe_Init(struct Probe *_probe)
+{
+     memset(_probe, 0, sizeof(struct Probe));
+
+     _probe->stagger_us = PROBE_STAGGER_US;
+
+     for (LONG i = 0; i < PROBE_MAX_TARGETS; i++) Probe_Target_Clear(&_probe->target[i]);
+}
+
+BYTE Probe_Add_Target(struct Probe *_probe, ULONG _ip, UWORD _port)
+{
+     struct Probe_Target target;
+
+     memset(&target, 0, sizeof(target));
+     target.ip = _ip;
+     target.families = 1 << NET_FAMILY_V4;
+     target.port = _port;
+     target.type = PROBE_TYPE_TCP;
+
+     return Probe_Add_Parsed(_probe, &target);
+}
+
+BYTE Probe_Parse_Target(const char *_text, UWORD _port, struct Probe_Target *_target, struct Resolver *_resolver)
+{
+     memset(_target, 0, sizeof(struct Probe_Target));
+     _target->type = PROBE_TYPE_TCP;
+
+     // Type prefix, in any case.
+     for (BYTE type = 0; type < PROBE_TYPES; type++)
+     {
+          const char *name = probe_type[type].name;
+          LONG i = 0;
+
+          while (name[i] && toupper((UBYTE)_text[i]) == name[i]) i++;
+
+          if (name[i] == 0 && _text[i] == ':')
+          {
+               _target->type = type;
+               _text += i + 1;
+               break;
+          }
+     }
+
+     // Address or host name up to the path or the status.
+     char address[RESOLVE_MAX_HOST + 8];
+     LONG length = 0;
+
+     while (*_text && *_text != '/' && *_text != '=')
+     {
+          if (length == sizeof(address) - 1) return 0;
+          address[length++] = *_text++;
+     }
+     address[length] = 0;
+
+     UWORD port = probe_type[(UBYTE)_target->type].port ? probe_type[(UBYTE)_target->type].port : _port;
+     char *host = NULL;
+
+     if (Net_Parse_Target(address, &_target->ip, &port)) _target->families = 1 << NET_FAMILY_V4;
+     else if (Net_Parse_Target6(address, _target->ip6, &port)) _target->families = 1 << NET_FAMILY_V6;
+     else
+     {
+          char *colon = strchr(address, ':');
+
+          if (colon)
+          {
+               *colon = 0;
+               if (!Net_Parse_Port(colon + 1, &port)) return 0;
+          }
+
+          if (_resolver == NULL || !Resolve_Is_Host(address)) return 0;
+          host = address;
+     }
+
+     _target->port = port;
+
+     // Path - a DNS probe takes the name without the slash.
+     if (*_text == '/')
+     {
+          if (_target->type == PROBE_TYPE_DNS) _text++;
+
+          length = 0;
+          while (*_text && *_text != '=')
+          {
+               if (length == sizeof(_target->path) - 1) return 0;
+               _target->path[length++] = *_text++;
+          }
+          _target->path[length] = 0;
+     }
+
+     if (_target->type == PROBE_TYPE_HTTP && _target->path[0] == 0) strcpy(_target->path, "/");
+
+     // Expected HTTP status.
+     if (*_text == '=')
+     {
+          LONG code = 0;
+
+          for (_text++; isdigit((UBYTE)*_text); _text++) code = code * 10 + (*_text - '0');
+          if (*_text || code < 100 || code > 599 || _target->type != PROBE_TYPE_HTTP) return 0;
+
+          _target->expect = code;
+     }
+
+     // Only a valid target gets its name looked up.
+     if (host)
+     {
+          _target->name = Resolve_Add(_resolver, host);
+          if (_target->name == NULL) return 0;
+     }
+
+     return 1;
+}
+
+BYTE Probe_Add_Parsed(struct Probe *_probe, const struct Probe_Target *_target)
+{
+     if (_probe->target_count >= PROBE_MAX_TARGETS) return 0;
+
+     struct Probe_Target *target = &_probe->target[_probe->target_count++];
+
+     memset(target, 0, sizeof(struct Probe_Target));
+     target->ip = _target->ip;
+     memcpy(target->ip6, _target->ip6, 16);
+     target->families = _target->families;
+     target->name = _target->name;
+     target->port = _target->port;
+     target->type = _target->type;
+     target->expect = _target->expect;
+     strcpy(target->path, _target->path);
+
+     Probe_Target_Clear(target);
+
+     return 1;
+}
+
+void Probe_Set_Policy(struct Probe *_probe, BYTE _policy, LONG _quorum)
+{
+     _probe->policy = _policy;
+     _probe->quorum = _quorum;
+}
+
+void Probe_Set_Stagger(struct Probe *_probe, ULONG _stagger_us)
+{
+     _probe->stagger_us = _stagger_us < PROBE_STAGGER_US ? _stagger_us : PROBE_STAGGER_US;
+}
+
+BYTE Probe_Resolving(struct Probe *_probe)
+{
+     for (LONG i = 0; i < _probe->target_count; i++)
+          if (_probe->target[i].name && Resolve_Pending(_probe->target[i].name)) return 1;
+
+     return 0;
+}
+
+LONG Probe_Needed(struct Probe *_probe)
+{
+     switch (_probe->policy)
+     {
+          case PROBE_POLICY_ALL:
+          case PROBE_POLICY_EVERY:
+               return _probe->target_count;
+
+          case PROBE_POLICY_QUORUM:
+               if (_probe->quorum < 1) return 1;
+               if (_probe->quorum > _probe->target_count) return _probe->target_count;
+               return _probe->quorum;
+
+          default:
+               return 1;
+     }
+}
+
+static void Probe_Count(BYTE _status)
+{
+     switch (_status)
+     {
+          case IP_STATUS_CONNECTED:     Stats_Count(STATS_CONNECTED);    break;
+          case IP_STATUS_REFUSED:       Stats_Count(STATS_REFUSED);      break;
+          case IP_STATUS_UNREACHABLE:   Stats_Count(STATS_UNREACHABLE);  break;
+          case IP_STATUS_TIMEOUT:       Stats_Count(STATS_TIMEOUTS);     break;
+          case IP_STATUS_UNEXPECTED:    Stats_Count(STATS_UNEXPECTED);   break;
+          case IP_STATUS_ABORTED:       Stats_Count(STATS_ABORTED);      break;
+          case IP_STATUS_UNRESOLVED:    Stats_Count(STATS_UNRESOLVED);   break;
+          default:                      Stats_Count(STATS_FAILED);       break;
+     }
+}
+
+// Sets final status of a target - every attempt of it is over.
+static void Probe_Target_Done(struct Probe *_probe, struct Probe_Target *_target, BYTE _status, BYTE _family)
+{
+     _target->status = _status;
+     _target->family = _family;
+     _target->stagger = 0;
+
+     Probe_Count(_target->status);
+
+     LONG needed = Probe_Needed(_probe);
+
+     // Refused means the host itself sent RST - the path to it works.
+     if (_target->status == IP_STATUS_CONNECTED || _target->status == IP_STATUS_REFUSED)
+     {
+          _target->rtt = _target->attempt[(UBYTE)_family].rtt;
+          _probe->answered++;
+
+          // Answered over IPv4 although it has IPv6 - the race was lost or IPv6 failed.
+          if (_family == NET_FAMILY_V4 && _target->attempt[NET_FAMILY_V6].status != IP_STATUS_NOT_USED) Stats_Count(STATS_FALLBACKS);
+
+          // The answer that reaches the policy decides the probe.
+          if (!_probe->done && _probe->answered >= needed)
+          {
+               _probe->rtt = _target->rtt;
+               _probe->result = 1;
+               _probe->done = 1;
+          }
+     }
+
+     _probe->remaining--;
+
+     // Not enough targets left to reach the policy - offline without waiting for the timeout.
+     if (!_probe->done && _probe->policy != PROBE_POLICY_EVERY && _probe->answered + _probe->remaining < needed) _probe->done = 1;
+}
+
+static void Probe_Attempt_Close(struct Probe *_probe, struct Probe_Attempt *_attempt)
+{
+     if (_attempt->socket == NET_NO_SOCKET) return;
+
+     Net_Close_Socket(_attempt->socket);
+     _attempt->socket = NET_NO_SOCKET;
+     _probe->in_flight--;
+}
+
+static void Probe_Attempt_Start(struct Probe *_probe, struct Probe_Target *_target, BYTE _family);
+
+// Sets final status of an attempt. The first answer decides the target and drops the
+// other family, a failure starts the other family at once or waits for it.
+static void Probe_Attempt_Done(struct Probe *_probe, struct Probe_Target *_target, BYTE _family, BYTE _status)
+{
+     struct Probe_Attempt *attempt = &_target->attempt[(UBYTE)_family];
+     struct Probe_Attempt *other = &_target->attempt[(UBYTE)(_family ^ 1)];
+
+     attempt->status = _status;
+     Probe_Attempt_Close(_probe, attempt);
+
+     if (_status == IP_STATUS_CONNECTED || _status == IP_STATUS_REFUSED)
+     {
+          attempt->rtt = (ULONG)(Platform_Time() - attempt->start);
+          _probe->family_answered[(UBYTE)_family]++;
+
+          // The slower family lost - for its own status that is as good as failed.
+          if (other->status == IP_STATUS_PENDING)
+          {
+               other->status = IP_STATUS_ABORTED;
+               Probe_Attempt_Close(_probe, other);
+               _probe->family_failed[(UBYTE)(_family ^ 1)]++;
+          }
+
+          Probe_Target_Done(_probe, _target, _status, _family);
+          return;
+     }
+
+     _probe->family_failed[(UBYTE)_family]++;
+
+     // IPv6 failed before the stagger ran out - no reason to wait for it.
+     if (_target->stagger)
+     {
+          _target->stagger = 0;
+          Probe_Attempt_Start(_probe, _target, _family ^ 1);
+          return;
+     }
+
+     if (other->status == IP_STATUS_PENDING) return;
+
+     Probe_Target_Done(_probe, _target, _status, _family);
+}
+
+static void Probe_Attempt_Start(struct Probe *_probe, struct Probe_Target *_target, BYTE _family)
+{
+     struct Probe_Attempt *attempt = &_target->attempt[(UBYTE)_family];
+     BYTE status;
+
+     attempt->status = IP_STATUS_PENDING;
+     attempt->rtt = 0;
+     attempt->start = Platform_Time();
+     attempt->socket = probe_type[(UBYTE)_target->type].start(_target, attempt, _family, &status);
+
+     if (attempt->socket != NET_NO_SOCKET) _probe->in_flight++;
+
+     // Loopback and a missing route are often known right away.
+     if (status != IP_STATUS_PENDING) Probe_Attempt_Done(_probe, _target, _family, status);
+}
+
+LONG Probe_Start(struct Probe *_probe)
+{
+     _probe->in_flight = 0;
+     _probe->answered = 0;
+     _probe->remaining = _probe->target_count;
+     _probe->done = 0;
+     _probe->result = 0;
+     _probe->rtt = 0;
+
+     for (BYTE family = 0; family < NET_FAMILIES; family++)
+     {
+          _probe->family_answered[(UBYTE)family] = 0;
+          _probe->family_failed[(UBYTE)family] = 0;
+     }
+
+     // Fire all probes at once - they race each other.
+     for (LONG i = 0; i < _probe->target_count; i++)
+     {
+          struct Probe_Target *target = &_probe->target[i];
+
+          Probe_Target_Clear(target);
+          target->status = IP_STATUS_PENDING;
+          target->rtt = 0;
+          target->stagger = 0;
+
+          // Whatever the cache has - a refresh runs on its own, never in the probe's way.
+          if (target->name) target->families = Resolve_Address(target->name, &target->ip, target->ip6);
+
+          UBYTE families = target->families;
+          if (!Net_Ipv6()) families &= ~(1 << NET_FAMILY_V6);
+
+          if (families == 0)
+          {
+               // An IPv6 address the stack can't reach is a local failure.
+               Probe_Target_Done(_probe, target, target->families ? IP_STATUS_FAILED : IP_STATUS_UNRESOLVED, -1);
+               continue;
+          }
+
+          if (families == (1 << NET_FAMILY_V4))
+          {
+               Probe_Attempt_Start(_probe, target, NET_FAMILY_V4);
+               continue;
+          }
+
+          // IPv6 first, IPv4 after the head start - unless IPv6 fails right away.
+          if (families & (1 << NET_FAMILY_V4)) target->stagger = Platform_Time() + _probe->stagger_us;
+
+          Probe_Attempt_Start(_probe, target, NET_FAMILY_V6);
+     }
+
+     // Answer known already - nothing to wait for.
+     if (_probe->done) Probe_Finish(_probe);
+
+     return _probe->in_flight;
+}
+
+TIME_US Probe_Stagger_Time(struct Probe *_probe)
+{
+     TIME_US next = 0;
+
+     for (LONG i = 0; i < _probe->target_count; i++)
+     {
+          TIME_US stagger = _probe->target[i].stagger;
+          if (stagger && (next == 0 || stagger < next)) next = stagger;
+     }
+
+     return next;
+}
+
+void Probe_Stagger(struct Probe *_probe)
+{
+     TIME_US now = Platform_Time();
+
+     for (LONG i = 0; i < _probe->target_count && !_probe->done; i++)
+     {
+          struct Probe_Target *target = &_probe->target[i];
+
+          if (target->stagger == 0 || target->stagger > now) continue;
+
+          target->stagger = 0;
+          Probe_Attempt_Start(_probe, target, NET_FAMILY_V4);
+     }
+
+     if (_probe->done) Probe_Finish(_probe);
+}
+
+LONG Probe_Watch(struct Probe *_probe, struct Net_Watch *_watch, LONG _max)
+{
+     LONG count = 0;
+
+     for (LONG i = 0; i < _probe->target_count; i++)
+     {
+          for (BYTE family = 0; family < NET_FAMILIES && count < _max; family++)
+          {
+               struct Probe_Attempt *attempt = &_probe->target[i].attempt[(UBYTE)family];
+
+               if (attempt->socket == NET_NO_SOCKET) continue;
+
+               _watch[count].socket = attempt->socket;
+               _watch[count].want = probe_type[(UBYTE)_probe->target[i].type].want(attempt);
+               _watch[count].ready = 0;
+               count++;
+          }
+     }
+
+     return count;
+}
+
+void Probe_Service(struct Probe *_probe, struct Net_Watch *_watch, LONG _count)
+{
+     BYTE result[PROBE_MAX_TARGETS][NET_FAMILIES];
+
+     for (LONG i = 0; i < _probe->target_count; i++)
+          for (BYTE family = 0; family < NET_FAMILIES; family++) result[i][(UBYTE)family] = IP_STATUS_PENDING;
+
+     // Probe_Watch() listed the sockets in target and family order - walk
+     // both together, so the cost stays linear in the number of targets.
+     // Nothing is closed on the way, the walk only sees the sockets it listed.
+     LONG p = 0;
+
+     for (LONG w = 0; w < _count; w++)
+     {
+          while (p < _probe->target_count * NET_FAMILIES && _probe->target[p / NET_FAMILIES].attempt[p % NET_FAMILIES].socket != _watch[w].socket) p++;
+          if (p == _probe->target_count * NET_FAMILIES) break;
+
+          struct Probe_Target *target = &_probe->target[p / NET_FAMILIES];
+          struct Probe_Attempt *attempt = &target->attempt[p % NET_FAMILIES];
+
+          if (_watch[w].ready) result[p / NET_FAMILIES][p % NET_FAMILIES] = probe_type[(UBYTE)target->type].service(target, attempt, _watch[w].ready);
+          p++;
+     }
+
+     // Both families of a target may have answered - the first one wins, the other is dropped.
+     // IPv6 goes first, so it wins a tie as the stagger prefers it.
+     for (LONG i = 0; i < _probe->target_count; i++)
+          for (BYTE family = NET_FAMILIES - 1; family >= 0; family--)
+               if (result[i][(UBYTE)family] != IP_STATUS_PENDING && _probe->target[i].attempt[(UBYTE)family].status == IP_STATUS_PENDING)
+                    Probe_Attempt_Done(_probe, &_probe->target[i], family, result[i][(UBYTE)family]);
+
+     // Result known - drop the rest.
+     if (_probe->done) Probe_Finish(_probe);
+}
+
+void Probe_Finish(struct Probe *_probe)
+{
+     // Still in flight - either not needed anymore or timed out.
+     BYTE status = _probe->done ? IP_STATUS_ABORTED : IP_STATUS_TIMEOUT;
+
+     for (LONG i = 0; i < _probe->target_count; i++)
+     {
+          struct Probe_Target *target = &_probe->target[i];
+
+          for (BYTE family = 0; family < NET_FAMILIES; family++)
+          {
+               struct Probe_Attempt *attempt = &target->attempt[(UBYTE)family];
+
+               if (attempt->status != IP_STATUS_PENDING) continue;
+
+               Probe_Attempt_Close(_probe, attempt);
+               attempt->status = status;
+
+               if (status == IP_STATUS_TIMEOUT) _probe->family_failed[(UBYTE)family]++;
+          }
+
+          target->stagger = 0;
+
+          if (target->status != IP_STATUS_PENDING) continue;
+
+          target->status = status;
+          Probe_Count(target->status);
+     }
+
+     _probe->in_flight = 0;
+}
+
+const char* Probe_Status_Text(BYTE _status)
+{
+     switch (_status)
+     {
+          case IP_STATUS_FAILED:        return "FAILED";
+          case IP_STATUS_CONNECTED:     return "CONNECTED";
+          case IP_STATUS_REFUSED:       return "REFUSED";
+          case IP_STATUS_UNREACHABLE:   return "UNREACHABLE";
+          case IP_STATUS_TIMEOUT:       return "TIMEOUT";
+          case IP_STATUS_UNEXPECTED:    return "UNEXPECTED";
+          case IP_STATUS_ABORTED:       return "ABORTED";
+          case IP_STATUS_UNRESOLVED:    return "UNRESOLVED";
+          case IP_STATUS_PENDING:       return "PENDING";
+          default:                      return "NOT USED";
+     }
+}
+
+const char* Probe_Policy_Text(BYTE _policy)
+{
+     switch (_policy)
+     {
+          case PROBE_POLICY_QUORUM:     return "QUORUM";
+          case PROBE_POLICY_ALL:        return "ALL";
+          case PROBE_POLICY_EVERY:      return "EVERY";
+          default:                      return "FIRST";
+     }
+}
+
+const char* Probe_Type_Text(BYTE _type)
+{
+     if (_type < 0 || _type >= PROBE_TYPES) return "?";
+
+     return probe_type[(UBYTE)_type].name;
+}
+
+void Probe_Format_Address(const struct Probe_Target *_target, BYTE _family, char *_buffer)
+{
+     if (_family != NET_FAMILY_V6)
+     {
+          Net_Format_Ip(_target->ip, _buffer);
+          return;
+     }
+
+     _buffer[0] = '[';
+     Net_Format_Ip6(_target->ip6, _buffer + 1);
+     strcat(_buffer, "]");
+}
@@ -0,0 +1,171 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - probe engine
+ *
+ * Races non-blocking probes to all targets at once and waits
+ * for them in one select set, so the worst case is a single
+ * timeout no matter how many targets are used. Each target
+ * has its own probe type: a TCP connect classified from
+ * SO_ERROR, a single UDP DNS query, or an HTTP HEAD request
+ * whose status is checked (a captive portal answers, but
+ * with a redirect). Refused or unreachable targets end
+ * without waiting for the timeout.
+ * The policy says how many answers make the result online -
+ * the probe ends as soon as that is reached or out of reach.
+ *
+ * A target with an IPv4 and an IPv6 address races both, in
+ * the Happy Eyeballs way (RFC 8305): IPv6 first, IPv4 after
+ * the stagger or as soon as IPv6 fails, the first answer
+ * wins and the other attempt is dropped. A broken IPv6 path
+ * costs the stagger, not the timeout.
+ * ---------------------------------------------------------*/
+
+#ifndef PROBE_H
+#define PROBE_H
+
+#include "platform.h"
+#include "net.h"
+#include "resolve.h"
+
+#define PROBE_MAX_TARGETS     32
+
+// Head start of the IPv6 attempt of a dual-stack target. Never more than half the
+// probe timeout, so the IPv4 attempt still has time to answer.
+#define PROBE_STAGGER_US      250000
+
+// How a target is asked.
+#define PROBE_TYPE_TCP         0    // Connect - SYN, SYN-ACK, RST.
+#define PROBE_TYPE_DNS         1    // One UDP query, one reply, no connection state.
+#define PROBE_TYPE_HTTP        2    // Connect, HEAD request, expected status.
+#define PROBE_TYPES            3
+
+// How many targets have to answer for online.
+#define PROBE_POLICY_FIRST     0    // Any one - the first answer decides.
+#define PROBE_POLICY_QUORUM    1    // At least quorum of them.
+#define PROBE_POLICY_ALL       2    // Every one.
+#define PROBE_POLICY_EVERY     3    // Every one, and each is waited for - no early end, for loss sampling.
+
+// For IP status
+#define IP_STATUS_FAILED       0    // Local error, for example no free socket.
+#define IP_STATUS_CONNECTED    1
+#define IP_STATUS_REFUSED      2    // Host answered with RST - reachable, counts as online.
+#define IP_STATUS_UNREACHABLE  3
+#define IP_STATUS_TIMEOUT      4
+#define IP_STATUS_UNEXPECTED   5    // Answered, but not what was expected - for example a captive portal.
+#define IP_STATUS_UNRESOLVED   6    // Host name has no address yet - not probed, the link may be fine.
+#define IP_STATUS_NOT_USED    -1
+#define IP_STATUS_ABORTED     -2    // Result was already known.
+#define IP_STATUS_PENDING     -3    // Still in flight.
+
+// One family of a target - the socket and what the probe type keeps per connection.
+struct Probe_Attempt
+{
+     BYTE  status;       // IP_STATUS_*
+     LONG  socket;
+     TIME_US start;      // When the attempt was started.
+     ULONG rtt;          // Microseconds to the answer (connected or refused).
+
+     BYTE  stage;        // HTTP: 0 - connecting, 1 - request sent.
+     UWORD query_id;     // DNS: ID of the query in flight.
+     char  reply[16];    // HTTP: start of the status line.
+     UBYTE reply_length;
+};
+
+struct Probe_Target
+{
+     ULONG ip;           // Network byte order, as returned by inet_addr().
+     UBYTE ip6[16];
+     UBYTE families;     // Bits (1 << NET_FAMILY_*) of the addresses above.
+     struct Resolve_Name *name;    // Host name the addresses come from, NULL if given as address.
+     UWORD port;
+     BYTE  type;         // PROBE_TYPE_*
+     UWORD expect;       // HTTP status that means online, 0 - any 2xx.
+     char  path[48];     // HTTP path, or the name a DNS probe asks for ("" - the root).
+
+     BYTE  status;       // IP_STATUS_* of the target - the first answer, or the last failure.
+     BYTE  family;       // NET_FAMILY_* that decided the status, -1 none.
+     ULONG rtt;          // RTT of that attempt.
+     TIME_US stagger;    // When the IPv4 attempt is due, 0 - started or not needed.
+
+     struct Probe_Attempt attempt[NET_FAMILIES];
+};
+
+struct Probe
+{
+     struct Probe_Target target[PROBE_MAX_TARGETS];
+     LONG  target_count;
+     LONG  in_flight;
+     BYTE  policy;       // PROBE_POLICY_*
+     LONG  quorum;       // Answers needed with PROBE_POLICY_QUORUM.
+
+     LONG  answered;     // Targets that answered (connected or refused).
+     LONG  remaining;    // Targets without the final status yet.
+     BYTE  done;         // Result is known, the rest is not waited for.
+     BYTE  result;       // 1 - online, 0 - offline.
+     ULONG rtt;          // RTT of the answer that decided the result, 0 if offline.
+     ULONG stagger_us;   // Head start of IPv6, see PROBE_STAGGER_US.
+
+     LONG  family_answered[NET_FAMILIES];    // Attempts of the latest probe that answered,
+     LONG  family_failed[NET_FAMILIES];      // and that failed or lost the race to the other family.
+};
+
+void Probe_Init(struct Probe *_probe);
+
+// Adds an IPv4 TCP target.
+BYTE Probe_Add_Target(struct Probe *_probe, ULONG _ip, UWORD _port);
+
+// Parses "[tcp:|dns:|http:]host[:port][/path][=status]" - the port defaults to _port for
+// tcp, 53 for dns and 80 for http. The path of a dns target is the name to ask for.
+// Host is an IPv4 address, an IPv6 address in brackets ("[::1]:80", bare if there is
+// no port) or, with a _resolver, a host name added to its cache.
+// Fills the settings of *_target. Returns 0 if not valid.
+BYTE Probe_Parse_Target(const char *_text, UWORD _port, struct Probe_Target *_target, struct Resolver *_resolver);
+
+// Adds a target with the settings of a parsed one.
+BYTE Probe_Add_Parsed(struct Probe *_probe, const struct Probe_Target *_target);
+
+// Quorum is clamped to the number of targets when the probe starts.
+void Probe_Set_Policy(struct Probe *_probe, BYTE _policy, LONG _quorum);
+
+// Head start of IPv6 for the next probe - clamped to PROBE_STAGGER_US.
+void Probe_Set_Stagger(struct Probe *_probe, ULONG _stagger_us);
+
+// Returns 1 while a host name target waits for its first address - worth
+// holding the first probe back for, it would only report it unresolved.
+BYTE Probe_Resolving(struct Probe *_probe);
+
+// Answers needed for online with the current policy and targets.
+LONG Probe_Needed(struct Probe *_probe);
+
+// Starts connecting to all targets. Returns number of connects in flight.
+LONG Probe_Start(struct Probe *_probe);
+
+// When the next IPv4 attempt of a dual-stack target is due, 0 if none is waiting.
+TIME_US Probe_Stagger_Time(struct Probe *_probe);
+
+// Starts the IPv4 attempts that are due. The probe may be done afterwards.
+void Probe_Stagger(struct Probe *_probe);
+
+// Fills the watch list with sockets still in flight. Returns number of entries.
+LONG Probe_Watch(struct Probe *_probe, struct Net_Watch *_watch, LONG _max);
+
+// Consumes readiness reported by Net_Wait(). Targets that answer (connected
+// or refused) count towards the policy, the probe is over when done is set
+// or nothing is in flight anymore.
+void Probe_Service(struct Probe *_probe, struct Net_Watch *_watch, LONG _count);
+
+// Closes everything still in flight (result known or timeout passed).
+void Probe_Finish(struct Probe *_probe);
+
+// Human readable IP_STATUS_*.
+const char* Probe_Status_Text(BYTE _status);
+
+// Human readable PROBE_POLICY_*.
+const char* Probe_Policy_Text(BYTE _policy);
+
+// Human readable PROBE_TYPE_*.
+const char* Probe_Type_Text(BYTE _type);
+
+// Formats the address of the given family, IPv6 in brackets. Room for 48 chars.
+void Probe_Format_Address(const struct Probe_Target *_target, BYTE _family, char *_buffer);
+
+#endif
@@ -0,0 +1,441 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - host name cache
+ * ---------------------------------------------------------*/
+
+#include "resolve.h"
+#include "dns.h"
+#include "stats.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+// Queries are built and read one at a time - one buffer for all names.
+static UBYTE resolve_packet[DNS_MAX_MESSAGE];
+
+static void Resolve_Timer(struct Wheel_Timer *_timer);
+
+void Resolve_Init(struct Resolver *_resolver, struct Wheel *_wheel)
+{
+     memset(_resolver, 0, sizeof(struct Resolver));
+
+     _resolver->wheel = _wheel;
+}
+
+BYTE Resolve_Add_Server(struct Resolver *_resolver, const char *_text)
+{
+     if (_resolver->server_count >= RESOLVE_MAX_SERVERS) return 0;
+
+     struct Resolve_Server *server = &_resolver->server[_resolver->server_count];
+
+     server->port = DNS_PORT;
+     if (!Net_Parse_Target(_text, &server->ip, &server->port)) return 0;
+
+     // Same server twice would only repeat the same failure.
+     for (LONG i = 0; i < _resolver->server_count; i++)
+          if (_resolver->server[i].ip == server->ip && _resolver->server[i].port == server->port) return 1;
+
+     _resolver->server_count++;
+     return 1;
+}
+
+LONG Resolve_Read_Servers(struct Resolver *_resolver, const char *_path)
+{
+     FILE *file = fopen(_path, "r");
+     if (file == NULL) return 0;
+
+     char line[128];
+     LONG added = 0;
+
+     while (fgets(line, sizeof(line), file))
+     {
+          char *text = line;
+          while (*text == ' ' || *text == '\t') text++;
+
+          // Keyword in any case - "nameserver" in resolv.conf, "NAMESERVER" in AmiTCP db/netdb.
+          const char *keyword = "nameserver";
+          LONG i = 0;
+
+          while (keyword[i] && tolower((UBYTE)text[i]) == keyword[i]) i++;
+          if (keyword[i] || (text[i] != ' ' && text[i] != '\t')) continue;
+
+          text += i;
+          while (*text == ' ' || *text == '\t') text++;
+
+          // Address up to the end of the line or a comment.
+          char *end = text;
+          while (*end && *end != ' ' && *end != '\t' && *end != '\r' && *end != '\n' && *end != '#' && *end != ';') end++;
+          *end = 0;
+
+          LONG count = _resolver->server_count;
+          if (Resolve_Add_Server(_resolver, text) && _resolver->server_count > count) added++;
+     }
+
+     fclose(file);
+     return added;
+}
+
+BYTE Resolve_Is_Host(const char *_text)
+{
+     LONG length = 0;
+     BYTE letter = 0;
+
+     for (; _text[length]; length++)
+     {
+          UBYTE c = _text[length];
+
+          if (isalpha(c)) letter = 1;
+          else if (!isdigit(c) && c != '-' && c != '.') return 0;
+     }
+
+     // All digits and dots is an address, valid or not.
+     return letter && length < RESOLVE_MAX_HOST;
+}
+
+struct Resolve_Name* Resolve_Add(struct Resolver *_resolver, const char *_host)
+{
+     if (!Resolve_Is_Host(_host)) return NULL;
+
+     // Host names are not case sensitive.
+     for (LONG i = 0; i < _resolver->name_count; i++)
+     {
+          const char *a = _resolver->name[i].host, *b = _host;
+
+          while (*a && tolower((UBYTE)*a) == tolower((UBYTE)*b)) a++, b++;
+          if (*a == 0 && *b == 0) return &_resolver->name[i];
+     }
+
+     if (_resolver->name_count >= RESOLVE_MAX_NAMES) return NULL;
+
+     struct Resolve_Name *name = &_resolver->name[_resolver->name_count++];
+
+     memset(name, 0, sizeof(struct Resolve_Name));
+     strcpy(name->host, _host);
+     name->state = RESOLVE_NAME_NEW;
+     name->socket = NET_NO_SOCKET;
+     name->resolver = _resolver;
+
+     Wheel_Timer_Init(&name->timer, Resolve_Timer, name);
+
+     return name;
+}
+
+static void Resolve_Close(struct Resolve_Name *_name)
+{
+     Net_Close_Socket(_name->socket);
+     _name->socket = NET_NO_SOCKET;
+}
+
+static void Resolve_Succeeded(struct Resolve_Name *_name)
+{
+     Resolve_Close(_name);
+
+     ULONG ttl = _name->found_ttl;
+     if (ttl < RESOLVE_TTL_MIN) ttl = RESOLVE_TTL_MIN;
+     if (ttl > RESOLVE_TTL_MAX) ttl = RESOLVE_TTL_MAX;
+
+     // A family that answered without an address is gone, one that did not answer keeps its old one.
+     UBYTE gone = _name->answered & ~_name->found;
+
+     if (_name->found & (1 << NET_FAMILY_V4)) _name->ip = _name->found_ip;
+     if (_name->found & (1 << NET_FAMILY_V6)) memcpy(_name->ip6, _name->found_ip6, 16);
+     _name->families = (_name->families & ~gone) | _name->found;
+
+     _name->ttl = ttl;
+     _name->state = RESOLVE_NAME_OK;
+     _name->error = RESOLVE_ERROR_NONE;
+     _name->failures = 0;
+     _name->expires = Platform_Time() + (TIME_US)ttl * 1000000;
+
+     Wheel_Add(_name->resolver->wheel, &_name->timer, _name->expires);
+}
+
+static void Resolve_Failed(struct Resolve_Name *_name, BYTE _error)
+{
+     Resolve_Close(_name);
+
+     // The old address is still the best guess - a failed refresh is
+     // more often our own link being down than the name moving.
+     _name->state = _name->families ? RESOLVE_NAME_STALE : RESOLVE_NAME_FAILED;
+     _name->error = _error;
+     _name->lookups_failed++;
+     if (_name->failures < 255) _name->failures++;
+
+     Stats_Count(STATS_LOOKUPS_FAILED);
+
+     TIME_US retry = RESOLVE_RETRY_US;
+     for (UBYTE i = 1; i < _name->failures && retry < RESOLVE_RETRY_MAX_US; i++) retry *= 2;
+     if (retry > RESOLVE_RETRY_MAX_US) retry = RESOLVE_RETRY_MAX_US;
+
+     Wheel_Add(_name->resolver->wheel, &_name->timer, Platform_Time() + retry);
+}
+
+static void Resolve_Query(struct Resolve_Name *_name);
+
+// Next server, or the end of the lookup.
+static void Resolve_Retry(struct Resolve_Name *_name, BYTE _error)
+{
+     Resolve_Close(_name);
+
+     if (++_name->attempt < RESOLVE_ATTEMPTS) Resolve_Query(_name);
+     else Resolve_Failed(_name, _error);
+}
+
+static void Resolve_Query(struct Resolve_Name *_name)
+{
+     struct Resolver *resolver = _name->resolver;
+
+     if (resolver->server_count == 0)
+     {
+          Resolve_Failed(_name, RESOLVE_ERROR_NO_SERVER);
+          return;
+     }
+
+     if (!Net_Open())
+     {
+          Resolve_Failed(_name, RESOLVE_ERROR_NETWORK);
+          return;
+     }
+
+     struct Resolve_Server *server = &resolver->server[_name->attempt % resolver->server_count];
+     BYTE state;
+
+     Stats_Count(STATS_LOOKUPS);
+
+     _name->socket = Net_Udp_Open(server->ip, server->port, &state);
+
+     if (_name->socket == NET_NO_SOCKET || state != NET_CONNECT_DONE)
+     {
+          Resolve_Retry(_name, RESOLVE_ERROR_NETWORK);
+          return;
+     }
+
+     _name->waiting = 0;
+     _name->answered = 0;
+     _name->found = 0;
+     _name->found_ttl = 0xffffffffUL;
+
+     // Both questions on one socket, told apart by their IDs.
+     for (BYTE family = 0; family < NET_FAMILIES; family++)
+     {
+          if (family == NET_FAMILY_V6 && !Net_Ipv6()) continue;
+
+          _name->query_id[family] = Dns_Next_Id();
+
+          LONG length = Dns_Query(resolve_packet, sizeof(resolve_packet), _name->query_id[family], _name->host,
+               family == NET_FAMILY_V6 ? DNS_TYPE_AAAA : DNS_TYPE_A);
+
+          if (length == 0)
+          {
+               Resolve_Failed(_name, RESOLVE_ERROR_NO_NAME);
+               return;
+          }
+
+          if (Net_Send(_name->socket, resolve_packet, length, &state) != length)
+          {
+               Resolve_Retry(_name, state == NET_CONNECT_REFUSED ? RESOLVE_ERROR_SERVER : RESOLVE_ERROR_NETWORK);
+               return;
+          }
+
+          _name->waiting |= 1 << family;
+     }
+
+     Wheel_Add(resolver->wheel, &_name->timer, Platform_Time() + RESOLVE_TIMEOUT_US);
+}
+
+static void Resolve_Lookup(struct Resolve_Name *_name)
+{
+     Resolve_Close(_name);
+
+     _name->attempt = 0;
+     _name->lookups++;
+
+     Resolve_Query(_name);
+}
+
+// Query timed out, or the address is due for a refresh.
+static void Resolve_Timer(struct Wheel_Timer *_timer)
+{
+     struct Resolve_Name *name = (struct Resolve_Name*)_timer->data;
+
+     // Some resolvers drop AAAA questions - an address of the other family is enough.
+     if (name->socket != NET_NO_SOCKET && name->found) Resolve_Succeeded(name);
+     else if (name->socket != NET_NO_SOCKET) Resolve_Retry(name, RESOLVE_ERROR_TIMEOUT);
+     else Resolve_Lookup(name);
+}
+
+void Resolve_Start(struct Resolver *_resolver)
+{
+     TIME_US now = Platform_Time();
+
+     for (LONG i = 0; i < _resolver->name_count; i++)
+     {
+          struct Resolve_Name *name = &_resolver->name[i];
+
+          if (name->socket != NET_NO_SOCKET) continue;
+
+          if (name->state == RESOLVE_NAME_OK && name->expires > now) Wheel_Add(_resolver->wheel, &name->timer, name->expires);
+          else Resolve_Lookup(name);
+     }
+}
+
+void Resolve_Stop(struct Resolver *_resolver)
+{
+     for (LONG i = 0; i < _resolver->name_count; i++)
+     {
+          Wheel_Cancel(_resolver->wheel, &_resolver->name[i].timer);
+          Resolve_Close(&_resolver->name[i]);
+     }
+}
+
+LONG Resolve_Watch(struct Resolver *_resolver, struct Net_Watch *_watch, LONG _max)
+{
+     LONG count = 0;
+
+     for (LONG i = 0; i < _resolver->name_count && count < _max; i++)
+     {
+          if (_resolver->name[i].socket == NET_NO_SOCKET) continue;
+
+          _watch[count].socket = _resolver->name[i].socket;
+          _watch[count].want = NET_EVENT_READ;
+          _watch[count].ready = 0;
+          count++;
+     }
+
+     return count;
+}
+
+static void Resolve_Answer(struct Resolve_Name *_name)
+{
+     BYTE state;
+     LONG length = Net_Receive(_name->socket, resolve_packet, sizeof(resolve_packet), &state);
+
+     if (length < 0)
+     {
+          // Port unreachable - nobody serves DNS there, the next server may.
+          if (state != NET_CONNECT_PENDING) Resolve_Retry(_name, state == NET_CONNECT_REFUSED ? RESOLVE_ERROR_SERVER : RESOLVE_ERROR_NETWORK);
+          return;
+     }
+
+     // Which of the two questions it answers.
+     BYTE family = -1;
+
+     for (BYTE f = 0; f < NET_FAMILIES; f++)
+          if ((_name->waiting & (1 << f)) && Dns_Reply_Code(resolve_packet, length, _name->query_id[f]) >= 0) family = f;
+
+     // Not ours - keep waiting.
+     if (family < 0) return;
+
+     UBYTE address[16];
+     BYTE  found;
+     ULONG ttl;
+     LONG  rcode = Dns_Reply_Address(resolve_packet, length, _name->query_id[family], family == NET_FAMILY_V6 ? DNS_TYPE_AAAA : DNS_TYPE_A,
+          address, &found, &ttl);
+
+     _name->waiting &= ~(1 << family);
+
+     switch (rcode)
+     {
+          case 0:
+               _name->answered |= 1 << family;
+
+               if (found)
+               {
+                    if (family == NET_FAMILY_V6) memcpy(_name->found_ip6, address, 16);
+                    else                         memcpy(&_name->found_ip, address, 4);
+
+                    _name->found |= 1 << family;
+                    if (ttl < _name->found_ttl) _name->found_ttl = ttl;
+               }
+               break;
+
+          case 3:
+               // NXDOMAIN - the other servers would say the same.
+               Resolve_Failed(_name, RESOLVE_ERROR_NO_NAME);
+               return;
+
+          default:
+               // The next server may do better, unless the other question got an address.
+               if (!_name->found)
+               {
+                    Resolve_Retry(_name, RESOLVE_ERROR_SERVER);
+                    return;
+               }
+               break;
+     }
+
+     if (_name->waiting) return;
+
+     if (_name->found) Resolve_Succeeded(_name);
+     else              Resolve_Failed(_name, RESOLVE_ERROR_NO_ADDRESS);
+}
+
+void Resolve_Service(struct Resolver *_resolver, struct Net_Watch *_watch, LONG _count)
+{
+     // Same order as Resolve_Watch() listed them.
+     LONG i = 0;
+
+     for (LONG w = 0; w < _count; w++)
+     {
+          while (i < _resolver->name_count && _resolver->name[i].socket != _watch[w].socket) i++;
+          if (i == _resolver->name_count) break;
+
+          struct Resolve_Name *name = &_resolver->name[i++];
+
+          if (_watch[w].ready) Resolve_Answer(name);
+     }
+}
+
+void Resolve_Abort(struct Resolver *_resolver)
+{
+     for (LONG i = 0; i < _resolver->name_count; i++)
+          if (_resolver->name[i].socket != NET_NO_SOCKET) Resolve_Failed(&_resolver->name[i], RESOLVE_ERROR_NETWORK);
+}
+
+UBYTE Resolve_Address(const struct Resolve_Name *_name, ULONG *_ip, UBYTE *_ip6)
+{
+     if (_name->families & (1 << NET_FAMILY_V4)) *_ip = _name->ip;
+     if (_name->families & (1 << NET_FAMILY_V6)) memcpy(_ip6, _name->ip6, 16);
+
+     return _name->families;
+}
+
+BYTE Resolve_Pending(const struct Resolve_Name *_name)
+{
+     return _name->state == RESOLVE_NAME_NEW && _name->socket != NET_NO_SOCKET;
+}
+
+BYTE Resolve_State(struct Resolver *_resolver)
+{
+     BYTE state = RESOLVE_NAME_OK;
+
+     for (LONG i = 0; i < _resolver->name_count; i++)
+          if (_resolver->name[i].state > state) state = _resolver->name[i].state;
+
+     return state;
+}
+
+const char* Resolve_State_Text(BYTE _state)
+{
+     switch (_state)
+     {
+          case RESOLVE_NAME_OK:         return "OK";
+          case RESOLVE_NAME_NEW:        return "...";
+          case RESOLVE_NAME_STALE:      return "STALE";
+          default:                      return "FAILED";
+     }
+}
+
+const char* Resolve_Error_Text(BYTE _error)
+{
+     switch (_error)
+     {
+          case RESOLVE_ERROR_NONE:        return "none";
+          case RESOLVE_ERROR_TIMEOUT:     return "no answer";
+          case RESOLVE_ERROR_NO_NAME:     return "no such name";
+          case RESOLVE_ERROR_NO_ADDRESS:  return "no address";
+          case RESOLVE_ERROR_SERVER:      return "server failure";
+          case RESOLVE_ERROR_NETWORK:     return "network error";
+          default:                        return "no name server";
+     }
+}
@@ -0,0 +1,137 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - host name cache
+ *
+ * Resolves host name targets off the probe path. Lookups are
+ * our own UDP queries to the name servers (no blocking
+ * gethostbyname()), their sockets go into the same wait set
+ * as the probes and their timeouts and refreshes are timers
+ * on the same wheel. A probe only reads the cached address.
+ *
+ * A name is looked up at start and again when its TTL runs
+ * out - A and, if the stack has IPv6, AAAA in one go. If a
+ * refresh fails, the last known good addresses stay in use
+ * and the name is reported as stale - resolver trouble is
+ * kept apart from the link status.
+ * ---------------------------------------------------------*/
+
+#ifndef RESOLVE_H
+#define RESOLVE_H
+
+#include "platform.h"
+#include "net.h"
+#include "wheel.h"
+
+#define RESOLVE_MAX_NAMES      16
+#define RESOLVE_MAX_SERVERS    3
+#define RESOLVE_MAX_HOST       64
+
+#define RESOLVE_TIMEOUT_US     2000000        // One query.
+#define RESOLVE_ATTEMPTS       3              // Queries per lookup, servers taken in turn.
+#define RESOLVE_TTL_MIN        30             // Seconds - a zero TTL would mean a lookup before every probe.
+#define RESOLVE_TTL_MAX        86400
+#define RESOLVE_RETRY_US       10000000       // After a failed lookup, doubled up to RESOLVE_RETRY_MAX_US.
+#define RESOLVE_RETRY_MAX_US   300000000
+
+// State of a name, from the best to the worst.
+#define RESOLVE_NAME_OK        0
+#define RESOLVE_NAME_NEW       1    // First lookup still running, no address yet.
+#define RESOLVE_NAME_STALE     2    // Refresh failed - the last known good address is used.
+#define RESOLVE_NAME_FAILED    3    // Never resolved.
+
+// Why the latest lookup failed.
+#define RESOLVE_ERROR_NONE       0
+#define RESOLVE_ERROR_TIMEOUT    1    // No server answered.
+#define RESOLVE_ERROR_NO_NAME    2    // NXDOMAIN.
+#define RESOLVE_ERROR_NO_ADDRESS 3    // Name exists, no A or AAAA record.
+#define RESOLVE_ERROR_SERVER     4    // SERVFAIL, refused, port unreachable.
+#define RESOLVE_ERROR_NETWORK    5    // No socket, no route.
+#define RESOLVE_ERROR_NO_SERVER  6    // No name server configured.
+
+struct Resolver;
+
+struct Resolve_Name
+{
+     char    host[RESOLVE_MAX_HOST];
+     ULONG   ip;                 // Last known good addresses, network order.
+     UBYTE   ip6[16];
+     UBYTE   families;           // Bits (1 << NET_FAMILY_*) of the addresses known, 0 - none yet.
+     BYTE    state;              // RESOLVE_NAME_*
+     BYTE    error;              // RESOLVE_ERROR_* of the latest lookup.
+     ULONG   ttl;                // Seconds, as used - clamped to RESOLVE_TTL_MIN..MAX.
+     TIME_US expires;            // When the address is due for a refresh.
+
+     LONG    socket;             // Queries in flight, NET_NO_SOCKET if none.
+     UWORD   query_id[NET_FAMILIES];
+     UBYTE   waiting;            // Families still without a reply.
+     UBYTE   answered;           // Families with a NOERROR reply, with or without address.
+     UBYTE   found;              // Families with an address in the reply.
+     ULONG   found_ip;           // Addresses and TTL of the lookup in flight.
+     UBYTE   found_ip6[16];
+     ULONG   found_ttl;
+     UBYTE   attempt;            // Query of the lookup in flight, 0..RESOLVE_ATTEMPTS-1.
+     UBYTE   failures;           // Failed lookups in a row.
+
+     ULONG   lookups;
+     ULONG   lookups_failed;
+
+     struct Wheel_Timer  timer;  // Query timeout while in flight, refresh or retry otherwise.
+     struct Resolver    *resolver;
+};
+
+struct Resolve_Server
+{
+     ULONG ip;
+     UWORD port;
+};
+
+struct Resolver
+{
+     struct Resolve_Name   name[RESOLVE_MAX_NAMES];
+     LONG                  name_count;
+     struct Resolve_Server server[RESOLVE_MAX_SERVERS];
+     LONG                  server_count;
+     struct Wheel         *wheel;
+};
+
+void Resolve_Init(struct Resolver *_resolver, struct Wheel *_wheel);
+
+// Adds a name server, "ip[:port]". Returns 0 if not valid or there are too many.
+BYTE Resolve_Add_Server(struct Resolver *_resolver, const char *_text);
+
+// Adds the servers from "nameserver ip" lines, in any case - /etc/resolv.conf,
+// Roadshow DEVS:Internet/name_resolution, AmiTCP db/netdb. Returns number added.
+LONG Resolve_Read_Servers(struct Resolver *_resolver, const char *_path);
+
+// Returns 1 if _text looks like a host name, not an address.
+BYTE Resolve_Is_Host(const char *_text);
+
+// Cache entry for the host name, the same one for the same name. NULL if the cache is full.
+struct Resolve_Name* Resolve_Add(struct Resolver *_resolver, const char *_host);
+
+// Looks up every name that has no address or is due, the others get their refresh timer.
+void Resolve_Start(struct Resolver *_resolver);
+
+// Drops the queries in flight and the timers. Addresses are kept.
+void Resolve_Stop(struct Resolver *_resolver);
+
+// Sockets of the queries in flight, and their readiness reported by Net_Wait().
+LONG Resolve_Watch(struct Resolver *_resolver, struct Net_Watch *_watch, LONG _max);
+void Resolve_Service(struct Resolver *_resolver, struct Net_Watch *_watch, LONG _count);
+
+// Fails the queries in flight right now, for example when waiting for their sockets failed.
+void Resolve_Abort(struct Resolver *_resolver);
+
+// Addresses to probe, fresh or last known good. Returns their family bits, 0 if there is none.
+UBYTE Resolve_Address(const struct Resolve_Name *_name, ULONG *_ip, UBYTE *_ip6);
+
+// Returns 1 while the first lookup of the name is still running.
+BYTE Resolve_Pending(const struct Resolve_Name *_name);
+
+// The worst RESOLVE_NAME_* of all names, RESOLVE_NAME_OK if there are none.
+BYTE Resolve_State(struct Resolver *_resolver);
+
+// Human readable RESOLVE_NAME_* and RESOLVE_ERROR_*.
+const char* Resolve_State_Text(BYTE _state);
+const char* Resolve_Error_Text(BYTE _error);
+
+#endif
@@ -0,0 +1,105 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - round trip times
+ * ---------------------------------------------------------*/
+
+#include "rtt.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void Rtt_Init(struct Rtt_Window *_window)
+{
+     memset(_window, 0, sizeof(struct Rtt_Window));
+}
+
+// Position of the first value >= _micro in the sorted part.
+static LONG Rtt_Find(struct Rtt_Window *_window, ULONG _micro)
+{
+     LONG low = 0, high = _window->count;
+
+     while (low < high)
+     {
+          LONG middle = (low + high) / 2;
+
+          if (_window->sorted[middle] < _micro) low = middle + 1;
+          else                                  high = middle;
+     }
+
+     return low;
+}
+
+void Rtt_Add(struct Rtt_Window *_window, ULONG _micro)
+{
+     // Gains of 1/8 and 1/4 as in TCP, shifts only.
+     if (_window->count == 0)
+     {
+          _window->srtt = _micro;
+          _window->rttvar = _micro / 2;
+     }
+     else
+     {
+          ULONG error = _window->srtt > _micro ? _window->srtt - _micro : _micro - _window->srtt;
+
+          _window->rttvar = _window->rttvar - (_window->rttvar >> 2) + (error >> 2);
+          _window->srtt = _window->srtt - (_window->srtt >> 3) + (_micro >> 3);
+     }
+
+     // Window full - the oldest sample leaves the sorted copy first.
+     if (_window->count == RTT_WINDOW_SIZE)
+     {
+          LONG old = Rtt_Find(_window, _window->ring[_window->next]);
+
+          memmove(&_window->sorted[old], &_window->sorted[old + 1], (_window->count - old - 1) * sizeof(ULONG));
+          _window->count--;
+     }
+
+     LONG position = Rtt_Find(_window, _micro);
+
+     memmove(&_window->sorted[position + 1], &_window->sorted[position], (_window->count - position) * sizeof(ULONG));
+     _window->sorted[position] = _micro;
+     _window->count++;
+
+     _window->ring[_window->next] = _micro;
+     _window->next = (_window->next + 1) % RTT_WINDOW_SIZE;
+
+     _window->last = _micro;
+}
+
+ULONG Rtt_Percentile(struct Rtt_Window *_window, LONG _percent)
+{
+     if (_window->count == 0) return 0;
+
+     LONG rank = (_percent * _window->count + 99) / 100;
+     if (rank < 1) rank = 1;
+
+     return _window->sorted[rank - 1];
+}
+
+ULONG Rtt_Max(struct Rtt_Window *_window)
+{
+     if (_window->count == 0) return 0;
+
+     return _window->sorted[_window->count - 1];
+}
+
+ULONG Rtt_Timeout(struct Rtt_Window *_window)
+{
+     if (_window->count == 0) return 0;
+
+     ULONG timeout = _window->srtt + 4 * _window->rttvar;
+
+     // Only the answer that decided a probe becomes a sample - with targets
+     // racing that is the fastest one, so the variance alone runs low.
+     // The slowest answer still in the window has to fit as well.
+     if (timeout < Rtt_Max(_window) + _window->rttvar) timeout = Rtt_Max(_window) + _window->rttvar;
+
+     return timeout;
+}
+
+void Rtt_Format(ULONG _micro, char *_buffer)
+{
+     // Rounded to 0.1 ms, integer only - no float formatting needed on 68k.
+     ULONG tenths = (_micro + 50) / 100;
+
+     sprintf(_buffer, "%lu.%lu", (unsigned long)(tenths / 10), (unsigned long)(tenths % 10));
+}
@@ -0,0 +1,46 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - round trip times
+ *
+ * Keeps a fixed ring of recent RTTs next to a sorted copy of
+ * the same values. A new sample replaces the oldest one in both,
+ * so percentiles are a plain index - no sorting on every tick.
+ *
+ * Also keeps the smoothed RTT and its variance the way TCP does
+ * (RFC 6298), for a probe timeout that follows the real path.
+ * ---------------------------------------------------------*/
+
+#ifndef RTT_H
+#define RTT_H
+
+#include "platform.h"
+
+#define RTT_WINDOW_SIZE       32
+
+struct Rtt_Window
+{
+     ULONG ring[RTT_WINDOW_SIZE];       // Microseconds, in arrival order.
+     ULONG sorted[RTT_WINDOW_SIZE];     // Same values, ascending.
+     LONG  count;
+     LONG  next;                        // Ring slot the next sample goes to.
+     ULONG last;
+
+     ULONG srtt;                        // Smoothed RTT, microseconds.
+     ULONG rttvar;                      // Its mean deviation.
+};
+
+void  Rtt_Init(struct Rtt_Window *_window);
+void  Rtt_Add(struct Rtt_Window *_window, ULONG _micro);
+
+// Nearest-rank percentile (0..100) of the window, 0 if there are no samples.
+ULONG Rtt_Percentile(struct Rtt_Window *_window, LONG _percent);
+ULONG Rtt_Max(struct Rtt_Window *_window);
+
+// SRTT + 4 * RTTVAR in microseconds, at least the slowest sample in the window
+// plus RTTVAR. 0 if there are no samples.
+ULONG Rtt_Timeout(struct Rtt_Window *_window);
+
+// Formats microseconds as milliseconds with one decimal, for example "23.4".
+// The buffer should have room for 16 chars.
+void  Rtt_Format(ULONG _micro, char *_buffer);
+
+#endif
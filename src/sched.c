@@ -0,0 +1,83 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - adaptive probe scheduling
+ * ---------------------------------------------------------*/
+
+#include "sched.h"
+
+void Sched_Init(struct Sched *_sched, ULONG _base_ms, ULONG _ceiling_ms, ULONG _confirm_ms, LONG _jitter_percent)
+{
+     if (_ceiling_ms < _base_ms) _ceiling_ms = _base_ms;
+     if (_confirm_ms > _base_ms) _confirm_ms = _base_ms;
+
+     _sched->base_ms = _base_ms;
+     _sched->ceiling_ms = _ceiling_ms;
+     _sched->confirm_ms = _confirm_ms;
+     _sched->jitter_percent = _jitter_percent;
+
+     // Seeded from the clock, so machines started at the same time still differ.
+     _sched->random = (ULONG)Platform_Time() | 1;
+
+     Sched_Reset(_sched);
+}
+
+void Sched_Reset(struct Sched *_sched)
+{
+     _sched->interval_ms = _sched->base_ms;
+     _sched->last_result = -1;
+     _sched->confirming = 0;
+     _sched->stable_count = 0;
+}
+
+// xorshift32 - cheap and good enough to spread probes apart.
+static ULONG Sched_Random(struct Sched *_sched)
+{
+     ULONG x = _sched->random;
+
+     x ^= x << 13;
+     x ^= x >> 17;
+     x ^= x << 5;
+
+     _sched->random = x;
+     return x;
+}
+
+static ULONG Sched_Jitter(struct Sched *_sched, ULONG _interval_ms)
+{
+     ULONG range = _interval_ms / 100 * _sched->jitter_percent + _interval_ms % 100 * _sched->jitter_percent / 100;
+     if (range == 0) return _interval_ms;
+
+     // Uniform in [interval - range, interval + range].
+     return _interval_ms - range + Sched_Random(_sched) % (2 * range + 1);
+}
+
+ULONG Sched_Next(struct Sched *_sched, BYTE _result)
+{
+     if (_sched->last_result != -1 && _result != _sched->last_result)
+     {
+          // Something changed - check again soon and start from the base interval.
+          _sched->last_result = _result;
+          _sched->confirming = 1;
+          _sched->stable_count = 1;
+          _sched->interval_ms = _sched->base_ms;
+
+          return Sched_Jitter(_sched, _sched->confirm_ms);
+     }
+
+     if (_sched->last_result == -1 || _sched->confirming)
+     {
+          // First result or the change is confirmed - normal pace.
+          _sched->last_result = _result;
+          _sched->confirming = 0;
+          _sched->interval_ms = _sched->base_ms;
+     }
+     else
+     {
+          // Same as before - back off towards the ceiling.
+          _sched->interval_ms *= 2;
+          if (_sched->interval_ms > _sched->ceiling_ms) _sched->interval_ms = _sched->ceiling_ms;
+     }
+
+     _sched->stable_count++;
+
+     return Sched_Jitter(_sched, _sched->interval_ms);
+}
@@ -0,0 +1,39 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - adaptive probe scheduling
+ *
+ * While results stay the same the interval doubles from
+ * TIME_INTERVAL up to TIME_INTERVAL_MAX. A result that differs
+ * from the previous one is re-checked after the short
+ * CONFIRM_INTERVAL, and the interval starts from the base
+ * again. Every interval gets random jitter, so many machines
+ * started together don't probe in step.
+ * ---------------------------------------------------------*/
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include "platform.h"
+
+struct Sched
+{
+     ULONG base_ms;           // TIME_INTERVAL
+     ULONG ceiling_ms;        // TIME_INTERVAL_MAX
+     ULONG confirm_ms;        // CONFIRM_INTERVAL
+     LONG  jitter_percent;    // JITTER, +/- percent of the interval.
+
+     ULONG interval_ms;       // Current interval without jitter.
+     BYTE  last_result;       // -1 unknown, 0 offline, 1 online.
+     BYTE  confirming;        // Last result differed, next probe confirms it.
+     ULONG stable_count;      // Results in a row equal to last_result.
+     ULONG random;
+};
+
+void  Sched_Init(struct Sched *_sched, ULONG _base_ms, ULONG _ceiling_ms, ULONG _confirm_ms, LONG _jitter_percent);
+
+// Forgets the history - the next result is taken as the first one.
+void  Sched_Reset(struct Sched *_sched);
+
+// Feeds the result of a probe, returns milliseconds to the next probe.
+ULONG Sched_Next(struct Sched *_sched, BYTE _result);
+
+#endif
@@ -0,0 +1,351 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - status sharing on the LAN
+ * ---------------------------------------------------------*/
+
+#include "share.h"
+#include "stats.h"
+
+#include <string.h>
+
+// "msIS", version, type, status, raw status, IPv4 and IPv6 status, two spare bytes,
+// then id, group, probes and RTT as big endian longs - the same on m68k and x86.
+#define SHARE_MAGIC              "msIS"
+#define SHARE_VERSION            1
+#define SHARE_PACKET_SIZE        28
+
+// Status byte of "unknown".
+#define SHARE_UNKNOWN            0xff
+
+static void Share_Put_Long(UBYTE *_buffer, ULONG _value)
+{
+     _buffer[0] = (UBYTE)(_value >> 24);
+     _buffer[1] = (UBYTE)(_value >> 16);
+     _buffer[2] = (UBYTE)(_value >> 8);
+     _buffer[3] = (UBYTE)_value;
+}
+
+static ULONG Share_Get_Long(const UBYTE *_buffer)
+{
+     return ((ULONG)_buffer[0] << 24) | ((ULONG)_buffer[1] << 16) | ((ULONG)_buffer[2] << 8) | _buffer[3];
+}
+
+static UBYTE Share_Put_Status(BYTE _status)
+{
+     return _status < 0 ? SHARE_UNKNOWN : (UBYTE)_status;
+}
+
+static BYTE Share_Get_Status(UBYTE _status)
+{
+     return _status == SHARE_UNKNOWN ? -1 : _status != 0;
+}
+
+// FNV-1a over what decides the status - copies watching other targets must not follow us.
+static ULONG Share_Hash(ULONG _hash, const void *_data, LONG _length)
+{
+     const UBYTE *data = (const UBYTE*)_data;
+
+     for (LONG i = 0; i < _length; i++) _hash = (_hash ^ data[i]) * 16777619UL;
+
+     return _hash;
+}
+
+static ULONG Share_Group(struct Monitor *_monitor)
+{
+     struct Probe *probe = &_monitor->probe;
+     ULONG hash = 2166136261UL;
+     UBYTE settings[2];
+
+     settings[0] = (UBYTE)probe->policy;
+     settings[1] = (UBYTE)probe->quorum;
+     hash = Share_Hash(hash, settings, 2);
+
+     for (LONG i = 0; i < probe->target_count; i++)
+     {
+          struct Probe_Target *target = &probe->target[i];
+          UBYTE port[5];
+
+          // A name, not the address it has now - that changes with the TTL.
+          if (target->name) hash = Share_Hash(hash, target->name->host, strlen(target->name->host));
+          else
+          {
+               hash = Share_Hash(hash, &target->ip, 4);
+               hash = Share_Hash(hash, target->ip6, 16);
+          }
+
+          port[0] = (UBYTE)(target->port >> 8);
+          port[1] = (UBYTE)target->port;
+          port[2] = (UBYTE)target->type;
+          port[3] = (UBYTE)(target->expect >> 8);
+          port[4] = (UBYTE)target->expect;
+
+          hash = Share_Hash(hash, port, 5);
+          hash = Share_Hash(hash, target->path, strlen(target->path));
+     }
+
+     return hash;
+}
+
+static void Share_Expired(struct Wheel_Timer *_timer);
+
+void Share_Init(struct Share *_share, struct Monitor *_monitor, ULONG _address, UWORD _port, ULONG _heartbeat_ms, ULONG _id, struct Wheel *_wheel)
+{
+     memset(_share, 0, sizeof(struct Share));
+
+     _share->monitor = _monitor;
+     _share->wheel = _wheel;
+     _share->socket = NET_NO_SOCKET;
+     _share->address = _address;
+     _share->port = _port;
+     _share->id = _id ? _id : 1;
+     _share->group = Share_Group(_monitor);
+     _share->heartbeat_us = (_heartbeat_ms ? _heartbeat_ms : 1000) * 1000;
+     _share->role = SHARE_ROLE_NONE;
+
+     Wheel_Timer_Init(&_share->timer, Share_Expired, _share);
+}
+
+// Returns 1 if the socket belongs to the current session - a closed one took it along.
+static BYTE Share_Socket_Valid(struct Share *_share)
+{
+     return _share->socket != NET_NO_SOCKET && _share->open_count == Net_Open_Count() && Net_Is_Open();
+}
+
+// Opens the socket again after the stack was restarted.
+static BYTE Share_Socket(struct Share *_share)
+{
+     if (Share_Socket_Valid(_share)) return 1;
+
+     _share->socket = NET_NO_SOCKET;
+
+     if (!Net_Open()) return 0;
+
+     _share->socket = Net_Udp_Bind(_share->port);
+     _share->open_count = Net_Open_Count();
+
+     return _share->socket != NET_NO_SOCKET;
+}
+
+static void Share_Send(struct Share *_share, BYTE _type)
+{
+     struct Monitor *monitor = _share->monitor;
+     UBYTE packet[SHARE_PACKET_SIZE];
+     BYTE state;
+
+     // The heartbeat goes on without a socket - it is opened again with the next one.
+     if (_type == SHARE_TYPE_STATUS)
+     {
+          _share->sent = Platform_Time();
+          Wheel_Add(_share->wheel, &_share->timer, _share->sent + _share->heartbeat_us);
+     }
+
+     if (!Share_Socket(_share)) return;
+
+     memset(packet, 0, sizeof(packet));
+     memcpy(packet, SHARE_MAGIC, 4);
+     packet[4] = SHARE_VERSION;
+     packet[5] = (UBYTE)_type;
+     packet[6] = Share_Put_Status(monitor->status);
+     packet[7] = Share_Put_Status(monitor->raw_status);
+     packet[8] = Share_Put_Status(monitor->family_status[NET_FAMILY_V4]);
+     packet[9] = Share_Put_Status(monitor->family_status[NET_FAMILY_V6]);
+     Share_Put_Long(packet + 12, _share->id);
+     Share_Put_Long(packet + 16, _share->group);
+     Share_Put_Long(packet + 20, monitor->probe_count);
+     Share_Put_Long(packet + 24, monitor->raw_status > 0 ? monitor->rtt.last : 0);
+
+     if (Net_Send_To(_share->socket, _share->address, _share->port, packet, sizeof(packet), &state) == (LONG)sizeof(packet))
+          Stats_Count(STATS_SHARE_SENT);
+}
+
+// Takeover time after the leader was last heard - a later one for a higher id, so the
+// followers don't all take over at once.
+static void Share_Wait_Leader(struct Share *_share, TIME_US _seen, ULONG _beats)
+{
+     TIME_US stagger = (TIME_US)(_share->id % 1024) * _share->heartbeat_us / 1024;
+
+     _share->leader_seen = _seen;
+     Wheel_Add(_share->wheel, &_share->timer, _seen + (TIME_US)_beats * _share->heartbeat_us + stagger);
+}
+
+static void Share_Follow(struct Share *_share)
+{
+     if (_share->role == SHARE_ROLE_LEADER) Monitor_Stop(_share->monitor);
+
+     _share->role = SHARE_ROLE_FOLLOWER;
+}
+
+static void Share_Lead(struct Share *_share)
+{
+     _share->role = SHARE_ROLE_LEADER;
+     _share->leader_id = _share->id;
+     _share->leader_ip = 0;
+     Stats_Count(STATS_SHARE_TAKEOVERS);
+
+     // What we showed last goes out right away, so the other followers stop waiting.
+     Share_Send(_share, SHARE_TYPE_STATUS);
+
+     // Our first probe is due now.
+     Monitor_Start(_share->monitor);
+}
+
+static void Share_Expired(struct Wheel_Timer *_timer)
+{
+     struct Share *share = (struct Share*)_timer->data;
+
+     if (share->role == SHARE_ROLE_LEADER) Share_Send(share, SHARE_TYPE_STATUS);
+     else if (share->role == SHARE_ROLE_FOLLOWER) Share_Lead(share);
+}
+
+BYTE Share_Start(struct Share *_share)
+{
+     Share_Stop(_share);
+
+     // Without a socket nobody hears us - probe alone, and try again with every heartbeat.
+     if (!Share_Socket(_share))
+     {
+          _share->role = SHARE_ROLE_LEADER;
+          _share->leader_id = _share->id;
+          Wheel_Add(_share->wheel, &_share->timer, Platform_Time() + _share->heartbeat_us);
+          return 0;
+     }
+
+     Monitor_Stop(_share->monitor);
+     _share->role = SHARE_ROLE_FOLLOWER;
+     _share->leader_id = 0;
+
+     Share_Send(_share, SHARE_TYPE_HELLO);
+     Share_Wait_Leader(_share, Platform_Time(), SHARE_TAKEOVER_BEATS);
+
+     return 1;
+}
+
+void Share_Stop(struct Share *_share)
+{
+     if (_share->role == SHARE_ROLE_NONE) return;
+
+     if (_share->role == SHARE_ROLE_LEADER && Share_Socket_Valid(_share)) Share_Send(_share, SHARE_TYPE_BYE);
+
+     Wheel_Cancel(_share->wheel, &_share->timer);
+
+     // Gone with its session otherwise.
+     if (Share_Socket_Valid(_share)) Net_Close_Socket(_share->socket);
+
+     _share->socket = NET_NO_SOCKET;
+     _share->role = SHARE_ROLE_NONE;
+     _share->leader_id = 0;
+}
+
+LONG Share_Watch(struct Share *_share, struct Net_Watch *_watch, LONG _max)
+{
+     // Not opened again here - a follower takes over when it hears nothing, a leader
+     // opens it with the next heartbeat.
+     if (_share->role == SHARE_ROLE_NONE || _max < 1 || !Share_Socket_Valid(_share)) return 0;
+
+     _watch[0].socket = _share->socket;
+     _watch[0].want = NET_EVENT_READ;
+
+     return 1;
+}
+
+// Status of the leader as if our own probe had ended with it.
+static void Share_Adopt(struct Share *_share, const UBYTE *_packet, ULONG _ip)
+{
+     struct Monitor *monitor = _share->monitor;
+     ULONG id = Share_Get_Long(_packet + 12);
+     ULONG probes = Share_Get_Long(_packet + 20);
+     ULONG rtt = Share_Get_Long(_packet + 24);
+
+     // Heartbeats repeat the same probe - only a new one is a sample, and worth publishing.
+     BYTE changed = id != _share->leader_id || probes != _share->leader_probes;
+
+     if (monitor->status != Share_Get_Status(_packet[6])) changed = 1;
+
+     monitor->status = Share_Get_Status(_packet[6]);
+     monitor->raw_status = Share_Get_Status(_packet[7]);
+     monitor->family_status[NET_FAMILY_V4] = Share_Get_Status(_packet[8]);
+     monitor->family_status[NET_FAMILY_V6] = Share_Get_Status(_packet[9]);
+
+     if (changed && monitor->raw_status > 0 && rtt) Rtt_Add(&monitor->rtt, rtt);
+
+     _share->leader_id = id;
+     _share->leader_ip = _ip;
+     _share->leader_probes = probes;
+
+     Share_Wait_Leader(_share, Platform_Time(), SHARE_TAKEOVER_BEATS);
+
+     if (changed && monitor->status >= 0) Platform_Publish(monitor);
+}
+
+static void Share_Receive(struct Share *_share, const UBYTE *_packet, ULONG _ip)
+{
+     ULONG id = Share_Get_Long(_packet + 12);
+     BYTE type = (BYTE)_packet[5];
+
+     // Our own broadcast comes back too.
+     if (id == _share->id || Share_Get_Long(_packet + 16) != _share->group) return;
+
+     Stats_Count(STATS_SHARE_RECEIVED);
+
+     if (_share->role == SHARE_ROLE_LEADER)
+     {
+          if (type == SHARE_TYPE_HELLO) Share_Send(_share, SHARE_TYPE_STATUS);
+
+          // Two leaders - the lower id stays, ours goes out at once so the other one hears it.
+          if (type == SHARE_TYPE_STATUS)
+          {
+               if (id > _share->id) Share_Send(_share, SHARE_TYPE_STATUS);
+               else
+               {
+                    Share_Follow(_share);
+                    Share_Adopt(_share, _packet, _ip);
+               }
+          }
+
+          return;
+     }
+
+     // A second leader with a higher id is about to give up - unless ours went quiet, then it took over.
+     if (type == SHARE_TYPE_STATUS && (_share->leader_id == 0 || id <= _share->leader_id || Platform_Time() - _share->leader_seen > _share->heartbeat_us))
+          Share_Adopt(_share, _packet, _ip);
+
+     // Leader gone - take over after the stagger only.
+     if (type == SHARE_TYPE_BYE && id == _share->leader_id) Share_Wait_Leader(_share, Platform_Time(), 0);
+}
+
+void Share_Service(struct Share *_share, struct Net_Watch *_watch, LONG _count)
+{
+     if (_count < 1 || !(_watch[0].ready & (NET_EVENT_READ | NET_EVENT_ERROR))) return;
+
+     // Everything that is waiting - a datagram left behind would show up only with the next one.
+     for (;;)
+     {
+          UBYTE packet[SHARE_PACKET_SIZE + 4];
+          ULONG ip = 0;
+          BYTE state = NET_CONNECT_PENDING;
+
+          LONG length = Net_Receive_From(_share->socket, packet, sizeof(packet), &ip, &state);
+
+          // ICMP error of an earlier broadcast - not for us, the next one may be.
+          if (length < 0 && state == NET_CONNECT_REFUSED) continue;
+          if (length < 0) break;
+
+          if (length == SHARE_PACKET_SIZE && memcmp(packet, SHARE_MAGIC, 4) == 0 && packet[4] == SHARE_VERSION) Share_Receive(_share, packet, ip);
+
+          if (_share->role == SHARE_ROLE_NONE) break;
+     }
+}
+
+void Share_Publish(struct Share *_share)
+{
+     if (_share->role == SHARE_ROLE_LEADER) Share_Send(_share, SHARE_TYPE_STATUS);
+}
+
+const char* Share_Role_Text(BYTE _role)
+{
+     switch (_role)
+     {
+          case SHARE_ROLE_FOLLOWER:     return "follower";
+          case SHARE_ROLE_LEADER:       return "leader";
+          default:                      return "-";
+     }
+}
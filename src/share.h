@@ -0,0 +1,84 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - status sharing on the LAN
+ *
+ * Copies on the same subnet watching the same targets need
+ * only one of them to probe. They talk over UDP broadcast:
+ * the leader sends its status after every probe and at
+ * least once a heartbeat, followers stop their own probes
+ * and publish what the leader sent.
+ *
+ * The copy with the lowest id leads. A new copy starts as a
+ * follower and says hello, the leader answers right away.
+ * When no status came for SHARE_TAKEOVER_BEATS heartbeats a
+ * follower takes over - each one waits a bit longer, by its
+ * id, so usually only one does. Two leaders that hear each
+ * other settle it by the id as well.
+ *
+ * Only copies with the same targets and policy share - a
+ * hash of them goes with every datagram.
+ * ---------------------------------------------------------*/
+
+#ifndef SHARE_H
+#define SHARE_H
+
+#include "platform.h"
+#include "monitor.h"
+
+#define SHARE_PORT               4810
+
+// Heartbeats without a status before a follower takes over, plus up to one more by its id.
+#define SHARE_TAKEOVER_BEATS     3
+
+#define SHARE_ROLE_NONE          0    // Not started - also a Share that was never initialized.
+#define SHARE_ROLE_FOLLOWER      1
+#define SHARE_ROLE_LEADER        2
+
+// Datagram types.
+#define SHARE_TYPE_HELLO         0    // New copy - the leader answers with its status.
+#define SHARE_TYPE_STATUS        1    // From the leader.
+#define SHARE_TYPE_BYE           2    // Leader leaving - no need to wait for the takeover.
+
+struct Share
+{
+     struct Monitor     *monitor;      // Probes while leading, fed by the leader while following.
+     struct Wheel       *wheel;
+     struct Wheel_Timer  timer;        // Leader - next heartbeat, follower - takeover.
+
+     LONG    socket;
+     ULONG   open_count;               // Net_Open_Count() of the socket - a new session needs a new one.
+     ULONG   address;                  // Broadcast address, network order.
+     UWORD   port;
+     ULONG   id;                       // Ours - the lowest one leads.
+     ULONG   group;                    // Hash of the targets and policy.
+     ULONG   heartbeat_us;
+
+     BYTE    role;                     // SHARE_ROLE_*
+     ULONG   leader_id;                // Follower - whose status is shown, 0 none yet.
+     ULONG   leader_ip;
+     ULONG   leader_probes;            // Probes of the leader at its latest status - a new one is a new RTT sample.
+     TIME_US leader_seen;
+     TIME_US sent;                     // Leader - latest status sent.
+};
+
+// Shares the status of _monitor with the copies listening on _address:_port. _id
+// should differ between copies - a random number, 0 is taken as 1.
+void Share_Init(struct Share *_share, struct Monitor *_monitor, ULONG _address, UWORD _port, ULONG _heartbeat_ms, ULONG _id, struct Wheel *_wheel);
+
+// Starts as a follower - call it after Monitor_Start(), the monitor stops until this
+// copy leads. Returns 0 if the socket can't be opened, the monitor then probes alone.
+BYTE Share_Start(struct Share *_share);
+
+// Says bye when leading and closes the socket. The monitor is left as it is.
+void Share_Stop(struct Share *_share);
+
+// Same as Probe_Watch() and Probe_Service() for the socket.
+LONG Share_Watch(struct Share *_share, struct Net_Watch *_watch, LONG _max);
+void Share_Service(struct Share *_share, struct Net_Watch *_watch, LONG _count);
+
+// Sends the status of the monitor when leading. Called from Platform_Publish().
+void Share_Publish(struct Share *_share);
+
+// Human readable SHARE_ROLE_* - "leader", "follower".
+const char* Share_Role_Text(BYTE _role);
+
+#endif
@@ -0,0 +1,126 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - warm start snapshot
+ * ---------------------------------------------------------*/
+
+#include "snapshot.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static ULONG Snapshot_Check(const struct Snapshot_State *_state)
+{
+     return (_state->time ^ 0x5a5a5a5aUL) + (ULONG)_state->status * 7 + _state->rtt + _state->srtt * 3 + _state->rttvar * 5 + _state->timeout_backoff;
+}
+
+void Snapshot_Init(struct Snapshot *_snapshot, const char *_path)
+{
+     memset(_snapshot, 0, sizeof(struct Snapshot));
+
+     // Room for ".new" after it.
+     if (_path && strlen(_path) < SNAPSHOT_PATH_SIZE - 5) strcpy(_snapshot->path, _path);
+}
+
+BYTE Snapshot_Load(struct Snapshot *_snapshot, struct Monitor *_monitor, ULONG _now, ULONG *_age)
+{
+     struct Snapshot_State state;
+     unsigned long time, rtt, srtt, rttvar, check;
+     int version, status, backoff;
+
+     *_age = 0;
+     if (!_snapshot->path[0]) return -1;
+
+     FILE *file = fopen(_snapshot->path, "r");
+     if (file == NULL) return -1;
+
+     int fields = fscanf(file, "msInternetStatus %d %lu %d %lu %lu %lu %d %lu", &version, &time, &status, &rtt, &srtt, &rttvar, &backoff, &check);
+     fclose(file);
+
+     if (fields != 8 || version != SNAPSHOT_VERSION || status < 0 || status > 1 || backoff < 0 || backoff > MONITOR_TIMEOUT_BACKOFF_MAX) return -1;
+
+     state.time = time;
+     state.status = (BYTE)status;
+     state.rtt = rtt;
+     state.srtt = srtt;
+     state.rttvar = rttvar;
+     state.timeout_backoff = (UBYTE)backoff;
+
+     // Half written or edited by hand.
+     if (Snapshot_Check(&state) != check) return -1;
+
+     _snapshot->saved = state;
+
+     // One sample of the smoothed RTT makes Rtt_Timeout() work from the first probe.
+     if (_monitor->rtt.count == 0 && state.srtt)
+     {
+          Rtt_Add(&_monitor->rtt, state.srtt);
+          _monitor->rtt.srtt = state.srtt;
+          _monitor->rtt.rttvar = state.rttvar;
+          _monitor->rtt.last = state.rtt;
+     }
+     _monitor->timeout_backoff = state.timeout_backoff;
+
+     // A clock set back makes it look new - it is still the latest status there is.
+     *_age = _now > state.time ? _now - state.time : 0;
+
+     return *_age <= SNAPSHOT_MAX_AGE ? state.status : -1;
+}
+
+BYTE Snapshot_Save(struct Snapshot *_snapshot, struct Monitor *_monitor, ULONG _now)
+{
+     if (!_snapshot->path[0] || _monitor->status < 0) return 0;
+
+     struct Snapshot_State state;
+     char temp_path[SNAPSHOT_PATH_SIZE];
+
+     state.time = _now;
+     state.status = _monitor->status;
+     state.rtt = _monitor->rtt.last;
+     state.srtt = _monitor->rtt.srtt;
+     state.rttvar = _monitor->rtt.rttvar;
+     state.timeout_backoff = _monitor->timeout_backoff;
+
+     strcpy(temp_path, _snapshot->path);
+     strcat(temp_path, ".new");
+
+     FILE *file = fopen(temp_path, "w");
+     if (file == NULL)
+     {
+          _snapshot->failures++;
+          return 0;
+     }
+
+     BYTE written = fprintf(file, "msInternetStatus %d %lu %d %lu %lu %lu %d %lu\n", SNAPSHOT_VERSION, (unsigned long)state.time, state.status,
+          (unsigned long)state.rtt, (unsigned long)state.srtt, (unsigned long)state.rttvar, state.timeout_backoff, (unsigned long)Snapshot_Check(&state)) > 0;
+     if (fclose(file) != 0) written = 0;
+
+     // Not every file system renames over an existing file.
+     if (written && rename(temp_path, _snapshot->path) != 0)
+     {
+          remove(_snapshot->path);
+          written = rename(temp_path, _snapshot->path) == 0;
+     }
+
+     if (!written)
+     {
+          remove(temp_path);
+          _snapshot->failures++;
+          return 0;
+     }
+
+     _snapshot->saved = state;
+     _snapshot->saves++;
+
+     return 1;
+}
+
+void Snapshot_Update(struct Snapshot *_snapshot, struct Monitor *_monitor, ULONG _now)
+{
+     if (!_snapshot->path[0] || _monitor->status < 0) return;
+
+     // A clock set back counts as due.
+     ULONG since = _now >= _snapshot->saved.time ? _now - _snapshot->saved.time : SNAPSHOT_REFRESH_SECONDS;
+
+     // A change left waiting by the throttle goes out with the first probe after it.
+     if ((_monitor->status != _snapshot->saved.status && since >= SNAPSHOT_SAVE_SECONDS) || since >= SNAPSHOT_REFRESH_SECONDS)
+          Snapshot_Save(_snapshot, _monitor, _now);
+}
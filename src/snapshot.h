@@ -0,0 +1,70 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - warm start snapshot
+ *
+ * Until the first probe after a reboot finishes the status
+ * is "...", and scripts started with the system read that.
+ * The snapshot keeps the last confirmed status with the RTT
+ * estimate and the timeout backoff in a small file (ENVARC:
+ * on Amiga), so the next start shows it at once - marked as
+ * stale - while the first probe goes out as usual.
+ *
+ * One text line, readable with Type or cat:
+ *
+ *   msInternetStatus 1 <time> <status> <rtt> <srtt> <rttvar> <backoff> <check>
+ *
+ * Written to a .new file first and renamed over the old one.
+ * A change of the status is saved at most once in
+ * SNAPSHOT_SAVE_SECONDS, the RTT once in SNAPSHOT_REFRESH_SECONDS,
+ * and everything when the monitor stops.
+ * ---------------------------------------------------------*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "platform.h"
+#include "monitor.h"
+
+#define SNAPSHOT_VERSION           1
+
+#define SNAPSHOT_SAVE_SECONDS      60
+#define SNAPSHOT_REFRESH_SECONDS   3600
+
+// An older status is not shown - the RTT estimate is still taken.
+#define SNAPSHOT_MAX_AGE           86400
+
+#define SNAPSHOT_PATH_SIZE         256
+
+struct Snapshot_State
+{
+     ULONG time;              // Seconds since 1970 by the machine clock.
+     BYTE  status;            // Published status, 0 offline, 1 online.
+     ULONG rtt;               // Latest RTT, microseconds.
+     ULONG srtt;
+     ULONG rttvar;
+     UBYTE timeout_backoff;
+};
+
+struct Snapshot
+{
+     char   path[SNAPSHOT_PATH_SIZE];
+     struct Snapshot_State saved;       // Latest one written or read, time 0 - none.
+
+     ULONG  saves;
+     ULONG  failures;
+};
+
+// An empty path, or one too long, leaves the snapshot off.
+void Snapshot_Init(struct Snapshot *_snapshot, const char *_path);
+
+// Reads the file and warms up the RTT window and the timeout of _monitor with it.
+// Returns the status to show until the first probe, -1 if there is none or it is
+// older than SNAPSHOT_MAX_AGE. _age gets its age in seconds.
+BYTE Snapshot_Load(struct Snapshot *_snapshot, struct Monitor *_monitor, ULONG _now, ULONG *_age);
+
+// Called after every probe - writes only when the throttle allows it.
+void Snapshot_Update(struct Snapshot *_snapshot, struct Monitor *_monitor, ULONG _now);
+
+// Writes now, before the monitor stops. Nothing while the status is unknown.
+BYTE Snapshot_Save(struct Snapshot *_snapshot, struct Monitor *_monitor, ULONG _now);
+
+#endif
@@ -0,0 +1,148 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - counters and timing histograms
+ * ---------------------------------------------------------*/
+
+#include "stats.h"
+
+#include <stdio.h>
+
+struct Stats stats;
+
+static const char *stats_phase_name[STATS_PHASES] = { "socket", "ioctl", "connect", "output" };
+
+static const char *stats_counter_name[STATS_COUNTERS] =
+{
+     "probes", "online", "offline", "connected", "refused", "unreachable", "timeouts", "failed", "aborted", "unexpected",
+     "unresolved", "lookups", "lookups_failed", "fallbacks", "damped", "bursts", "burst_sent", "burst_lost",
+     "share_sent", "share_received", "share_takeovers", "env_writes", "env_writes_saved", "redraws", "redraws_saved"
+};
+
+void Stats_Count(LONG _counter)
+{
+     stats.counter[_counter]++;
+}
+
+void Stats_Time(LONG _phase, TIME_US _start)
+{
+     TIME_US elapsed = Platform_Time() - _start;
+     ULONG micro = elapsed > 0xffffffffULL ? 0xffffffffUL : (ULONG)elapsed;
+
+     struct Stats_Histogram *histogram = &stats.phase[_phase];
+
+     // Bucket is the bit length of the time - a shift per bit, no division.
+     LONG bucket = 0;
+     for (ULONG rest = micro; rest && bucket < STATS_BUCKETS - 1; rest >>= 1) bucket++;
+
+     histogram->bucket[bucket]++;
+     histogram->count++;
+     if (micro > histogram->max) histogram->max = micro;
+}
+
+ULONG Stats_Percentile(struct Stats_Histogram *_histogram, LONG _percent)
+{
+     if (_histogram->count == 0) return 0;
+
+     // Nearest rank, as in Rtt_Percentile().
+     ULONG rank = (_histogram->count * _percent + 99) / 100;
+     if (rank == 0) rank = 1;
+
+     ULONG seen = 0;
+
+     for (LONG i = 0; i < STATS_BUCKETS - 1; i++)
+     {
+          seen += _histogram->bucket[i];
+          if (seen >= rank)
+          {
+               // Never more than what was really seen.
+               ULONG bound = 1UL << i;
+               return bound < _histogram->max ? bound : _histogram->max;
+          }
+     }
+
+     return _histogram->max;
+}
+
+LONG Stats_Format(char *_buffer, LONG _size)
+{
+     ULONG *counter = stats.counter;
+
+     LONG length = snprintf(_buffer, _size, "probes %lu on %lu off %lu"
+          " conn %lu rst %lu unr %lu tmo %lu bad %lu fail %lu"
+          " unres %lu dns %lu/%lu v4fb %lu"
+          " damp %lu"
+          " burst %lu/%lu/%lu"
+          " share %lu/%lu/%lu"
+          " env %lu/%lu draw %lu/%lu",
+          (unsigned long)counter[STATS_PROBES], (unsigned long)counter[STATS_ONLINE], (unsigned long)counter[STATS_OFFLINE],
+          (unsigned long)counter[STATS_CONNECTED], (unsigned long)counter[STATS_REFUSED], (unsigned long)counter[STATS_UNREACHABLE],
+          (unsigned long)counter[STATS_TIMEOUTS], (unsigned long)counter[STATS_UNEXPECTED], (unsigned long)counter[STATS_FAILED],
+          (unsigned long)counter[STATS_UNRESOLVED], (unsigned long)counter[STATS_LOOKUPS], (unsigned long)counter[STATS_LOOKUPS_FAILED],
+          (unsigned long)counter[STATS_FALLBACKS], (unsigned long)counter[STATS_DAMPED],
+          (unsigned long)counter[STATS_BURSTS], (unsigned long)counter[STATS_BURST_SENT], (unsigned long)counter[STATS_BURST_LOST],
+          (unsigned long)counter[STATS_SHARE_SENT], (unsigned long)counter[STATS_SHARE_RECEIVED], (unsigned long)counter[STATS_SHARE_TAKEOVERS],
+          (unsigned long)counter[STATS_ENV_WRITES], (unsigned long)counter[STATS_ENV_WRITES_SAVED],
+          (unsigned long)counter[STATS_REDRAWS], (unsigned long)counter[STATS_REDRAWS_SAVED]);
+
+     // Phases as p50/p95/max microseconds.
+     for (LONG i = 0; i < STATS_PHASES && length < _size; i++)
+     {
+          struct Stats_Histogram *histogram = &stats.phase[i];
+
+          length += snprintf(_buffer + length, _size - length, " %s %lu/%lu/%lu", stats_phase_name[i],
+               (unsigned long)Stats_Percentile(histogram, 50), (unsigned long)Stats_Percentile(histogram, 95), (unsigned long)histogram->max);
+     }
+
+     return length < _size ? length : _size - 1;
+}
+
+void Stats_Print(void)
+{
+     ULONG *counter = stats.counter;
+
+     printf("PROBES: %lu (%lu online, %lu offline, %lu held back by damping)\n", (unsigned long)counter[STATS_PROBES], (unsigned long)counter[STATS_ONLINE],
+          (unsigned long)counter[STATS_OFFLINE], (unsigned long)counter[STATS_DAMPED]);
+     printf("TARGETS: %lu connected, %lu refused, %lu unreachable, %lu timeouts, %lu unexpected, %lu failed, %lu aborted, %lu unresolved\n",
+          (unsigned long)counter[STATS_CONNECTED], (unsigned long)counter[STATS_REFUSED], (unsigned long)counter[STATS_UNREACHABLE],
+          (unsigned long)counter[STATS_TIMEOUTS], (unsigned long)counter[STATS_UNEXPECTED], (unsigned long)counter[STATS_FAILED],
+          (unsigned long)counter[STATS_ABORTED], (unsigned long)counter[STATS_UNRESOLVED]);
+     printf("LOOKUPS: %lu queries, %lu failed lookups\n", (unsigned long)counter[STATS_LOOKUPS], (unsigned long)counter[STATS_LOOKUPS_FAILED]);
+     printf("DUAL-STACK: %lu answered over IPv4\n", (unsigned long)counter[STATS_FALLBACKS]);
+     printf("BURSTS: %lu ticks, %lu probes, %lu lost\n", (unsigned long)counter[STATS_BURSTS], (unsigned long)counter[STATS_BURST_SENT],
+          (unsigned long)counter[STATS_BURST_LOST]);
+     printf("SHARE: %lu datagrams sent, %lu received, %lu takeovers\n", (unsigned long)counter[STATS_SHARE_SENT], (unsigned long)counter[STATS_SHARE_RECEIVED],
+          (unsigned long)counter[STATS_SHARE_TAKEOVERS]);
+     printf("OUTPUT: %lu ENV writes (%lu saved), %lu redraws (%lu saved)\n",
+          (unsigned long)counter[STATS_ENV_WRITES], (unsigned long)counter[STATS_ENV_WRITES_SAVED],
+          (unsigned long)counter[STATS_REDRAWS], (unsigned long)counter[STATS_REDRAWS_SAVED]);
+
+     for (LONG i = 0; i < STATS_PHASES; i++)
+     {
+          struct Stats_Histogram *histogram = &stats.phase[i];
+
+          printf("%-8s %lu calls, p50 %lu us, p95 %lu us, max %lu us\n", stats_phase_name[i], (unsigned long)histogram->count,
+               (unsigned long)Stats_Percentile(histogram, 50), (unsigned long)Stats_Percentile(histogram, 95), (unsigned long)histogram->max);
+
+          // Only the buckets that were hit, "<N us: count".
+          if (histogram->count == 0) continue;
+
+          printf("        ");
+          for (LONG b = 0; b < STATS_BUCKETS; b++)
+          {
+               if (histogram->bucket[b] == 0) continue;
+
+               if (b < STATS_BUCKETS - 1) printf(" <%lu:%lu", 1UL << b, (unsigned long)histogram->bucket[b]);
+               else                       printf(" more:%lu", (unsigned long)histogram->bucket[b]);
+          }
+          printf("\n");
+     }
+}
+
+const char* Stats_Counter_Name(LONG _counter)
+{
+     return _counter >= 0 && _counter < STATS_COUNTERS ? stats_counter_name[_counter] : "?";
+}
+
+const char* Stats_Phase_Name(LONG _phase)
+{
+     return _phase >= 0 && _phase < STATS_PHASES ? stats_phase_name[_phase] : "?";
+}
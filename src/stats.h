@@ -0,0 +1,85 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - counters and timing histograms
+ *
+ * Always on. Recording is a few adds into fixed arrays - no
+ * allocation, no formatting. Text is only made when somebody
+ * asks for a snapshot (Exchange "Show", "stats" on POSIX).
+ * ---------------------------------------------------------*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "platform.h"
+
+// Timed phases.
+#define STATS_SOCKET              0    // socket()
+#define STATS_IOCTL               1    // IoctlSocket() / fcntl() - non-blocking mode.
+#define STATS_CONNECT             2    // connect()
+#define STATS_OUTPUT              3    // Writing the status out (ENV:, window, files).
+#define STATS_PHASES              4
+
+// Counters.
+#define STATS_PROBES              0
+#define STATS_ONLINE              1
+#define STATS_OFFLINE             2
+#define STATS_CONNECTED           3    // Targets by how they ended.
+#define STATS_REFUSED             4
+#define STATS_UNREACHABLE         5
+#define STATS_TIMEOUTS            6
+#define STATS_FAILED              7
+#define STATS_ABORTED             8
+#define STATS_UNEXPECTED          9    // Answered with something else - captive portal, SERVFAIL.
+#define STATS_UNRESOLVED          10   // Host name without an address yet - not probed.
+#define STATS_LOOKUPS             11   // Queries sent by the name cache.
+#define STATS_LOOKUPS_FAILED      12   // Lookups that got no address.
+#define STATS_FALLBACKS           13   // Dual-stack targets that answered over IPv4.
+#define STATS_DAMPED              14   // Results not published yet - held back by flap damping.
+#define STATS_BURSTS              15   // Ticks of burst loss sampling,
+#define STATS_BURST_SENT          16   // their probes
+#define STATS_BURST_LOST          17   // and the ones without an answer.
+#define STATS_SHARE_SENT          18   // Status sharing datagrams,
+#define STATS_SHARE_RECEIVED      19   // the ones from other copies of our group
+#define STATS_SHARE_TAKEOVERS     20   // and the times we became the leader.
+#define STATS_ENV_WRITES          21
+#define STATS_ENV_WRITES_SAVED    22
+#define STATS_REDRAWS             23
+#define STATS_REDRAWS_SAVED       24
+#define STATS_COUNTERS            25
+
+// Bucket n counts times below 2^n microseconds, the last one everything from ~4 s up.
+#define STATS_BUCKETS             24
+
+struct Stats_Histogram
+{
+     ULONG count;
+     ULONG max;
+     ULONG bucket[STATS_BUCKETS];
+};
+
+struct Stats
+{
+     ULONG                  counter[STATS_COUNTERS];
+     struct Stats_Histogram phase[STATS_PHASES];
+};
+
+extern struct Stats stats;
+
+void Stats_Count(LONG _counter);
+
+// Records the time from _start (Platform_Time()) to now.
+void Stats_Time(LONG _phase, TIME_US _start);
+
+// Upper bound of the bucket holding the given percentile (0..100), in microseconds.
+ULONG Stats_Percentile(struct Stats_Histogram *_histogram, LONG _percent);
+
+// One line, for the ENV variable. Returns its length.
+LONG Stats_Format(char *_buffer, LONG _size);
+
+// Full dump with histograms, for debug output.
+void Stats_Print(void);
+
+// Lower case names of a counter and a phase, "timeouts", "connect" - for metrics.
+const char* Stats_Counter_Name(LONG _counter);
+const char* Stats_Phase_Name(LONG _phase);
+
+#endif
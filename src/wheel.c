@@ -0,0 +1,231 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - timer wheel
+ * ---------------------------------------------------------*/
+
+#include "wheel.h"
+
+#include <string.h>
+
+#define WHEEL_USED(w, l, s)      ((w)->used[l][(s) >> 5] & (1UL << ((s) & 31)))
+
+void Wheel_Init(struct Wheel *_wheel)
+{
+     memset(_wheel, 0, sizeof(struct Wheel));
+
+     _wheel->tick_time = Platform_Time();
+     _wheel->started = _wheel->tick_time;
+}
+
+void Wheel_Timer_Init(struct Wheel_Timer *_timer, Wheel_Callback _callback, APTR _data)
+{
+     memset(_timer, 0, sizeof(struct Wheel_Timer));
+
+     _timer->callback = _callback;
+     _timer->data = _data;
+}
+
+// Links the timer into the slot for its tick, as seen from the current tick.
+static void Wheel_Insert(struct Wheel *_wheel, struct Wheel_Timer *_timer)
+{
+     ULONG delta = _timer->tick - _wheel->tick;
+     UBYTE level = 0;
+
+     while (level < WHEEL_LEVELS - 1 && delta >= (1UL << (WHEEL_BITS * (level + 1)))) level++;
+
+     UBYTE slot = (UBYTE)((_timer->tick >> (WHEEL_BITS * level)) & WHEEL_MASK);
+     struct Wheel_Timer **head = &_wheel->slot[level][slot];
+
+     _timer->level = level;
+     _timer->slot = slot;
+     _timer->next = *head;
+     _timer->prev = head;
+     if (*head) (*head)->prev = &_timer->next;
+     *head = _timer;
+
+     _wheel->used[level][slot >> 5] |= 1UL << (slot & 31);
+}
+
+static void Wheel_Unlink(struct Wheel *_wheel, struct Wheel_Timer *_timer)
+{
+     *_timer->prev = _timer->next;
+     if (_timer->next) _timer->next->prev = _timer->prev;
+
+     if (!_wheel->slot[_timer->level][_timer->slot])
+          _wheel->used[_timer->level][_timer->slot >> 5] &= ~(1UL << (_timer->slot & 31));
+
+     _timer->next = NULL;
+     _timer->prev = NULL;
+}
+
+void Wheel_Add(struct Wheel *_wheel, struct Wheel_Timer *_timer, TIME_US _expires)
+{
+     if (_timer->prev) Wheel_Unlink(_wheel, _timer);
+     else _wheel->count++;
+
+     // Rounded up - a timer never fires before its deadline. Already due - next tick.
+     TIME_US delta = 0;
+     if (_expires > _wheel->tick_time) delta = (_expires - _wheel->tick_time + WHEEL_TICK_US - 1) / WHEEL_TICK_US;
+
+     // Too far - the last level is as far as it goes, the callback finds it early.
+     TIME_US max = (1UL << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+     if (delta > max) delta = max;
+
+     _timer->tick = _wheel->tick + (ULONG)delta;
+     Wheel_Insert(_wheel, _timer);
+}
+
+void Wheel_Cancel(struct Wheel *_wheel, struct Wheel_Timer *_timer)
+{
+     if (!_timer->prev) return;
+
+     Wheel_Unlink(_wheel, _timer);
+     _wheel->count--;
+}
+
+// First used slot of a level, counting from the slot of _from. -1 if none.
+static LONG Wheel_First_Used(struct Wheel *_wheel, UBYTE _level, ULONG _from)
+{
+     for (ULONG i = 0; i < WHEEL_SLOTS; i++)
+     {
+          ULONG slot = (_from + i) & WHEEL_MASK;
+
+          // Skip empty 32 slot words at once.
+          if (!(slot & 31) && !_wheel->used[_level][slot >> 5] && i + 31 < WHEEL_SLOTS)
+          {
+               i += 31;
+               continue;
+          }
+
+          if (WHEEL_USED(_wheel, _level, slot)) return (LONG)slot;
+     }
+
+     return -1;
+}
+
+TIME_US Wheel_Next(struct Wheel *_wheel)
+{
+     if (!_wheel->count) return WHEEL_NEVER;
+
+     ULONG best = 0;
+     BYTE found = 0;
+
+     // Level 0 holds only the next 64 ticks, so its first used slot is its earliest tick.
+     LONG slot = Wheel_First_Used(_wheel, 0, _wheel->tick);
+     if (slot >= 0)
+     {
+          best = _wheel->tick + (((ULONG)slot - _wheel->tick) & WHEEL_MASK);
+          found = 1;
+     }
+
+     // Upper levels hold ranges - the earliest timer of the first used slot counts.
+     // The current slot of a level has been cascaded already, so it comes last.
+     for (UBYTE level = 1; level < WHEEL_LEVELS; level++)
+     {
+          slot = Wheel_First_Used(_wheel, level, (_wheel->tick >> (WHEEL_BITS * level)) + 1);
+          if (slot < 0) continue;
+
+          for (struct Wheel_Timer *timer = _wheel->slot[level][slot]; timer; timer = timer->next)
+          {
+               if (!found || (LONG)(timer->tick - best) < 0)
+               {
+                    best = timer->tick;
+                    found = 1;
+               }
+          }
+     }
+
+     return _wheel->tick_time + (TIME_US)(best - _wheel->tick) * WHEEL_TICK_US;
+}
+
+// Moves timers of the upper level slots that start at the current tick down.
+static void Wheel_Cascade(struct Wheel *_wheel)
+{
+     for (UBYTE level = 1; level < WHEEL_LEVELS; level++)
+     {
+          ULONG slot = (_wheel->tick >> (WHEEL_BITS * level)) & WHEEL_MASK;
+          struct Wheel_Timer *timer = _wheel->slot[level][slot];
+
+          _wheel->slot[level][slot] = NULL;
+          _wheel->used[level][slot >> 5] &= ~(1UL << (slot & 31));
+
+          while (timer)
+          {
+               struct Wheel_Timer *next = timer->next;
+               Wheel_Insert(_wheel, timer);
+               timer = next;
+          }
+
+          // Higher level turns over only when this one wraps.
+          if (slot) break;
+     }
+}
+
+// Moves the current tick on. Cascades right away when a level 0 round
+// starts, so Wheel_Next() never has to look into a stale upper slot.
+static void Wheel_Step(struct Wheel *_wheel, ULONG _tick)
+{
+     _wheel->tick_time += (TIME_US)(_tick - _wheel->tick) * WHEEL_TICK_US;
+     _wheel->tick = _tick;
+
+     if (!(_tick & WHEEL_MASK)) Wheel_Cascade(_wheel);
+}
+
+void Wheel_Advance(struct Wheel *_wheel, TIME_US _now)
+{
+     _wheel->wakeups++;
+
+     if (_now < _wheel->tick_time) return;
+
+     // Asleep for longer than the wheel reaches - everything is due anyway.
+     TIME_US ticks = (_now - _wheel->tick_time) / WHEEL_TICK_US;
+     if (ticks > 0x7fffffff) ticks = 0x7fffffff;
+
+     ULONG last = _wheel->tick + (ULONG)ticks;
+     BYTE fired = 0;
+
+     while ((LONG)(last - _wheel->tick) >= 0)
+     {
+          // Nothing on level 0 - jump straight to the next cascade.
+          if (!_wheel->used[0][0] && !_wheel->used[0][1])
+          {
+               ULONG next = (_wheel->tick | WHEEL_MASK) + 1;
+
+               Wheel_Step(_wheel, (LONG)(next - last) > 0 ? last + 1 : next);
+               continue;
+          }
+
+          ULONG due = _wheel->tick;
+          ULONG slot = due & WHEEL_MASK;
+
+          // Moved on before the callbacks - timers they add for now land in the next tick.
+          Wheel_Step(_wheel, due + 1);
+
+          // Taken from the slot one at a time, so a callback may cancel or move any timer,
+          // one due in this tick too. Timers 64 ticks on share the slot - they stay.
+          for (;;)
+          {
+               struct Wheel_Timer *timer = _wheel->slot[0][slot];
+               while (timer && timer->tick != due) timer = timer->next;
+
+               if (!timer) break;
+
+               Wheel_Unlink(_wheel, timer);
+               _wheel->count--;
+
+               if (fired) _wheel->coalesced++;
+               fired = 1;
+               _wheel->fired++;
+
+               timer->callback(timer);
+          }
+     }
+}
+
+ULONG Wheel_Wakeups_Per_Hour(struct Wheel *_wheel, TIME_US _now)
+{
+     TIME_US elapsed = _now - _wheel->started;
+
+     if (elapsed < 1000000) return 0;
+
+     return (ULONG)((TIME_US)_wheel->wakeups * 3600000000ULL / elapsed);
+}
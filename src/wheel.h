@@ -0,0 +1,76 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - timer wheel
+ *
+ * Any number of deadlines on one backend timer (timer.device
+ * request on Amiga, poll() timeout on POSIX). Four levels of
+ * 64 slots with 20 ms ticks cover ~93 hours. Add and cancel
+ * are O(1), expiring is O(1) per timer plus one move per
+ * level when a timer cascades down. Deadlines in the same
+ * tick are served by one wakeup.
+ * ---------------------------------------------------------*/
+
+#ifndef WHEEL_H
+#define WHEEL_H
+
+#include "platform.h"
+
+// One VBLANK - timer.device UNIT_VBLANK can't be more precise anyway.
+#define WHEEL_TICK_US       20000
+
+#define WHEEL_BITS          6
+#define WHEEL_SLOTS         (1 << WHEEL_BITS)
+#define WHEEL_MASK          (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS        4
+
+// Wheel_Next() with nothing scheduled.
+#define WHEEL_NEVER         (~(TIME_US)0)
+
+struct Wheel_Timer;
+
+typedef void (*Wheel_Callback)(struct Wheel_Timer *_timer);
+
+struct Wheel_Timer
+{
+     struct Wheel_Timer  *next;
+     struct Wheel_Timer **prev;          // Pointer that points to this timer, NULL if not scheduled.
+     ULONG                tick;          // Tick it expires in.
+     UBYTE                level, slot;
+
+     Wheel_Callback       callback;
+     APTR                 data;
+};
+
+struct Wheel
+{
+     struct Wheel_Timer *slot[WHEEL_LEVELS][WHEEL_SLOTS];
+     ULONG               used[WHEEL_LEVELS][WHEEL_SLOTS / 32];    // Bit set for slots with timers.
+
+     ULONG    tick;           // Next tick to expire, all before it are done. Wraps.
+     TIME_US  tick_time;      // When it starts.
+     LONG     count;          // Timers scheduled.
+
+     // For debug output.
+     TIME_US  started;
+     ULONG    wakeups;        // Wheel_Advance() calls.
+     ULONG    fired;          // Timers expired.
+     ULONG    coalesced;      // Timers that shared a wakeup with an earlier one.
+};
+
+void Wheel_Init(struct Wheel *_wheel);
+void Wheel_Timer_Init(struct Wheel_Timer *_timer, Wheel_Callback _callback, APTR _data);
+
+// Schedules the timer for _expires (Platform_Time()), moving it if it was scheduled already.
+// It fires at the end of the tick _expires falls in - never earlier.
+void Wheel_Add(struct Wheel *_wheel, struct Wheel_Timer *_timer, TIME_US _expires);
+void Wheel_Cancel(struct Wheel *_wheel, struct Wheel_Timer *_timer);
+
+// When the backend timer should fire next, WHEEL_NEVER if nothing is scheduled.
+TIME_US Wheel_Next(struct Wheel *_wheel);
+
+// Runs callbacks of all timers that are due at _now.
+void Wheel_Advance(struct Wheel *_wheel, TIME_US _now);
+
+// Wakeups per hour since Wheel_Init().
+ULONG Wheel_Wakeups_Per_Hour(struct Wheel *_wheel, TIME_US _now);
+
+#endif
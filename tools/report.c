@@ -0,0 +1,390 @@
+/* ---------------------------------------------------------
+ * msInternetStatus - availability report
+ *
+ * Reads the outage journal (see journal.h) and prints for a
+ * time range:
+ *
+ *   AVAILABILITY  - online time of the time the status was known
+ *   OUTAGES       - times it went Offline, and for how long
+ *   MTBF          - mean online time between two outages
+ *   MTTR          - mean length of an outage
+ *   LONGEST       - the longest outages, where the path broke
+ *
+ * Time the program was not running, or the journal has no
+ * record of (a crash, a gap over REPORT_MAX_GAP), is left
+ * out. Only the range is read - it is found by bisection.
+ * ---------------------------------------------------------*/
+
+#include "journal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define   DEF_LONGEST         5
+#define   REPORT_MAX_LONGEST  20
+
+// A gap between two records longer than this is not taken as the status going on.
+// Probes are at most an hour apart.
+#define   REPORT_MAX_GAP      7200
+
+// Records read at once.
+#define   REPORT_CHUNK        4096
+
+struct Report_Outage
+{
+     ULONG start;
+     ULONG length;
+     BYTE  verdict;
+};
+
+struct Report
+{
+     ULONG from, to;
+
+     ULONG online, offline, unknown, unmonitored;    // Seconds.
+     ULONG outages;
+     ULONG records, damaged;
+     ULONG first, last;                               // Times of the records read.
+
+     struct Report_Outage outage;                     // The one going on, length 0 - none.
+     struct Report_Outage longest[REPORT_MAX_LONGEST];
+     LONG  longest_count, longest_max;
+};
+
+// Same names as Diag_Verdict_Text().
+static const char* Report_Verdict_Text(BYTE _verdict)
+{
+     static const char *text[] = { "online", "local", "gateway", "DNS", "WAN" };
+
+     return _verdict >= 0 && _verdict <= 4 ? text[(UBYTE)_verdict] : "-";
+}
+
+// Days since 1970-01-01 of a date, and back (H. Hinnant's civil calendar).
+static LONG Report_Days(LONG _year, LONG _month, LONG _day)
+{
+     _year -= _month <= 2;
+     LONG era = (_year >= 0 ? _year : _year - 399) / 400;
+     LONG year_of_era = _year - era * 400;
+     LONG day_of_year = (153 * (_month + (_month > 2 ? -3 : 9)) + 2) / 5 + _day - 1;
+     LONG day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+
+     return era * 146097 + day_of_era - 719468;
+}
+
+static void Report_Format_Time(ULONG _time, char *_buffer)
+{
+     LONG days = _time / 86400;
+     LONG rest = _time % 86400;
+
+     days += 719468;
+     LONG era = days / 146097;
+     LONG day_of_era = days - era * 146097;
+     LONG year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+     LONG day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+     LONG month_index = (5 * day_of_year + 2) / 153;
+     LONG day = day_of_year - (153 * month_index + 2) / 5 + 1;
+     LONG month = month_index < 10 ? month_index + 3 : month_index - 9;
+     LONG year = year_of_era + era * 400 + (month <= 2);
+
+     sprintf(_buffer, "%04ld-%02ld-%02ld %02ld:%02ld:%02ld", (long)year, (long)month, (long)day,
+          (long)(rest / 3600), (long)(rest / 60 % 60), (long)(rest % 60));
+}
+
+// The two largest units, "3d 4h", "12m 5s".
+static void Report_Format_Length(ULONG _seconds, char *_buffer)
+{
+     ULONG unit[4] = { _seconds / 86400, _seconds / 3600 % 24, _seconds / 60 % 60, _seconds % 60 };
+     const char *name[4] = { "d", "h", "m", "s" };
+     LONG i = 0;
+
+     while (i < 3 && unit[i] == 0) i++;
+
+     if (i < 3 && unit[i + 1]) sprintf(_buffer, "%lu%s %lu%s", (unsigned long)unit[i], name[i], (unsigned long)unit[i + 1], name[i + 1]);
+     else sprintf(_buffer, "%lu%s", (unsigned long)unit[i], name[i]);
+}
+
+// "2026-10-17", "2026-10-17 08:30[:00]" (or with a T), or "-7d" / "-12h" before the end
+// of the journal. Returns 0 if not valid.
+static BYTE Report_Parse_Time(const char *_text, ULONG _end, ULONG *_time)
+{
+     long year, month, day, hour = 0, minute = 0, second = 0;
+     char unit;
+     long count;
+
+     if (sscanf(_text, "-%ld%c", &count, &unit) == 2 && count >= 0 && (unit == 'd' || unit == 'h'))
+     {
+          ULONG back = (ULONG)count * (unit == 'd' ? 86400 : 3600);
+          *_time = back < _end ? _end - back : 0;
+          return 1;
+     }
+
+     LONG fields = sscanf(_text, "%ld-%ld-%ld%*[ T]%ld:%ld:%ld", &year, &month, &day, &hour, &minute, &second);
+     if (fields < 3 || fields == 4 || month < 1 || month > 12 || day < 1 || day > 31 || year < 1970) return 0;
+
+     *_time = (ULONG)Report_Days(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+     return 1;
+}
+
+static void Report_Add_Longest(struct Report *_report, const struct Report_Outage *_outage)
+{
+     LONG i = _report->longest_count;
+
+     if (i == _report->longest_max)
+     {
+          if (i == 0 || _outage->length <= _report->longest[i - 1].length) return;
+          i--;
+     }
+     else _report->longest_count++;
+
+     // Sorted, the longest first.
+     while (i > 0 && _report->longest[i - 1].length < _outage->length)
+     {
+          _report->longest[i] = _report->longest[i - 1];
+          i--;
+     }
+
+     _report->longest[i] = *_outage;
+}
+
+static void Report_End_Outage(struct Report *_report)
+{
+     if (_report->outage.length) Report_Add_Longest(_report, &_report->outage);
+
+     _report->outage.length = 0;
+}
+
+// Time from _from to _to went by with the status of _record - clipped to the range.
+static void Report_Span(struct Report *_report, const struct Journal_Record *_record, ULONG _from, ULONG _to, BYTE _monitored)
+{
+     if (_from < _report->from) _from = _report->from;
+     if (_to > _report->to) _to = _report->to;
+     if (_to <= _from) return;
+
+     ULONG length = _to - _from;
+
+     if (!_monitored || _record->status < 0)
+     {
+          if (_monitored) _report->unknown += length;
+          else _report->unmonitored += length;
+
+          Report_End_Outage(_report);
+          return;
+     }
+
+     if (_record->status)
+     {
+          _report->online += length;
+          Report_End_Outage(_report);
+          return;
+     }
+
+     _report->offline += length;
+
+     if (_report->outage.length == 0)
+     {
+          _report->outages++;
+          _report->outage.start = _from;
+          _report->outage.verdict = -1;
+     }
+
+     _report->outage.length += length;
+
+     // The first place the path diagnosis blamed.
+     if (_report->outage.verdict <= 0 && _record->verdict > 0) _report->outage.verdict = _record->verdict;
+}
+
+// Time of record _index, 0 if it is damaged.
+static ULONG Report_Time_At(FILE *_file, LONG _index)
+{
+     UBYTE buffer[JOURNAL_RECORD_SIZE];
+     struct Journal_Record record;
+
+     if (fseek(_file, (long)_index * JOURNAL_RECORD_SIZE, SEEK_SET) != 0) return 0;
+     if (fread(buffer, JOURNAL_RECORD_SIZE, 1, _file) != 1 || !Journal_Decode(buffer, &record)) return 0;
+
+     return record.time;
+}
+
+// First record at or after _time - a damaged one in the middle only makes it start earlier.
+static LONG Report_Find(FILE *_file, LONG _count, ULONG _time)
+{
+     LONG low = 0, high = _count;
+
+     while (low < high)
+     {
+          LONG middle = low + (high - low) / 2;
+          ULONG time = Report_Time_At(_file, middle);
+
+          if (time && time < _time) low = middle + 1;
+          else high = middle;
+     }
+
+     return low;
+}
+
+static void Report_Scan(struct Report *_report, FILE *_file, LONG _start, LONG _count)
+{
+     static UBYTE buffer[REPORT_CHUNK * JOURNAL_RECORD_SIZE];
+     struct Journal_Record previous, record;
+     BYTE have_previous = 0;
+
+     memset(&previous, 0, sizeof(previous));
+     fseek(_file, (long)_start * JOURNAL_RECORD_SIZE, SEEK_SET);
+
+     for (LONG index = _start; index < _count; )
+     {
+          LONG chunk = _count - index < REPORT_CHUNK ? _count - index : REPORT_CHUNK;
+          LONG read = fread(buffer, JOURNAL_RECORD_SIZE, chunk, _file);
+          if (read <= 0) break;
+
+          for (LONG i = 0; i < read; i++)
+          {
+               if (!Journal_Decode(buffer + i * JOURNAL_RECORD_SIZE, &record))
+               {
+                    _report->damaged++;
+                    continue;
+               }
+
+               if (!_report->records) _report->first = record.time;
+               _report->records++;
+               _report->last = record.time;
+
+               if (have_previous && record.time >= previous.time)
+               {
+                    // Stopped, or a START without a STOP - the program did not end by itself.
+                    BYTE monitored = previous.type != JOURNAL_TYPE_STOP && record.type != JOURNAL_TYPE_START &&
+                         record.time - previous.time <= REPORT_MAX_GAP;
+
+                    Report_Span(_report, &previous, previous.time, record.time, monitored);
+               }
+
+               previous = record;
+               have_previous = 1;
+
+               if (record.time >= _report->to) break;
+          }
+
+          if (have_previous && previous.time >= _report->to) break;
+          index += read;
+     }
+
+     Report_End_Outage(_report);
+}
+
+static void Report_Print(struct Report *_report, const char *_path)
+{
+     char from[24], to[24], text[32], text2[32], text3[32];
+     ULONG known = _report->online + _report->offline;
+
+     printf("JOURNAL:      %s, %lu records read, %lu damaged\n", _path, (unsigned long)_report->records, (unsigned long)_report->damaged);
+
+     if (_report->records == 0) return;
+
+     Report_Format_Time(_report->from > _report->first ? _report->from : _report->first, from);
+     Report_Format_Time(_report->to < _report->last ? _report->to : _report->last, to);
+     printf("RANGE:        %s .. %s\n", from, to);
+
+     Report_Format_Length(known + _report->unknown, text);
+     Report_Format_Length(_report->unmonitored, text2);
+     Report_Format_Length(_report->unknown, text3);
+     printf("MONITORED:    %s (not monitored %s, status unknown %s)\n", text, text2, text3);
+
+     // Thousandths of a percent without floating point - m68k may have no FPU.
+     ULONG scaled = known ? (ULONG)((unsigned long long)_report->online * 100000ULL / known) : 0;
+     Report_Format_Length(_report->online, text);
+     Report_Format_Length(_report->offline, text2);
+     if (known) printf("AVAILABILITY: %lu.%03lu%% (online %s, offline %s)\n", (unsigned long)(scaled / 1000), (unsigned long)(scaled % 1000), text, text2);
+     else       printf("AVAILABILITY: - (no known status in the range)\n");
+
+     if (_report->outages == 0)
+     {
+          printf("OUTAGES:      0\n");
+          return;
+     }
+
+     Report_Format_Length(_report->online / _report->outages, text);
+     Report_Format_Length(_report->offline / _report->outages, text2);
+     printf("OUTAGES:      %lu, MTBF %s, MTTR %s\n", (unsigned long)_report->outages, text, text2);
+
+     printf("LONGEST:\n");
+     for (LONG i = 0; i < _report->longest_count; i++)
+     {
+          Report_Format_Time(_report->longest[i].start, from);
+          Report_Format_Length(_report->longest[i].length, text);
+          printf("   %s  %-8s %s\n", from, text, Report_Verdict_Text(_report->longest[i].verdict));
+     }
+}
+
+static void Usage(void)
+{
+     fprintf(stderr, "Usage: report [-f from] [-t to] [-n longest] journal\n"
+          "   from, to: YYYY-MM-DD[ HH:MM[:SS]] or -Nd / -Nh before the end of the journal\n");
+}
+
+int main(int argc, char **argv)
+{
+     struct Report report;
+     const char *path = NULL, *from_text = NULL, *to_text = NULL;
+
+     memset(&report, 0, sizeof(report));
+     report.longest_max = DEF_LONGEST;
+
+     for (LONG i = 1; i < argc; i++)
+     {
+          if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)      from_text = argv[++i];
+          else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) to_text = argv[++i];
+          else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) report.longest_max = atoi(argv[++i]);
+          else if (argv[i][0] != '-' && path == NULL)          path = argv[i];
+          else
+          {
+               Usage();
+               return 1;
+          }
+     }
+
+     if (path == NULL)
+     {
+          Usage();
+          return 1;
+     }
+
+     if (report.longest_max < 0)                  report.longest_max = 0;
+     if (report.longest_max > REPORT_MAX_LONGEST) report.longest_max = REPORT_MAX_LONGEST;
+
+     FILE *file = fopen(path, "rb");
+     if (file == NULL)
+     {
+          fprintf(stderr, "report: Error! Can't open %s.\n", path);
+          return 1;
+     }
+
+     // A torn record at the end is left out.
+     fseek(file, 0, SEEK_END);
+     LONG count = ftell(file) / JOURNAL_RECORD_SIZE;
+
+     // Relative times count back from the last record.
+     ULONG end = count ? Report_Time_At(file, count - 1) : 0;
+
+     report.from = 0;
+     report.to = 0xffffffffUL;
+
+     if ((from_text && !Report_Parse_Time(from_text, end, &report.from)) || (to_text && !Report_Parse_Time(to_text, end, &report.to)))
+     {
+          fprintf(stderr, "report: Error! Bad time.\n");
+          Usage();
+          fclose(file);
+          return 1;
+     }
+
+     // The record before the range tells the status it starts with.
+     LONG start = Report_Find(file, count, report.from);
+     if (start > 0) start--;
+
+     Report_Scan(&report, file, start, count);
+     fclose(file);
+
+     Report_Print(&report, path);
+
+     return 0;
+}